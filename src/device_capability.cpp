@@ -52,6 +52,24 @@ DeviceCapability::DeviceCapability(const std::string &configFilePath)
         if (configJson.hasKey("planes")) {
             parsePlanes(configJson["planes"]);
         }
+        if (configJson.hasKey("hvsBudget")) {
+            parseHvsBudget(configJson["hvsBudget"]);
+        }
+        if (configJson.hasKey("modeCache")) {
+            parseModeCache(configJson["modeCache"]);
+        }
+        if (configJson.hasKey("frameRateMatching")) {
+            parseFrameRatePolicy(configJson["frameRateMatching"]);
+        }
+        if (configJson.hasKey("trace")) {
+            parseTrace(configJson["trace"]);
+        }
+        if (configJson.hasKey("bufferPool")) {
+            parseBufferPool(configJson["bufferPool"]);
+        }
+        if (configJson.hasKey("hotplug")) {
+            parseHotplugPolicy(configJson["hotplug"]);
+        }
     }
 }
 
@@ -85,6 +103,129 @@ void DeviceCapability::parsePlanes(pbnjson::JValue element)
     }
 }
 
+void DeviceCapability::parseHvsBudget(pbnjson::JValue object)
+{
+    if (!object.isObject()) {
+        LOG_ERROR(MSGID_CONFFILE_MISCONFIGURED, 0, "Failed to read hvsBudget. using defaults.");
+        return;
+    }
+    if (object.hasKey("enabled")) {
+        mHvsBudget.enabled = object["enabled"].asBool();
+    }
+    // membus load in MiB/s, hvs load in MHz (cycles per second / 10^6)
+    if (object.hasKey("membusLoad")) {
+        mHvsBudget.membusLoad = static_cast<uint64_t>(object["membusLoad"].asNumber<int64_t>()) * 1024 * 1024;
+    }
+    if (object.hasKey("hvsLoad")) {
+        mHvsBudget.hvsLoad = static_cast<uint64_t>(object["hvsLoad"].asNumber<int64_t>()) * 1000000;
+    }
+    // "reject" by default, "downgrade" crops the source of a window rather than refusing it.
+    if (object.hasKey("policy")) {
+        mHvsBudget.downgrade = (object["policy"].asString() == "downgrade");
+    }
+
+    LOG_INFO(MSGID_DEVICE_STATUS, 0, "\n hvsBudget enabled = %d membus = %llu hvs = %llu downgrade = %d",
+             mHvsBudget.enabled, (unsigned long long)mHvsBudget.membusLoad, (unsigned long long)mHvsBudget.hvsLoad,
+             mHvsBudget.downgrade);
+}
+
+void DeviceCapability::parseModeCache(pbnjson::JValue object)
+{
+    if (!object.isObject()) {
+        LOG_ERROR(MSGID_CONFFILE_MISCONFIGURED, 0, "Failed to read modeCache. using defaults.");
+        return;
+    }
+    if (object.hasKey("path")) {
+        mModeCachePath = object["path"].asString();
+    }
+    if (object.hasKey("enabled") && !object["enabled"].asBool()) {
+        mModeCachePath.clear();
+    }
+
+    LOG_INFO(MSGID_DEVICE_STATUS, 0, "\n modeCache path = %s", mModeCachePath.c_str());
+}
+
+void DeviceCapability::parseFrameRatePolicy(pbnjson::JValue object)
+{
+    if (!object.isObject()) {
+        LOG_ERROR(MSGID_CONFFILE_MISCONFIGURED, 0, "Failed to read frameRateMatching. using defaults.");
+        return;
+    }
+    if (object.hasKey("auto")) {
+        mFrameRatePolicy.autoSwitch = object["auto"].asBool();
+    }
+    if (object.hasKey("revertDelay")) {
+        mFrameRatePolicy.revertDelay = static_cast<uint32_t>(object["revertDelay"].asNumber<int32_t>());
+    }
+
+    LOG_INFO(MSGID_DEVICE_STATUS, 0, "\n frameRateMatching auto = %d revertDelay = %u", mFrameRatePolicy.autoSwitch,
+             mFrameRatePolicy.revertDelay);
+}
+
+void DeviceCapability::parseTrace(pbnjson::JValue object)
+{
+    if (!object.isObject()) {
+        LOG_ERROR(MSGID_CONFFILE_MISCONFIGURED, 0, "Failed to read trace. using defaults.");
+        return;
+    }
+    if (object.hasKey("enabled")) {
+        mTraceEnabled = object["enabled"].asBool();
+    }
+    if (object.hasKey("path")) {
+        mTracePath = object["path"].asString();
+    }
+
+    LOG_INFO(MSGID_DEVICE_STATUS, 0, "\n trace enabled = %d path = %s", mTraceEnabled, mTracePath.c_str());
+}
+
+void DeviceCapability::parseBufferPool(pbnjson::JValue object)
+{
+    if (!object.isObject()) {
+        LOG_ERROR(MSGID_CONFFILE_MISCONFIGURED, 0, "Failed to read bufferPool. using defaults.");
+        return;
+    }
+    if (object.hasKey("budgetMB")) {
+        mMemoryBudget = static_cast<uint64_t>(object["budgetMB"].asNumber<int32_t>()) << 20;
+        LOG_INFO(MSGID_DEVICE_STATUS, 0, "\n bufferPool budget = %llu bytes", (unsigned long long)mMemoryBudget);
+    }
+    if (!object.hasKey("classes") || !object["classes"].isArray())
+        return;
+    mBufferClasses.clear();
+    for (auto item : object["classes"].items()) {
+        if (!item.hasKey("w") || !item.hasKey("h") || !item.hasKey("count")) {
+            LOG_ERROR(MSGID_CONFFILE_MISCONFIGURED, 0, "Ignoring bufferPool class without w, h and count");
+            continue;
+        }
+        BufferClass bufferClass;
+        bufferClass.width  = static_cast<uint32_t>(item["w"].asNumber<int32_t>());
+        bufferClass.height = static_cast<uint32_t>(item["h"].asNumber<int32_t>());
+        bufferClass.count  = static_cast<uint32_t>(item["count"].asNumber<int32_t>());
+        if (item.hasKey("bpp")) {
+            bufferClass.bpp = static_cast<uint32_t>(item["bpp"].asNumber<int32_t>());
+        }
+        mBufferClasses.push_back(bufferClass);
+        LOG_INFO(MSGID_DEVICE_STATUS, 0, "\n bufferPool class %ux%u bpp = %u count = %u", bufferClass.width,
+                 bufferClass.height, bufferClass.bpp, bufferClass.count);
+    }
+}
+
+void DeviceCapability::parseHotplugPolicy(pbnjson::JValue object)
+{
+    if (!object.isObject()) {
+        LOG_ERROR(MSGID_CONFFILE_MISCONFIGURED, 0, "Failed to read hotplug. using defaults.");
+        return;
+    }
+    if (object.hasKey("quietWindow")) {
+        mHotplugPolicy.quietWindow = static_cast<uint32_t>(object["quietWindow"].asNumber<int32_t>());
+    }
+    if (object.hasKey("minInterval")) {
+        mHotplugPolicy.minInterval = static_cast<uint32_t>(object["minInterval"].asNumber<int32_t>());
+    }
+
+    LOG_INFO(MSGID_DEVICE_STATUS, 0, "\n hotplug quietWindow = %u minInterval = %u", mHotplugPolicy.quietWindow,
+             mHotplugPolicy.minInterval);
+}
+
 DeviceCapability::~DeviceCapability()
 {
     LOG_DEBUG("Destroy DeviceCapability");
@@ -16,10 +16,25 @@
 
 #pragma once
 
+#include "bufferPool.h"
+#include "hvsBandwidth.h"
 #include <pbnjson/cxx/JValue.h>
 #include <set>
 #include <string>
 #include <val/val_video.h>
+#include <vector>
+
+// Switching the display refresh rate to the frame rate of the content being played.
+struct FrameRatePolicy {
+    bool autoSwitch      = false; // switch when playback starts, not only on request
+    uint32_t revertDelay = 5000;  // ms after playback stops before the previous mode is restored
+};
+
+// Coalescing of the hotplug bursts sent while HDMI links are trained.
+struct HotplugPolicy {
+    uint32_t quietWindow = 200;  // ms without events before a connector is probed
+    uint32_t minInterval = 1000; // ms between two probes of a connector
+};
 
 class DeviceCapability
 {
@@ -50,6 +65,14 @@ public:
     VAL_VIDEO_SIZE_T getMaxResolution() { return mMaxResolution; };
     VAL_VIDEO_SIZE_T getMinResolution() { return mMinResolution; };
     const std::set<std::string> &getPlaneNames() { return mPlaneNames; };
+    const HvsBudget &getHvsBudget() { return mHvsBudget; };
+    const std::string &getModeCachePath() { return mModeCachePath; }; // empty if disabled
+    const FrameRatePolicy &getFrameRatePolicy() { return mFrameRatePolicy; };
+    const HotplugPolicy &getHotplugPolicy() { return mHotplugPolicy; };
+    bool isTraceEnabled() { return mTraceEnabled; };
+    const std::string &getTracePath() { return mTracePath; };
+    const std::vector<BufferClass> &getBufferClasses() { return mBufferClasses; };
+    uint64_t getMemoryBudget() { return mMemoryBudget; }; // bytes, 0 for no limit
 private:
     DeviceModeResolution mMaxResolution = {w : 1920, h : 1080, freq : 60};
     /*note: according to http://www.raspberrypi.org/phpBB3/viewtopic.php?f=26&t=20155&p=195417&hilit=2
@@ -60,8 +83,22 @@ private:
      * device-cap.json*/
 
     std::set<std::string> mPlaneNames = {"MAIN"};
+    HvsBudget mHvsBudget;
+    std::string mModeCachePath = "/var/cache/val/modecache.bin";
+    FrameRatePolicy mFrameRatePolicy;
+    HotplugPolicy mHotplugPolicy;
+    bool mTraceEnabled     = false;
+    std::string mTracePath = "/tmp/val-trace.json";
+    std::vector<BufferClass> mBufferClasses;
+    uint64_t mMemoryBudget = 0;
     void parseResolution(DeviceModeResolution &resolution, pbnjson::JValue object);
     void parsePlanes(pbnjson::JValue element);
+    void parseHvsBudget(pbnjson::JValue object);
+    void parseModeCache(pbnjson::JValue object);
+    void parseFrameRatePolicy(pbnjson::JValue object);
+    void parseTrace(pbnjson::JValue object);
+    void parseBufferPool(pbnjson::JValue object);
+    void parseHotplugPolicy(pbnjson::JValue object);
 };
 
 /*according to http://www.raspberrypi.org/phpBB3/viewtopic.php?f=26&t=20155&p=195417&hilit=2560x1600#p195443
@@ -23,15 +23,32 @@
 #include <string>
 
 extern PmLogContext valLogContext;
+
+// Highest level compiled in. Building with -DVAL_LOG_MAX_LEVEL=6 removes LOG_DEBUG entirely; below that, the
+// level of the context is checked before any argument of LOG_INFO and LOG_DEBUG is evaluated.
+#ifndef VAL_LOG_MAX_LEVEL
+#define VAL_LOG_MAX_LEVEL kPmLogLevel_Debug
+#endif
+
+#define LOG_ENABLED(level) ((level) <= VAL_LOG_MAX_LEVEL && PmLogIsEnabled(valLogContext, level))
+
 #define LOG_CRITICAL(msgid, kvcount, ...) PmLogCritical(valLogContext, msgid, kvcount, ##__VA_ARGS__)
 
 #define LOG_ERROR(msgid, kvcount, ...) PmLogError(valLogContext, msgid, kvcount, ##__VA_ARGS__)
 
 #define LOG_WARNING(msgid, kvcount, ...) PmLogWarning(valLogContext, msgid, kvcount, ##__VA_ARGS__)
 
-#define LOG_INFO(msgid, kvcount, ...) PmLogInfo(valLogContext, msgid, kvcount, ##__VA_ARGS__)
+#define LOG_INFO(msgid, kvcount, ...)                                \
+    do {                                                             \
+        if (LOG_ENABLED(kPmLogLevel_Info))                           \
+            PmLogInfo(valLogContext, msgid, kvcount, ##__VA_ARGS__); \
+    } while (0)
 
-#define LOG_DEBUG(fmt, ...) PmLogDebug(valLogContext, "%s:%s() " fmt, __FILE__, __FUNCTION__, ##__VA_ARGS__)
+#define LOG_DEBUG(fmt, ...)                                                                   \
+    do {                                                                                      \
+        if (LOG_ENABLED(kPmLogLevel_Debug))                                                   \
+            PmLogDebug(valLogContext, "%s:%s() " fmt, __FILE__, __FUNCTION__, ##__VA_ARGS__); \
+    } while (0)
 
 #define LOG_ESCAPED_ERRMSG(msgid, errmsg)                           \
     do {                                                            \
@@ -100,6 +117,8 @@ private:
 #define MSGID_UDEV_ERROR "MSGID_UDEV__ERROR"
 #define MSGID_DEVICE_ERROR "MSGID_DEVICE_ERROR"
 #define MSGID_DRM_MODESET_ERROR "MSGID_DRM_MODESET_ERROR"
+#define MSGID_EDID_PARSE_ERROR "EDID_PARSE_ERROR"
+#define MSGID_MODE_CACHE "MODE_CACHE"
 
 // video errors
 #define MSGID_VIDEO_CONNECT_FAILED "VIDEO_CONNECT_FAILED"
@@ -108,6 +127,8 @@ private:
 #define MSGID_SET_ZORDER_FAILED "SET_ZORDER_FAILED"
 #define MSGID_VIDEO_BLANKING_FAILED "VIDEO_BLANKING_FAILED"
 #define MSGID_VIDEO_UNBLANKING_FAILED "VIDEO_UNBLANKING_FAILED"
+#define MSGID_VIDEO_SETTINGS_FAILED "VIDEO_SETTINGS_FAILED"
 #define MSGID_DRM_SET_PLANE_FAILED "DRM_SET_PLANE_FAILED"
 #define MSGID_DRM_SET_PROP_FAILED "MSGID_DRM_SET_PROP_FAILED"
 #define MSGID_MODE_CHANGE_FAILED "MODE_CHANGE_FAILED"
+#define MSGID_HVS_BUDGET_EXCEEDED "HVS_BUDGET_EXCEEDED"
@@ -56,14 +56,17 @@
 #include "libdrm_macros.h"
 #include "xf86drm.h"
 #include "buffers.h"
+#include "bufferPool.h"
+#include "fill.h"
 #include "logging.h"
+#include "trace.h"
 // clang-format on
 
 /* -----------------------------------------------------------------------------
  * Buffers management
  */
 
-static struct bo *bo_create_dumb(int fd, unsigned int width, unsigned int height, unsigned int bpp)
+struct bo *bo_create_dumb(int fd, unsigned int width, unsigned int height, unsigned int bpp)
 {
     struct drm_mode_create_dumb arg;
     struct bo *bo;
@@ -80,7 +83,10 @@ static struct bo *bo_create_dumb(int fd, unsigned int width, unsigned int height
     arg.width  = width;
     arg.height = height;
 
-    ret = drmIoctl(fd, DRM_IOCTL_MODE_CREATE_DUMB, &arg);
+    {
+        TRACE_SCOPE(TRACE_DRM, "DRM_IOCTL_MODE_CREATE_DUMB", width * height);
+        ret = drmIoctl(fd, DRM_IOCTL_MODE_CREATE_DUMB, &arg);
+    }
     if (ret) {
         fprintf(stderr, "failed to create dumb buffer: %s\n", strerror(errno));
         free(bo);
@@ -104,16 +110,23 @@ int bo_map(struct bo *bo, void **out)
         fprintf(stderr, " \n *** bo is null \n");
         return -1;
     }
+    if (bo->ptr) {
+        bo->maps++;
+        *out = bo->ptr;
+        return 0;
+    }
     memset(&arg, 0, sizeof(arg));
     arg.handle = bo->handle;
 
+    TRACE_SCOPE(TRACE_DRM, "bo_map", bo->handle);
     ret = drmIoctl(bo->fd, DRM_IOCTL_MODE_MAP_DUMB, &arg);
     if (ret) {
         LOG_ERROR(MSGID_DRM_MODESET_ERROR, 0, "failed to map dumb buffer -DRM_IOCTL_MODE_MAP_DUMB: %d", ret);
         return ret;
     }
 
-    map = drm_mmap(0, bo->size, PROT_READ | PROT_WRITE, MAP_SHARED, bo->fd, arg.offset);
+    map = drm_mmap(0, bo->size, PROT_READ | PROT_WRITE, MAP_SHARED | (bo->populate ? MAP_POPULATE : 0), bo->fd,
+                   arg.offset);
     if (map == MAP_FAILED) {
         LOG_ERROR(MSGID_DRM_MODESET_ERROR, 0, "failed to map buffer- drm_mmap %d", ret);
         return -EINVAL;
@@ -134,9 +147,26 @@ void bo_unmap(struct bo *bo)
     bo->ptr = NULL;
 }
 
+int bo_fill(struct bo *bo, uint32_t value)
+{
+    void *map;
+    int ret;
+
+    // Every page is about to be written, so fault them in with the mapping rather than one by one.
+    if (bo && !bo->ptr)
+        bo->populate = true;
+    ret = bo_map(bo, &map);
+    if (ret)
+        return ret;
+
+    TRACE_SCOPE(TRACE_DRM, "bo_fill", bo->handle);
+    Fill::fillRows(map, bo->pitch, bo->pitch, bo->size / bo->pitch, value);
+    return 0;
+}
+
 struct bo *bo_create(int fd, unsigned int format, unsigned int width, unsigned int height, unsigned int handles[4],
-                     unsigned int pitches[4],
-                     unsigned int offsets[4]) // enum util_fill_pattern pattern
+                     unsigned int pitches[4], unsigned int offsets[4], BUFFER_PURPOSE_T purpose,
+                     unsigned int owner) // enum util_fill_pattern pattern
 {
     unsigned int virtual_height;
     struct bo *bo;
@@ -224,7 +254,7 @@ struct bo *bo_create(int fd, unsigned int format, unsigned int width, unsigned i
         break;
     }
 
-    bo = bo_create_dumb(fd, width, virtual_height, bpp);
+    bo = BufferPool::instance().acquire(fd, width, virtual_height, bpp, purpose, owner);
     if (!bo)
         return NULL;
 
@@ -311,15 +341,25 @@ struct bo *bo_create(int fd, unsigned int format, unsigned int width, unsigned i
 }
 
 void bo_destroy(struct bo *bo)
+{
+    if (bo)
+        BufferPool::instance().release(bo);
+}
+
+void bo_destroy_dumb(struct bo *bo)
 {
     struct drm_mode_destroy_dumb arg;
     int ret;
     if (!bo)
         return;
+    bo_unmap(bo);
     memset(&arg, 0, sizeof(arg));
     arg.handle = bo->handle;
 
-    ret = drmIoctl(bo->fd, DRM_IOCTL_MODE_DESTROY_DUMB, &arg);
+    {
+        TRACE_SCOPE(TRACE_DRM, "DRM_IOCTL_MODE_DESTROY_DUMB", bo->handle);
+        ret = drmIoctl(bo->fd, DRM_IOCTL_MODE_DESTROY_DUMB, &arg);
+    }
     if (ret) {
         LOG_ERROR(MSGID_DRM_MODESET_ERROR, 0, "failed to destroy dumb buffer: %s", strerror(errno));
     }
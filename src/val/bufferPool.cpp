@@ -0,0 +1,272 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "bufferPool.h"
+#include "buffers.h"
+#include "logging.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+BufferPool &BufferPool::instance()
+{
+    static BufferPool pool;
+    return pool;
+}
+
+void BufferPool::configure(const std::vector<BufferClass> &classes)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mConfig = classes;
+    for (auto &sizeClass : mClasses) {
+        sizeClass.config.count = 0;
+        for (auto &config : mConfig) {
+            if (config.width == sizeClass.config.width && config.height == sizeClass.config.height &&
+                config.bpp == sizeClass.config.bpp)
+                sizeClass.config.count = config.count;
+        }
+    }
+}
+
+void BufferPool::setBudget(uint64_t budget)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mLedger.budget = budget;
+}
+
+void BufferPool::reserve(int fd)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto &config : mConfig) {
+        SizeClass &sizeClass = findClass(fd, config.width, config.height, config.bpp);
+        while (sizeClass.stats.reserved < sizeClass.config.count) {
+            struct bo *bo = allocate(sizeClass, fd, BUFFER_OTHER, 0);
+            if (!bo) {
+                LOG_WARNING(MSGID_BUFFER_CREATION_FAILED, 0, "Reserved %u of %u buffers of %ux%u@%u",
+                            sizeClass.stats.reserved, sizeClass.config.count, config.width, config.height, config.bpp);
+                break;
+            }
+            bo->pooled = true;
+            account(mLedger.pooled, bo, true);
+            sizeClass.freeList.push_back(bo);
+            sizeClass.stats.reserved++;
+            sizeClass.stats.free++;
+        }
+        LOG_INFO(MSGID_DEVICE_STATUS, 0, "Reserved %u buffers of %ux%u@%u", sizeClass.stats.reserved, config.width,
+                 config.height, config.bpp);
+    }
+}
+
+void BufferPool::drain(int fd)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto sizeClass = mClasses.begin(); sizeClass != mClasses.end();) {
+        if (sizeClass->fd != fd) {
+            ++sizeClass;
+            continue;
+        }
+        for (auto bo : sizeClass->freeList) {
+            account(mLedger.pooled, bo, false);
+            destroy(bo);
+        }
+        if (sizeClass->stats.inUse) {
+            LOG_WARNING(MSGID_DEVICE_STATUS, 0, "%u buffers of %ux%u@%u still in use on fd %d",
+                        sizeClass->stats.inUse, sizeClass->config.width, sizeClass->config.height,
+                        sizeClass->config.bpp, fd);
+            sizeClass->freeList.clear();
+            sizeClass->stats.reserved = sizeClass->stats.inUse;
+            sizeClass->stats.free     = 0;
+            ++sizeClass;
+            continue;
+        }
+        sizeClass = mClasses.erase(sizeClass);
+    }
+}
+
+struct bo *BufferPool::acquire(int fd, uint32_t width, uint32_t height, uint32_t bpp, BUFFER_PURPOSE_T purpose,
+                               uint32_t owner)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    SizeClass &sizeClass = findClass(fd, width, height, bpp);
+    struct bo *bo        = nullptr;
+
+    if (!sizeClass.freeList.empty()) {
+        bo = sizeClass.freeList.back();
+        sizeClass.freeList.pop_back();
+        account(mLedger.pooled, bo, false);
+        sizeClass.stats.free--;
+        sizeClass.stats.hits++;
+    } else {
+        bo = allocate(sizeClass, fd, purpose, owner);
+        if (!bo)
+            return nullptr;
+    }
+
+    bo->purpose = purpose;
+    bo->owner   = owner;
+    account(mLedger.purposes[purpose], bo, true);
+    mInUse.push_back(bo);
+
+    sizeClass.stats.inUse++;
+    if (sizeClass.stats.inUse > sizeClass.stats.highWater)
+        sizeClass.stats.highWater = sizeClass.stats.inUse;
+    return bo;
+}
+
+void BufferPool::release(struct bo *bo)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    SizeClass &sizeClass = findClass(bo->fd, bo->width, bo->height, bo->bpp);
+    sizeClass.stats.inUse--;
+    account(mLedger.purposes[bo->purpose], bo, false);
+    mInUse.erase(std::find(mInUse.begin(), mInUse.end(), bo));
+
+    // A buffer that could not be reserved at startup takes the place of the missing one.
+    if (!bo->pooled && sizeClass.stats.reserved < sizeClass.config.count) {
+        bo->pooled = true;
+        sizeClass.stats.reserved++;
+    }
+    if (bo->pooled) {
+        account(mLedger.pooled, bo, true);
+        sizeClass.freeList.push_back(bo);
+        sizeClass.stats.free++;
+        return;
+    }
+    destroy(bo);
+}
+
+std::vector<BufferClassStats> BufferPool::getStats()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::vector<BufferClassStats> stats;
+    stats.reserve(mClasses.size());
+    for (auto &sizeClass : mClasses)
+        stats.push_back(sizeClass.stats);
+    return stats;
+}
+
+MemoryLedger BufferPool::getLedger()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mLedger;
+}
+
+std::vector<BufferRecord> BufferPool::getBuffersInUse()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::vector<BufferRecord> buffers;
+    buffers.reserve(mInUse.size());
+    for (auto bo : mInUse)
+        buffers.push_back({bo->purpose, bo->owner, bo->width, bo->height, bo->size});
+    return buffers;
+}
+
+const char *BufferPool::purposeName(BUFFER_PURPOSE_T purpose)
+{
+    static const char *const names[BUFFER_PURPOSE_COUNT] = {"scanout", "overlay", "pattern", "other"};
+    return purpose < BUFFER_PURPOSE_COUNT ? names[purpose] : "unknown";
+}
+
+BufferPool::SizeClass &BufferPool::findClass(int fd, uint32_t width, uint32_t height, uint32_t bpp)
+{
+    for (auto &sizeClass : mClasses) {
+        if (sizeClass.fd == fd && sizeClass.config.width == width && sizeClass.config.height == height &&
+            sizeClass.config.bpp == bpp)
+            return sizeClass;
+    }
+
+    // Sizes that are not configured are tracked too, so that the stats show what to reserve.
+    SizeClass sizeClass;
+    sizeClass.config.width  = width;
+    sizeClass.config.height = height;
+    sizeClass.config.bpp    = bpp;
+    sizeClass.config.count  = 0;
+    for (auto &config : mConfig) {
+        if (config.width == width && config.height == height && config.bpp == bpp)
+            sizeClass.config.count = config.count;
+    }
+    sizeClass.fd           = fd;
+    sizeClass.stats.width  = width;
+    sizeClass.stats.height = height;
+    sizeClass.stats.bpp    = bpp;
+    mClasses.push_back(sizeClass);
+    return mClasses.back();
+}
+
+struct bo *BufferPool::allocate(SizeClass &sizeClass, int fd, BUFFER_PURPOSE_T purpose, uint32_t owner)
+{
+    // The driver pads the pitch, so this is a lower bound of what the buffer takes.
+    uint64_t estimate = static_cast<uint64_t>(sizeClass.config.width) * sizeClass.config.height *
+                        sizeClass.config.bpp / 8;
+    if (mLedger.budget && mLedger.total.bytes + estimate > mLedger.budget) {
+        char reason[160];
+        snprintf(reason, sizeof(reason), "%ux%u@%u %s buffer for %u needs %llu bytes, %llu of %llu in use",
+                 sizeClass.config.width, sizeClass.config.height, sizeClass.config.bpp, purposeName(purpose), owner,
+                 (unsigned long long)estimate, (unsigned long long)mLedger.total.bytes,
+                 (unsigned long long)mLedger.budget);
+        mLedger.rejections++;
+        mLedger.lastFailure = reason;
+        LOG_ERROR(MSGID_BUFFER_CREATION_FAILED, 0, "Over the graphics memory budget: %s", reason);
+        errno = ENOMEM;
+        return nullptr;
+    }
+
+    auto start    = std::chrono::steady_clock::now();
+    struct bo *bo = bo_create_dumb(fd, sizeClass.config.width, sizeClass.config.height, sizeClass.config.bpp);
+    uint64_t us   = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start)
+                      .count();
+
+    sizeClass.stats.allocations++;
+    sizeClass.stats.latencyUs += us;
+    if (us > sizeClass.stats.maxLatencyUs)
+        sizeClass.stats.maxLatencyUs = us;
+    if (!bo) {
+        int error = errno;
+        sizeClass.stats.failures++;
+        mLedger.lastFailure = std::string(strerror(error)) + " allocating " + std::to_string(sizeClass.config.width) +
+                              "x" + std::to_string(sizeClass.config.height) + " " + purposeName(purpose) + " buffer";
+        LOG_ERROR(MSGID_BUFFER_CREATION_FAILED, 0, "Failed to allocate %ux%u@%u after %llu us (%u in use, peak %u)",
+                  sizeClass.config.width, sizeClass.config.height, sizeClass.config.bpp, (unsigned long long)us,
+                  sizeClass.stats.inUse, sizeClass.stats.highWater);
+        errno = error;
+        return nullptr;
+    }
+    bo->width  = sizeClass.config.width;
+    bo->height = sizeClass.config.height;
+    bo->bpp    = sizeClass.config.bpp;
+    account(mLedger.total, bo, true);
+    return bo;
+}
+
+void BufferPool::destroy(struct bo *bo)
+{
+    account(mLedger.total, bo, false);
+    bo_destroy_dumb(bo);
+}
+
+void BufferPool::account(MemoryUsage &usage, const struct bo *bo, bool add)
+{
+    if (add) {
+        usage.bytes += bo->size;
+        usage.buffers++;
+        usage.peak = std::max(usage.peak, usage.bytes);
+    } else {
+        usage.bytes -= bo->size;
+        usage.buffers--;
+    }
+}
@@ -0,0 +1,119 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "buffers.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Dumb buffers come from CMA on the Pi. After long uptimes the region is too fragmented for large contiguous
+// allocations, so buffers of the sizes that matter are reserved at startup and recycled instead of freed.
+// Sizes are matched exactly; a dumb buffer of height rows includes the chroma planes of YUV formats.
+struct BufferClass {
+    uint32_t width  = 0;
+    uint32_t height = 0;
+    uint32_t bpp    = 32;
+    uint32_t count  = 0; // buffers kept per device
+};
+
+struct BufferClassStats {
+    uint32_t width        = 0;
+    uint32_t height       = 0;
+    uint32_t bpp          = 0;
+    uint32_t reserved     = 0; // buffers owned by the pool, free or in use
+    uint32_t free         = 0;
+    uint32_t inUse        = 0; // pooled or not
+    uint32_t highWater    = 0; // most buffers in use at once
+    uint64_t allocations  = 0; // DRM_IOCTL_MODE_CREATE_DUMB calls, reservations included
+    uint64_t hits         = 0; // requests served from the pool
+    uint64_t failures     = 0; // failed DRM_IOCTL_MODE_CREATE_DUMB calls
+    uint64_t latencyUs    = 0; // total time spent in DRM_IOCTL_MODE_CREATE_DUMB
+    uint64_t maxLatencyUs = 0;
+};
+
+struct MemoryUsage {
+    uint64_t bytes   = 0;
+    uint64_t peak    = 0;
+    uint32_t buffers = 0;
+};
+
+// Every dumb buffer the library holds, by what it is used for. Free buffers kept by the pool count as pooled.
+struct MemoryLedger {
+    uint64_t budget = 0; // bytes, 0 for no limit
+    MemoryUsage total;
+    MemoryUsage pooled;
+    MemoryUsage purposes[BUFFER_PURPOSE_COUNT];
+    uint64_t rejections = 0; // allocations refused for the budget
+    std::string lastFailure;
+};
+
+// A buffer in use, for listing buffers by owner.
+struct BufferRecord {
+    BUFFER_PURPOSE_T purpose;
+    uint32_t owner;
+    uint32_t width;
+    uint32_t height;
+    uint64_t size;
+};
+
+class BufferPool
+{
+public:
+    static BufferPool &instance();
+
+    // Sizes to reserve. Buffers already handed out are not affected.
+    void configure(const std::vector<BufferClass> &classes);
+    // Allocations that would take the buffers held above budget bytes fail before reaching the kernel.
+    void setBudget(uint64_t budget);
+    // Allocates the configured buffers for a device, before anything else competes for CMA.
+    void reserve(int fd);
+    // Destroys the free buffers of a device that is going away. Its buffers still in use are not touched.
+    void drain(int fd);
+
+    // A free pooled buffer of that size if there is one, otherwise a new one. nullptr with errno set on failure.
+    struct bo *acquire(int fd, uint32_t width, uint32_t height, uint32_t bpp, BUFFER_PURPOSE_T purpose = BUFFER_OTHER,
+                       uint32_t owner = 0);
+    // Keeps pooled buffers, and adopts others for classes that are short of their reservation, destroys the rest.
+    void release(struct bo *bo);
+
+    std::vector<BufferClassStats> getStats();
+    MemoryLedger getLedger();
+    std::vector<BufferRecord> getBuffersInUse();
+    static const char *purposeName(BUFFER_PURPOSE_T purpose);
+
+private:
+    struct SizeClass {
+        BufferClass config; // count 0 for sizes that are only tracked
+        int fd = -1;
+        std::vector<struct bo *> freeList;
+        BufferClassStats stats;
+    };
+
+    BufferPool() {}
+    SizeClass &findClass(int fd, uint32_t width, uint32_t height, uint32_t bpp);
+    struct bo *allocate(SizeClass &sizeClass, int fd, BUFFER_PURPOSE_T purpose, uint32_t owner);
+    void destroy(struct bo *bo);
+    static void account(MemoryUsage &usage, const struct bo *bo, bool add);
+
+    std::mutex mMutex;
+    std::vector<BufferClass> mConfig;
+    std::vector<SizeClass> mClasses;
+    std::vector<struct bo *> mInUse;
+    MemoryLedger mLedger;
+};
@@ -40,19 +40,49 @@
  */
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
+/* What a buffer is for, in the memory ledger of the buffer pool. */
+typedef enum {
+    BUFFER_SCANOUT = 0,
+    BUFFER_OVERLAY,
+    BUFFER_PATTERN,
+    BUFFER_OTHER,
+    BUFFER_PURPOSE_COUNT
+} BUFFER_PURPOSE_T;
+
 struct bo {
     int fd;
-    void *ptr;
+    void *ptr; // CPU mapping, created by the first bo_map and kept until bo_unmap or bo_destroy
     size_t size;
     size_t offset;
     size_t pitch;
     unsigned handle;
+    bool populate; // prefault the whole mapping when it is created (MAP_POPULATE)
+    unsigned maps; // bo_map calls served by the existing mapping
+    unsigned width;
+    unsigned height; // rows, including the chroma planes
+    unsigned bpp;
+    bool pooled; // recycled by the buffer pool rather than destroyed
+    BUFFER_PURPOSE_T purpose;
+    unsigned owner; // DRM object the buffer is allocated for, a crtc id for scanout buffers
     // TODO:: Store format here?
 };
 
 struct bo *bo_create(int fd, unsigned int format, unsigned int width, unsigned int height, unsigned int handles[4],
-                     unsigned int pitches[4], unsigned int offsets[4]);
+                     unsigned int pitches[4], unsigned int offsets[4], BUFFER_PURPOSE_T purpose = BUFFER_OTHER,
+                     unsigned int owner = 0);
 void bo_destroy(struct bo *bo);
 
+/* Plain dumb buffer allocation, without the buffer pool in front of it. */
+struct bo *bo_create_dumb(int fd, unsigned int width, unsigned int height, unsigned int bpp);
+void bo_destroy_dumb(struct bo *bo);
+
+/* Returns the persistent mapping of the buffer, mapping it on first use. */
 int bo_map(struct bo *bo, void **out);
+/* Drops the mapping; only needed to give the address space back before bo_destroy. */
 void bo_unmap(struct bo *bo);
+
+/* Fills the whole buffer with a 32 bit value, in bands on the fill threads. */
+int bo_fill(struct bo *bo, uint32_t value);
@@ -16,36 +16,50 @@
 
 #include "driElements.h"
 #include "logging.h"
+#include <cerrno>
+#include <cstring>
 
 extern const char *util_lookup_connector_type_name(unsigned int type);
 
-DrmConnector::DrmConnector(int drmModulefd, drmModeConnectorPtr pConnector)
+DrmConnector::DrmConnector(int drmModulefd, UniqueDrmConnector connector)
 {
-    if (!pConnector || drmModulefd <= 0) {
+    if (!connector || drmModulefd <= 0) {
         THROW_FATAL_EXCEPTION("Invalid connector ");
     }
-    mConnectorPtr = pConnector;
+    mConnectorPtr = std::move(connector);
     mDrmModulefd  = drmModulefd;
-    mName         = util_lookup_connector_type_name(pConnector->connector_type);
+    mName         = util_lookup_connector_type_name(mConnectorPtr->connector_type);
 }
 
 bool DrmConnector::isPlugged()
 {
-    // Reset connectorPtr
-    uint32_t conn_id = 0;
     if (!mConnectorPtr) {
         THROW_FATAL_EXCEPTION("Initialization error -found null connector");
-    } else {
-        conn_id = mConnectorPtr->connector_id;
-        drmModeFreeConnector(mConnectorPtr);
     }
-    mConnectorPtr = drmModeGetConnector(mDrmModulefd, conn_id);
+    uint32_t conn_id = mConnectorPtr->connector_id;
+    TRACE_SCOPE(TRACE_DRM, "drmModeGetConnector", conn_id);
+    UniqueDrmConnector probed(drmModeGetConnector(mDrmModulefd, conn_id));
+    if (!probed) {
+        LOG_ERROR(MSGID_DEVICE_ERROR, 0, "Failed to probe connector %u: %s", conn_id, strerror(errno));
+        return false;
+    }
+    // The previous state is freed here, mode pointers taken from it are no longer valid.
+    mConnectorPtr = std::move(probed);
     return (mConnectorPtr->connection == DRM_MODE_CONNECTED && mConnectorPtr->count_modes != 0);
 }
 
+uint64_t DrmConnector::getModesHash()
+{
+    if (!mConnectorPtr || mConnectorPtr->count_modes <= 0)
+        return 0;
+    return Edid::hash(reinterpret_cast<const unsigned char *>(mConnectorPtr->modes),
+                      mConnectorPtr->count_modes * sizeof(drmModeModeInfo));
+}
+
 bool DrmConnector::getModeRange(DrmDisplayMode &min, DrmDisplayMode &max)
 {
-    if (!isPlugged())
+    // Callers have just probed the connector with isPlugged().
+    if (mConnectorPtr->connection != DRM_MODE_CONNECTED || !mConnectorPtr->count_modes)
         return false;
     // TODO::expecting sorted modes. confirm that it will be always sorted or fixit
     min.mModeInfoPtr = &mConnectorPtr->modes[mConnectorPtr->count_modes - 1];
@@ -69,6 +83,47 @@ DrmDisplayMode DrmConnector::getMode(const std::string mode_name, const uint32_t
     return DrmDisplayMode();
 }
 
+// Returns k if refresh is k times frameRate within FRAME_RATE_TOLERANCE, 0 otherwise.
+static uint32_t getCadence(uint32_t refresh, uint32_t frameRate)
+{
+    uint32_t k = (refresh + frameRate / 2) / frameRate;
+    if (!k)
+        return 0;
+    uint64_t target = static_cast<uint64_t>(frameRate) * k;
+    uint64_t diff   = refresh > target ? refresh - target : target - refresh;
+    return diff * FRAME_RATE_TOLERANCE <= target ? k : 0;
+}
+
+bool isFrameRateCadence(uint32_t refresh, uint32_t frameRate) { return frameRate && getCadence(refresh, frameRate); }
+
+DrmDisplayMode DrmConnector::getModeForFrameRate(uint32_t width, uint32_t height, uint32_t frameRate)
+{
+    drmModeModeInfo *best = nullptr;
+    uint32_t bestCadence  = 0;
+
+    if (!frameRate)
+        return DrmDisplayMode();
+
+    // Prefer the lowest whole multiple of the content rate: 23.976 before 47.952, 25 before 50. Interlaced modes
+    // are only used when there is nothing else.
+    for (int i = 0; i < mConnectorPtr->count_modes; i++) {
+        drmModeModeInfo *mode = &mConnectorPtr->modes[i];
+        if (mode->hdisplay != width || mode->vdisplay != height)
+            continue;
+
+        uint32_t cadence = getCadence(getRefreshMilliHz(*mode), frameRate);
+        if (!cadence)
+            continue;
+        if (mode->flags & DRM_MODE_FLAG_INTERLACE)
+            cadence += MAX_FRAME_RATE_CADENCE;
+        if (!best || cadence < bestCadence) {
+            best        = mode;
+            bestCadence = cadence;
+        }
+    }
+    return best ? DrmDisplayMode(best) : DrmDisplayMode();
+}
+
 bool DrmConnector::isModeSupported(std::string mode_name, const uint32_t vRefresh)
 {
     for (int i = 0; i < mConnectorPtr->count_modes; i++) {
@@ -85,33 +140,26 @@ bool DrmConnector::isModeSupported(std::string mode_name, const uint32_t vRefres
     return false;
 }
 
-Edid DrmConnector::getEdid()
-{
-    int j;
-    drmModePropertyPtr props;
+Edid DrmConnector::getEdid() { return readEdid(mDrmModulefd, *mConnectorPtr); }
 
-    for (j = 0; j < mConnectorPtr->count_props; j++) {
-        props = drmModeGetProperty(mDrmModulefd, mConnectorPtr->props[j]);
+Edid DrmConnector::readEdid(int fd, const drmModeConnector &connector)
+{
+    for (int j = 0; j < connector.count_props; j++) {
+        UniqueDrmProperty props(drmModeGetProperty(fd, connector.props[j]));
 
         if (props) {
 
             if (std::string(props->name) == "EDID") {
                 if (props->flags & DRM_MODE_PROP_BLOB) {
-                    drmModePropertyBlobPtr blob;
-
-                    blob = drmModeGetPropertyBlob(mDrmModulefd, mConnectorPtr->prop_values[j]);
+                    UniqueDrmPropertyBlob blob(drmModeGetPropertyBlob(fd, connector.prop_values[j]));
                     if (blob) {
-                        Edid edid = Edid((unsigned char *)blob->data, blob->length);
-                        drmModeFreePropertyBlob(blob);
-                        drmModeFreeProperty(props);
-                        return edid;
+                        return Edid((unsigned char *)blob->data, blob->length);
                     } else {
-                        THROW_FATAL_EXCEPTION("error getting edid blob %llu", mConnectorPtr->prop_values[j]);
+                        THROW_FATAL_EXCEPTION("error getting edid blob %llu", connector.prop_values[j]);
                     }
                 }
             }
             // TODO:: DPMS property and others.
-            drmModeFreeProperty(props);
         }
     }
     return Edid();
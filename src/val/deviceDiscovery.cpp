@@ -16,13 +16,15 @@
 
 #include "driElements.h"
 #include "logging.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <libudev.h>
-#include <sstream>
 
 static const char *const DEVICE_SUBSYSTEM              = "drm";
 static constexpr uint32_t DISPLAY_PLUGGED_POLL_TIMEOUT = 250;
 
-DRIElements::UDev::UDev(std::function<void(std::string)> fn) :
+DRIElements::UDev::UDev(std::function<void(std::string, uint32_t, bool)> fn) :
 enumerate(nullptr),
 devices(nullptr),
 updateFun(fn)
@@ -50,27 +52,43 @@ gboolean DRIElements::UDev::pollDRIDevices(gpointer userData)
     struct timeval timeout;
     int ret;
     UDev *uDevMonitor = static_cast<UDev *>(userData);
-    FD_ZERO(&fds);
-    FD_SET(uDevMonitor->fd, &fds);
-    timeout.tv_sec  = 0;
-    timeout.tv_usec = 0;
 
-    ret = select(uDevMonitor->fd + 1, &fds, NULL, NULL, &timeout);
-    if (ret > 0 && FD_ISSET(uDevMonitor->fd, &fds)) {
+    // Drain the monitor, so that a burst of events reaches the coalescing in one go rather than one per poll.
+    for (;;) {
+        FD_ZERO(&fds);
+        FD_SET(uDevMonitor->fd, &fds);
+        timeout.tv_sec  = 0;
+        timeout.tv_usec = 0;
+
+        ret = select(uDevMonitor->fd + 1, &fds, NULL, NULL, &timeout);
+        if (ret <= 0 || !FD_ISSET(uDevMonitor->fd, &fds))
+            break;
+
         struct udev_device *dev = udev_monitor_receive_device(uDevMonitor->mon);
-        if (dev) {
-            std::stringstream ss;
-            ss << "Got Device\n";
-            std::string node = udev_device_get_devnode(dev);
-            ss << "\n   Node:  " << node, ss << "\n   Subsystem: " << udev_device_get_subsystem(dev);
-            ss << "\n   Devtype: " << udev_device_get_devtype(dev);
-            ss << "\n   Action: " << udev_device_get_action(dev);
-            udev_device_unref(dev);
-            LOG_INFO(MSGID_DEVICE_STATUS, 0, ss.str().c_str());
-            uDevMonitor->updateFun(node);
-        } else {
+        TRACE_INSTANT(TRACE_UDEV, "udevEvent", dev ? udev_device_get_seqnum(dev) : 0);
+        if (!dev) {
             LOG_ERROR(MSGID_UDEV_ERROR, 0, "No Device from receive_device. An error occured");
+            break;
         }
+        const char *devnode   = udev_device_get_devnode(dev);
+        const char *devtype   = udev_device_get_devtype(dev);
+        const char *action    = udev_device_get_action(dev);
+        const char *hotplug   = udev_device_get_property_value(dev, "HOTPLUG");
+        const char *connector = udev_device_get_property_value(dev, "CONNECTOR");
+        std::string node      = devnode ? devnode : "";
+        // Kernels that know which connector changed name it, otherwise every connector is probed.
+        uint32_t connectorId = connector ? static_cast<uint32_t>(strtoul(connector, nullptr, 10)) : 0;
+        bool isHotplug       = hotplug && !strcmp(hotplug, "1");
+        LOG_INFO(MSGID_DEVICE_STATUS, 0,
+                 "Got Device\n\n   Node:  %s\n   Subsystem: %s\n   Devtype: %s\n   Action: %s\n   Connector: %u",
+                 node.c_str(), udev_device_get_subsystem(dev), devtype ? devtype : "", action ? action : "",
+                 connectorId);
+        // Other change events (leases, properties) do not touch the connectors.
+        bool update  = isHotplug || !action || strcmp(action, "change");
+        bool removed = action && !strcmp(action, "remove");
+        udev_device_unref(dev);
+        if (update)
+            uDevMonitor->updateFun(node, connectorId, removed);
     }
     return true;
 }
@@ -109,3 +127,96 @@ void DRIElements::setupDevicePolling()
 {
     mTimeOutHandle = g_timeout_add(DISPLAY_PLUGGED_POLL_TIMEOUT, DRIElements::UDev::pollDRIDevices, mUDev);
 }
+
+void DRIElements::setHotplugPolicy(uint32_t quietWindow, uint32_t minInterval)
+{
+    mHotplugQuietWindow = quietWindow;
+    mHotplugMinInterval = minInterval;
+}
+
+gint64 DRIElements::hotplugDue(const HotplugState &state) const
+{
+    return std::max(state.lastEvent + mHotplugQuietWindow * G_GINT64_CONSTANT(1000),
+                    state.lastProcessed + mHotplugMinInterval * G_GINT64_CONSTANT(1000));
+}
+
+void DRIElements::queueHotplug(const std::string &node, uint32_t connectorId)
+{
+    gint64 now = g_get_monotonic_time();
+    mHotplugStats.received++;
+
+    HotplugState *state = nullptr, *all = nullptr;
+    for (auto &entry : mHotplugs) {
+        if (entry.node != node)
+            continue;
+        if (entry.connectorId == connectorId)
+            state = &entry;
+        if (!entry.connectorId)
+            all = &entry;
+        // A probe of every connector covers the events of single ones.
+        else if (!connectorId)
+            entry.pending = false;
+    }
+    if (connectorId && all && all->pending) {
+        all->lastEvent = now;
+        scheduleHotplugs();
+        return;
+    }
+    if (!state) {
+        mHotplugs.push_back(HotplugState());
+        state              = &mHotplugs.back();
+        state->node        = node;
+        state->connectorId = connectorId;
+    }
+
+    // The first event after a quiet period, typically a plug, is handled right away. The rest of a burst is
+    // merged into a single update once the connector settles.
+    bool idle = !state->lastProcessed || now - state->lastProcessed >= mHotplugMinInterval * G_GINT64_CONSTANT(1000);
+    if (!state->pending && idle) {
+        state->lastEvent     = now;
+        state->lastProcessed = now;
+        mHotplugStats.processed++;
+        mHotplugStats.leadingEdge++;
+        updateDevice(node, connectorId);
+        return;
+    }
+    state->pending   = true;
+    state->lastEvent = now;
+    scheduleHotplugs();
+}
+
+void DRIElements::scheduleHotplugs()
+{
+    gint64 due = G_MAXINT64;
+    for (auto &state : mHotplugs) {
+        if (state.pending)
+            due = std::min(due, hotplugDue(state));
+    }
+
+    if (mHotplugSource) {
+        g_source_remove(mHotplugSource);
+        mHotplugSource = 0;
+    }
+    if (due == G_MAXINT64)
+        return;
+    gint64 delay   = std::max(due - g_get_monotonic_time(), G_GINT64_CONSTANT(0));
+    mHotplugSource = g_timeout_add(static_cast<guint>((delay + 999) / 1000), onHotplugTimeout, this);
+}
+
+gboolean DRIElements::onHotplugTimeout(gpointer userData)
+{
+    DRIElements *self    = static_cast<DRIElements *>(userData);
+    self->mHotplugSource = 0;
+
+    gint64 now = g_get_monotonic_time();
+    for (auto &state : self->mHotplugs) {
+        if (!state.pending || self->hotplugDue(state) > now)
+            continue;
+        state.pending       = false;
+        state.lastProcessed = now;
+        self->mHotplugStats.processed++;
+        self->updateDevice(state.node, state.connectorId);
+    }
+    self->scheduleHotplugs();
+    return G_SOURCE_REMOVE;
+}
@@ -18,6 +18,7 @@
 #include <cstring>
 #include <fcntl.h>
 #include <glib.h>
+#include <glib-unix.h>
 #include <inttypes.h>
 #include <iostream>
 #include <sstream>
@@ -31,102 +32,448 @@
 
 #define DRM_MODULE "vc4"
 
-DRIElements::DRIElements(VAL_VIDEO_SIZE_T defMode, std::function<void()> p)
-    : mValCallBack(p), mInitialMode(defMode), mConfiguredMode(defMode)
+DRIElements::DRIElements(VAL_VIDEO_SIZE_T defMode, std::function<void(const HotplugChangeSet &)> p,
+                         const std::string &modeCachePath, const std::vector<BufferClass> &bufferClasses,
+                         uint64_t memoryBudget)
+    : mValCallBack(p), mInitialMode(defMode), mConfiguredMode(defMode), mModeCache(modeCachePath)
 {
-    mUDev = new UDev([this](std::string node) { updateDevice(node); });
+    BufferPool::instance().configure(bufferClasses);
+    BufferPool::instance().setBudget(memoryBudget);
+    mUDev = new UDev([this](std::string node, uint32_t connectorId, bool removed) {
+        if (removed)
+            removeDevice(node);
+        else
+            queueHotplug(node, connectorId);
+    });
+    mModeCache.load();
     loadResources();
 
-    auto devPair = mDeviceList.begin();
+    auto devPair = mDeviceList.find(mPrimaryDev);
     if (devPair != mDeviceList.end()) {
         DriDevice &device = devPair->second;
 
-        updateDevice(devPair->first);
+        // With a valid cache the last used modes are set right away and checked against a real probe later,
+        // otherwise every connector is probed before the first modeset.
+        if (mModeCache.isLoaded() && applyCachedModes(device)) {
+            startModeValidation(device);
+        } else {
+            updateDevice(devPair->first);
 
+            for (auto &crtc : device.crtcList) {
+                LOG_DEBUG("\n set Active mode for crtc_id : %d(crtc_index : %d)", crtc.mCrtc->crtc_id,
+                          crtc.crtc_index);
+                device.setActiveMode(crtc, static_cast<uint32_t>(crtc.max.w), static_cast<uint32_t>(crtc.max.h));
+            }
+            storeModeCache(device);
+        }
+    }
+    for (size_t index = 1; index < mDeviceNodes.size(); index++) {
+        DriDevice &device = mDeviceList[mDeviceNodes[index]];
+        updateDevice(device.deviceName);
         for (auto &crtc : device.crtcList) {
-            LOG_DEBUG("\n set Active mode for crtc_id : %d(crtc_index : %d)", crtc.mCrtc->crtc_id, crtc.crtc_index);
-            device.setActiveMode(crtc, static_cast<uint32_t>(crtc.max.w), static_cast<uint32_t>(crtc.max.h));
+            if (crtc.connectors.size())
+                device.setActiveMode(crtc, static_cast<uint32_t>(crtc.max.w), static_cast<uint32_t>(crtc.max.h));
         }
-        mPrimaryDev = devPair->first;
     }
     setupDevicePolling();
 }
 
-void DRIElements::loadResources()
+bool DRIElements::applyCachedModes(DriDevice &device)
 {
-    std::vector<std::string> uDevices = mUDev->getDeviceList();
-    for (auto node : uDevices) {
-        std::string udevNode = node;
-        if (udevNode.find("card") == udevNode.npos) {
+    if (!device.hasDumbBuffChecked) {
+        device.hasDumbBuff();
+        device.hasDumbBuffChecked = true;
+    }
+
+    VAL_VIDEO_SIZE_T confMode = mConfiguredMode;
+    bool applied              = false;
+    for (auto &conn : device.connectorList) {
+        const ModeCache::Entry *entry =
+            mModeCache.find(conn.mConnectorPtr->connector_type, conn.mConnectorPtr->connector_type_id);
+        // The connector state has not been probed yet, only skip connectors already known to be unplugged.
+        if (!entry || !entry->hasChosen || entry->modes.empty() ||
+            conn.mConnectorPtr->connection == DRM_MODE_DISCONNECTED)
+            continue;
+
+        uint32_t crtcId = device.findCrtc(conn);
+        auto crtc       = std::find_if(device.crtcList.begin(), device.crtcList.end(),
+                                 [crtcId](DrmCrtc &c) { return c.mCrtc->crtc_id == crtcId; });
+        if (crtc == device.crtcList.end() || crtc->connectors.size())
+            continue;
+
+        conn.setCrtcId(crtcId);
+        crtc->connectors.insert(conn.mConnectorPtr->connector_id);
+        crtc->setModeRange(entry->modes.back(), entry->modes.front(), confMode);
+
+        drmModeModeInfo mode = entry->chosen;
+        if (device.applyMode(*crtc, mode)) {
+            LOG_WARNING(MSGID_MODE_CACHE, 0, "Failed to set cached mode %s on connector %u", mode.name,
+                        conn.mConnectorPtr->connector_id);
+            conn.setCrtcId(0);
+            crtc->connectors.clear();
             continue;
         }
+        LOG_INFO(MSGID_MODE_CACHE, 0, "Set cached mode %s@%u on connector %u", mode.name, mode.vrefresh,
+                 conn.mConnectorPtr->connector_id);
+        applied = true;
+    }
+    return applied;
+}
 
-        // mDeviceList.emplace(udevNode, DriDevice{});
-        mDeviceList.emplace(std::piecewise_construct, std::make_tuple(udevNode), std::make_tuple());
-        DriDevice &device  = mDeviceList[udevNode];
-        device.deviceName  = udevNode;
-        device.drmModuleFd = open(udevNode.c_str(), O_RDWR | O_CLOEXEC);
-        if (device.drmModuleFd < 0) {
-            // THROW_FATAL_EXCEPTION("Failed to open the card %d", udevNode);
-            LOG_ERROR(MSGID_DEVICE_ERROR, 0, "Failed to open %s", udevNode.c_str());
-            break;
+void DRIElements::startModeValidation(DriDevice &device)
+{
+    std::vector<uint32_t> connectorIds;
+    for (auto &conn : device.connectorList)
+        connectorIds.push_back(conn.mConnectorPtr->connector_id);
+
+    int fd     = device.drmModuleFd;
+    mValidator = std::thread([this, fd, connectorIds]() {
+        std::vector<ProbedConnector> probed;
+        for (auto connId : connectorIds) {
+            // drmModeGetConnector forces a probe, including the DDC transfer of the EDID.
+            TRACE_SCOPE(TRACE_DRM, "drmModeGetConnector", connId);
+            UniqueDrmConnector connector(drmModeGetConnector(fd, connId));
+            if (!connector)
+                continue;
+            uint64_t edidHash = 0;
+            try {
+                edidHash = DrmConnector::readEdid(fd, *connector).getHash();
+            } catch (const FatalException &) {
+                // logged by FatalException, the missing hash invalidates the cache entry
+            }
+            probed.push_back(ProbedConnector{connId, edidHash, std::move(connector)});
         }
 
-        /*
-        // Below should be enabled if videooutputd uses primary planes
-        // without DRM_CLIENT_CAP_UNIVERSAL_PLANES, videooutputd cannot receive information about primary planes
-        if (drmSetClientCap(device.drmModuleFd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1) == 0)
-        {
-                LOG_DEBUG(MSGID_DEVICE_STATUS,0,"DRM_CLIENT_CAP_UNIVERSAL_PLANES is supported");
+        std::lock_guard<std::mutex> lock(mValidationMutex);
+        mProbedConnectors  = std::move(probed);
+        mValidationSource = g_idle_add(onModeValidated, this);
+    });
+}
+
+void DRIElements::stopModeValidation()
+{
+    // The probe uses the descriptor of the device, it has to end before the device is closed.
+    if (mValidator.joinable())
+        mValidator.join();
+    if (mValidationSource)
+        g_source_remove(mValidationSource);
+    mValidationSource = 0;
+    mProbedConnectors.clear();
+}
+
+gboolean DRIElements::onModeValidated(gpointer userData)
+{
+    DRIElements *self = static_cast<DRIElements *>(userData);
+    {
+        std::lock_guard<std::mutex> lock(self->mValidationMutex);
+        self->mValidationSource = 0;
+    }
+    self->validateCachedModes();
+    return G_SOURCE_REMOVE;
+}
+
+void DRIElements::validateCachedModes()
+{
+    if (mValidator.joinable())
+        mValidator.join();
+
+    std::vector<ProbedConnector> probed;
+    probed.swap(mProbedConnectors);
+
+    auto devPair = mDeviceList.find(mPrimaryDev);
+    if (devPair == mDeviceList.end())
+        return;
+    DriDevice &device = devPair->second;
+    bool valid        = true;
+    for (auto &p : probed) {
+        auto conn = std::find_if(device.connectorList.begin(), device.connectorList.end(),
+                                 [&p](DrmConnector &c) { return c.mConnectorPtr->connector_id == p.connectorId; });
+        if (conn == device.connectorList.end())
+            continue;
+        // Adopt the probed state, it replaces the unprobed one read at startup.
+        conn->mConnectorPtr          = std::move(p.connector);
+        const drmModeConnector &info = *conn->mConnectorPtr;
+
+        bool plugged                  = info.connection == DRM_MODE_CONNECTED && info.count_modes;
+        const ModeCache::Entry *entry = mModeCache.find(info.connector_type, info.connector_type_id);
+        if (plugged != (conn->crtc_id != 0) ||
+            (plugged && (!entry || !entry->matches(p.edidHash, info.modes, info.count_modes)))) {
+            LOG_INFO(MSGID_MODE_CACHE, 0, "Mode cache is stale for connector %u", p.connectorId);
+            valid = false;
         }
-        else
-        {
-                LOG_DEBUG(MSGID_DEVICE_ERROR,0,"DRM_CLIENT_CAP_UNIVERSAL_PLANES is not supported");
+    }
+
+    if (valid) {
+        // The cached setup is now the configured one, later hotplug events are compared against it.
+        for (auto &conn : device.connectorList) {
+            conn.configuredPlugged = conn.isPlugged();
+            conn.configuredModes   = conn.configuredPlugged ? conn.getModesHash() : 0;
         }
-        */
-        drmModeResPtr res = drmModeGetResources(device.drmModuleFd);
-        if (!res) {
-            LOG_ERROR(MSGID_DEVICE_ERROR, 0, "Failed to get drm resources for %s", device.deviceName.c_str());
-            break;
+        LOG_INFO(MSGID_MODE_CACHE, 0, "Cached modes confirmed by probe");
+        return;
+    }
+
+    // Fall back to the regular setup with the probed connectors. setupDevice only reports connectors it has set
+    // up before, so the crtcs lit from the cache for a sink that is gone are turned off here.
+    for (auto &crtc : device.crtcList) {
+        bool confirmed = std::any_of(device.connectorList.begin(), device.connectorList.end(), [&](DrmConnector &c) {
+            return crtc.connectors.count(c.mConnectorPtr->connector_id) && c.isPlugged();
+        });
+        if (crtc.connectors.size() && !confirmed && !crtc.idle && crtc.vrefresh && device.disableCrtc(crtc))
+            mCrtcDisables++;
+    }
+    for (auto &conn : device.connectorList)
+        conn.setCrtcId(0);
+    for (auto &crtc : device.crtcList)
+        crtc.connectors.clear();
+    updateDevice(mPrimaryDev);
+    for (auto &crtc : device.crtcList) {
+        if (crtc.connectors.size())
+            device.setActiveMode(crtc, static_cast<uint32_t>(crtc.max.w), static_cast<uint32_t>(crtc.max.h));
+    }
+    storeModeCache(device);
+}
+
+void DRIElements::storeModeCache(DriDevice &device)
+{
+    // Entries are keyed by connector type and index, which are only unique within a device.
+    if (!mModeCache.isEnabled() || device.deviceIndex)
+        return;
+
+    for (auto &conn : device.connectorList) {
+        uint32_t crtcId = conn.crtc_id;
+        auto crtc       = std::find_if(device.crtcList.begin(), device.crtcList.end(),
+                                 [crtcId](DrmCrtc &c) { return c.mCrtc->crtc_id == crtcId; });
+        if (!crtcId || crtc == device.crtcList.end() || !crtc->vrefresh || !conn.mConnectorPtr->count_modes)
+            continue;
+
+        ModeCache::Entry entry;
+        entry.connectorType   = conn.mConnectorPtr->connector_type;
+        entry.connectorTypeId = conn.mConnectorPtr->connector_type_id;
+        entry.edidHash        = conn.getEdid().getHash();
+        entry.hasChosen       = true;
+        entry.chosen          = crtc->mode;
+        entry.modes.assign(conn.mConnectorPtr->modes, conn.mConnectorPtr->modes + conn.mConnectorPtr->count_modes);
+        mModeCache.update(entry);
+    }
+    mModeCache.save();
+}
+
+void DRIElements::loadResources()
+{
+    std::vector<std::string> uDevices = mUDev->getDeviceList();
+    for (auto node : uDevices) {
+        if (node.find("card") == node.npos) {
+            continue;
         }
-        // build crtc list
-        for (int i = 0; i < res->count_crtcs; i++) {
-            DrmCrtc drmCrtc(drmModeGetCrtc(device.drmModuleFd, res->crtcs[i]), static_cast<uint32_t>(i));
-            device.crtcList.push_back(drmCrtc);
+        openDevice(node);
+    }
+
+    // The primary device takes index 0, so that its object ids are used as they are.
+    for (auto &node : uDevices) {
+        auto devPair = mDeviceList.find(node);
+        if (devPair == mDeviceList.end())
+            continue;
+        if (mPrimaryDev.empty())
+            mPrimaryDev = node;
+        if (devPair->second.driverName == PRIMARY_DRM_DRIVER) {
+            mPrimaryDev = node;
+            break;
         }
-        // build connector list
-        for (int i = 0; i < res->count_connectors; i++) {
-            drmModeConnector *connector = drmModeGetConnector(device.drmModuleFd, res->connectors[i]);
-            DrmConnector drmConnector(device.drmModuleFd, connector);
-            device.connectorList.push_back(drmConnector);
+    }
+    if (!mPrimaryDev.empty())
+        mDeviceNodes.push_back(mPrimaryDev);
+    for (auto node : uDevices) {
+        if (node != mPrimaryDev && mDeviceList.count(node)) {
+            mDeviceList[node].deviceIndex = static_cast<uint32_t>(mDeviceNodes.size());
+            mDeviceNodes.push_back(node);
         }
+    }
+}
 
-        // build encoder list
-        for (int i = 0; i < res->count_encoders; i++) {
-            DrmEncoder drmEncoder(drmModeGetEncoder(device.drmModuleFd, res->encoders[i]));
-            device.encoderList.push_back(drmEncoder);
-        }
+bool DRIElements::openDevice(const std::string &node)
+{
+    int fd = open(node.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        // THROW_FATAL_EXCEPTION("Failed to open the card %d", udevNode);
+        LOG_ERROR(MSGID_DEVICE_ERROR, 0, "Failed to open %s", node.c_str());
+        return false;
+    }
 
-        // build plane list
-        drmModePlaneResPtr planeRes = drmModeGetPlaneResources(device.drmModuleFd);
+    mDeviceList.emplace(std::piecewise_construct, std::make_tuple(node), std::make_tuple());
+    DriDevice &device  = mDeviceList[node];
+    device.deviceName  = node;
+    device.drmModuleFd = fd;
+    UniqueDrmVersion version(drmGetVersion(fd));
+    if (version)
+        device.driverName.assign(version->name, version->name_len);
+    LOG_INFO(MSGID_DEVICE_STATUS, 0, "Opened %s, driver %s", node.c_str(), device.driverName.c_str());
+
+    bool primary = device.driverName == PRIMARY_DRM_DRIVER;
+    if (primary) {
+        // Scanout buffers are reserved before the first modeset, while CMA is least fragmented.
+        BufferPool::instance().reserve(device.drmModuleFd);
+    }
 
-        if (!planeRes) {
-            LOG_ERROR(MSGID_DEVICE_ERROR, 0, "drmModeGetPlaneResources failed: %s\n", strerror(errno));
-            break;
+    // Primary planes are only reported with DRM_CLIENT_CAP_UNIVERSAL_PLANES. They are not handed out to
+    // videooutputd, but are tracked per crtc so that they can be detached when a video plane covers them.
+    device.hasUniversalPlanes = (drmSetClientCap(device.drmModuleFd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1) == 0);
+    if (!device.hasUniversalPlanes) {
+        LOG_INFO(MSGID_DEVICE_STATUS, 0, "DRM_CLIENT_CAP_UNIVERSAL_PLANES is not supported");
+    }
+
+    UniqueDrmRes res(drmModeGetResources(device.drmModuleFd));
+    if (!res) {
+        LOG_ERROR(MSGID_DEVICE_ERROR, 0, "Failed to get drm resources for %s", device.deviceName.c_str());
+        mDeviceList.erase(node);
+        return false;
+    }
+    // build crtc list
+    device.crtcList.reserve(res->count_crtcs);
+    for (int i = 0; i < res->count_crtcs; i++) {
+        UniqueDrmCrtc crtc(drmModeGetCrtc(device.drmModuleFd, res->crtcs[i]));
+        if (!crtc) {
+            LOG_ERROR(MSGID_DEVICE_ERROR, 0, "Failed to get crtc %u: %s", res->crtcs[i], strerror(errno));
+            continue;
         }
+        device.crtcList.emplace_back(std::move(crtc), static_cast<uint32_t>(i));
+        DrmCrtc &drmCrtc = device.crtcList.back();
+        device.getProperty(res->crtcs[i], DRM_MODE_OBJECT_CRTC, "GAMMA_LUT", drmCrtc.gammaLut);
+        device.getProperty(res->crtcs[i], DRM_MODE_OBJECT_CRTC, "GAMMA_LUT_SIZE", drmCrtc.gammaLutSize);
+        device.getProperty(res->crtcs[i], DRM_MODE_OBJECT_CRTC, "CTM", drmCrtc.ctm);
+    }
+    // build connector list
+    device.connectorList.reserve(res->count_connectors);
+    for (int i = 0; i < res->count_connectors; i++) {
+        // Without forcing a probe when the modes are taken from the cache, the probe is done asynchronously.
+        UniqueDrmConnector connector(primary && mModeCache.isLoaded()
+                                         ? drmModeGetConnectorCurrent(device.drmModuleFd, res->connectors[i])
+                                         : drmModeGetConnector(device.drmModuleFd, res->connectors[i]));
+        if (connector)
+            device.connectorList.emplace_back(device.drmModuleFd, std::move(connector));
+    }
+
+    // build encoder list
+    device.encoderList.reserve(res->count_encoders);
+    for (int i = 0; i < res->count_encoders; i++)
+        device.encoderList.emplace_back(UniqueDrmEncoder(drmModeGetEncoder(device.drmModuleFd, res->encoders[i])));
+
+    // build plane list
+    UniqueDrmPlaneRes planeRes(drmModeGetPlaneResources(device.drmModuleFd));
 
-        for (size_t i = 0; i < planeRes->count_planes; i++) {
-            drmModePlane *plane = drmModeGetPlane(device.drmModuleFd, planeRes->planes[i]);
-            if (getPlaneType(device.drmModuleFd, plane->plane_id) != CURSOR) {
-                DrmPlane drmPlane(plane);
-                device.planeList.push_back(drmPlane);
+    if (!planeRes) {
+        LOG_ERROR(MSGID_DEVICE_ERROR, 0, "drmModeGetPlaneResources failed: %s\n", strerror(errno));
+        mDeviceList.erase(node);
+        return false;
+    }
+
+    device.planeList.reserve(planeRes->count_planes);
+    for (size_t i = 0; i < planeRes->count_planes; i++) {
+        UniqueDrmPlane plane(drmModeGetPlane(device.drmModuleFd, planeRes->planes[i]));
+        if (!plane)
+            continue;
+        PLANE_TYPES_T planeType = getPlaneType(device.drmModuleFd, plane->plane_id);
+        if (planeType == PRIMARY) {
+            for (auto &crtc : device.crtcList) {
+                if ((plane->possible_crtcs & (1 << crtc.crtc_index)) && !crtc.primaryPlaneId) {
+                    crtc.primaryPlaneId = plane->plane_id;
+                    break;
+                }
             }
+        } else if (planeType != CURSOR) {
+            uint32_t planeId = plane->plane_id;
+            device.planeList.emplace_back(std::move(plane));
+            DrmPlane &drmPlane = device.planeList.back();
+            device.getProperty(planeId, DRM_MODE_OBJECT_PLANE, "zpos", drmPlane.zpos);
+            device.getProperty(planeId, DRM_MODE_OBJECT_PLANE, "alpha", drmPlane.alpha);
+            device.getProperty(planeId, DRM_MODE_OBJECT_PLANE, "pixel blend mode", drmPlane.blendMode);
+            device.getProperty(planeId, DRM_MODE_OBJECT_PLANE, "rotation", drmPlane.rotation);
+            device.getProperty(planeId, DRM_MODE_OBJECT_PLANE, "COLOR_ENCODING", drmPlane.colorEncoding);
+            device.getProperty(planeId, DRM_MODE_OBJECT_PLANE, "COLOR_RANGE", drmPlane.colorRange);
         }
     }
+
+    if (device.planeList.size())
+        device.createBlankFb();
+    device.worker.reset(new CommitWorker);
+    return true;
+}
+
+void DRIElements::addDevice(const std::string &node)
+{
+    if (!openDevice(node))
+        return;
+
+    DriDevice &device = mDeviceList[node];
+    device.deviceIndex = static_cast<uint32_t>(mDeviceNodes.size());
+    mDeviceNodes.push_back(node);
+    if (mPrimaryDev.empty())
+        mPrimaryDev = node;
+    LOG_INFO(MSGID_DEVICE_STATUS, 0, "Added %s as device %u", node.c_str(), device.deviceIndex);
+
+    // The outputs come up as if they had all been plugged at once.
+    updateDevice(node);
+    for (auto &crtc : device.crtcList) {
+        if (crtc.connectors.size())
+            device.setActiveMode(crtc, static_cast<uint32_t>(crtc.max.w), static_cast<uint32_t>(crtc.max.h));
+    }
+    storeModeCache(device);
+}
+
+void DRIElements::removeDevice(const std::string &node)
+{
+    auto devPair = mDeviceList.find(node);
+    if (devPair == mDeviceList.end())
+        return;
+
+    DriDevice &device = devPair->second;
+    cancelModeChange(device);
+    if (node == mPrimaryDev)
+        stopModeValidation();
+
+    HotplugChangeSet changes;
+    for (auto &conn : device.connectorList) {
+        if (!conn.configuredPlugged)
+            continue;
+        HotplugChange change;
+        change.connectorId = device.toGlobalId(conn.mConnectorPtr->connector_id);
+        change.crtcId      = device.toGlobalId(conn.crtc_id);
+        change.wasPlugged  = true;
+        changes.push_back(change);
+    }
+    LOG_INFO(MSGID_DEVICE_STATUS, 0, "Removed %s, device %u, with %zu connected outputs", node.c_str(),
+             device.deviceIndex, changes.size());
+
+    mHotplugs.erase(std::remove_if(mHotplugs.begin(), mHotplugs.end(),
+                                   [&node](const HotplugState &state) { return state.node == node; }),
+                    mHotplugs.end());
+    uint32_t index = device.deviceIndex;
+    mFades.erase(std::remove_if(mFades.begin(), mFades.end(),
+                                [index](const PlaneFade &fade) { return fade.planeId >> DEVICE_ID_SHIFT == index; }),
+                 mFades.end());
+    mDeviceNodes[device.deviceIndex].clear();
+    if (node == mPrimaryDev)
+        mPrimaryDev.clear();
+    mDeviceList.erase(devPair);
+
+    // Windows on the device see their crtc go away.
+    if (changes.size())
+        mValCallBack(changes);
+}
+
+DriDevice *DRIElements::findDevice(uint32_t id, uint32_t &objectId)
+{
+    uint32_t index = id >> DEVICE_ID_SHIFT;
+    objectId       = id & DEVICE_OBJECT_MASK;
+    if (index >= mDeviceNodes.size() || mDeviceNodes[index].empty())
+        return nullptr;
+    auto devPair = mDeviceList.find(mDeviceNodes[index]);
+    return devPair != mDeviceList.end() ? &devPair->second : nullptr;
 }
 
-void DRIElements::updateDevice(std::string name) // callback from udev
+void DRIElements::updateDevice(std::string name, uint32_t connectorId) // callback from udev
 {
+    TRACE_SCOPE(TRACE_UDEV, "updateDevice", connectorId);
 
     LOG_DEBUG("Update device called \n************************\n");
     VAL_VIDEO_SIZE_T maxSize, minSize;
@@ -142,57 +489,211 @@ void DRIElements::updateDevice(std::string name) // callback from udev
             confMode.h = mConfiguredMode.h;
         }
 
-        device.setupDevice(confMode);
-
-        mValCallBack();
+        HotplugChangeSet changes;
+        device.setupDevice(confMode, connectorId, changes);
+        for (auto &change : changes) {
+            LOG_INFO(MSGID_DEVICE_STATUS, 0, "Connector %u of %s %s%s on crtc %u", change.connectorId, name.c_str(),
+                     change.plugged ? (change.wasPlugged ? "changed" : "plugged") : "unplugged",
+                     change.modesChanged ? ", modes changed" : "", change.crtcId);
+        }
+        updateCrtcPower(device, changes);
+        for (auto &change : changes) {
+            change.connectorId = device.toGlobalId(change.connectorId);
+            change.crtcId      = device.toGlobalId(change.crtcId);
+        }
+        if (changes.size())
+            mValCallBack(changes);
 
+    } else if (name.find("card") != name.npos) {
+        addDevice(name);
     } else {
-        LOG_ERROR(MSGID_DEVICE_ERROR, 0, "Cannot handle new DRM device detected %s", name.c_str());
+        LOG_DEBUG("Ignoring event for %s", name.c_str());
+    }
+}
+
+void DRIElements::updateCrtcPower(DriDevice &device, const HotplugChangeSet &changes)
+{
+    // A modeset in flight owns the scanout buffers.
+    if (device.modeChange)
+        return;
+
+    for (auto &change : changes) {
+        uint32_t crtcId = change.crtcId;
+        auto crtc       = std::find_if(device.crtcList.begin(), device.crtcList.end(),
+                                 [crtcId](DrmCrtc &c) { return c.mCrtc->crtc_id == crtcId; });
+        if (crtc == device.crtcList.end())
+            continue;
+
+        if (!change.plugged && !crtc->idle && crtc->vrefresh) {
+            bool sinkLeft = std::any_of(device.connectorList.begin(), device.connectorList.end(), [&](DrmConnector &c) {
+                return crtc->connectors.count(c.mConnectorPtr->connector_id) && c.configuredPlugged;
+            });
+            if (!sinkLeft && device.disableCrtc(*crtc))
+                mCrtcDisables++;
+        } else if (change.plugged && crtc->idle) {
+            // The last mode comes back without another search when the sink still offers it.
+            auto conn = std::find_if(device.connectorList.begin(), device.connectorList.end(), [&](DrmConnector &c) {
+                return c.mConnectorPtr->connector_id == change.connectorId;
+            });
+            bool offered = false;
+            for (int i = 0; conn != device.connectorList.end() && i < conn->mConnectorPtr->count_modes; i++)
+                offered |= !memcmp(&conn->mConnectorPtr->modes[i], &crtc->mode, sizeof(crtc->mode));
+            int ret = offered ? device.applyMode(*crtc, crtc->mode)
+                              : device.setActiveMode(*crtc, static_cast<uint32_t>(crtc->max.w),
+                                                     static_cast<uint32_t>(crtc->max.h));
+            if (ret) {
+                LOG_ERROR(MSGID_MODE_CHANGE_FAILED, 0, "Failed to turn crtc %u back on", crtcId);
+                continue;
+            }
+            crtc->idle       = false;
+            crtc->idleBytes  = 0;
+            crtc->idleFetch  = 0;
+            crtc->displayOff = false; // a modeset turns the sink on
+            LOG_INFO(MSGID_DEVICE_STATUS, 0, "crtc %u back on with %s", crtcId, crtc->mode.name);
+        }
     }
 }
 
 int DRIElements::changeMode(uint32_t width, uint32_t height, uint8_t display_path, uint32_t vRefresh)
 {
-    // RPI has Single card, so use device
-    DriDevice &device = mDeviceList[mPrimaryDev];
+    ModeChange change;
+    DriDevice *device = beginModeChange(width, height, display_path, vRefresh, change);
+    if (!device)
+        return false;
+    change.commit();
+    return endModeChange(*device, change);
+}
+
+bool DRIElements::changeModeAsync(uint32_t width, uint32_t height, uint8_t display_path, uint32_t vRefresh,
+                                  std::function<void(bool)> done)
+{
+    std::unique_ptr<ModeChange> change(new ModeChange);
+    DriDevice *device = beginModeChange(width, height, display_path, vRefresh, *change);
+    if (!device)
+        return false;
+    change->done       = done;
+    change->owner      = this;
+    change->device     = device;
+    device->modeChange = std::move(change);
+
+    // The commit queues behind the plane updates already posted for the device.
+    ModeChange *job = device->modeChange.get();
+    device->worker->post(0, [job]() {
+        job->commit();
+        std::lock_guard<std::mutex> lock(job->device->modeChangeMutex);
+        job->device->modeChangeSource = g_idle_add(onModeChanged, job);
+    });
+    return true;
+}
+
+gboolean DRIElements::onModeChanged(gpointer userData)
+{
+    ModeChange *job   = static_cast<ModeChange *>(userData);
+    DriDevice *device = job->device;
+    {
+        std::lock_guard<std::mutex> lock(device->modeChangeMutex);
+        device->modeChangeSource = 0;
+    }
+
+    std::unique_ptr<ModeChange> change = std::move(device->modeChange);
+    bool ok                            = change->owner->endModeChange(*device, *change);
+    if (change->done)
+        change->done(ok);
+    return G_SOURCE_REMOVE;
+}
+
+void DRIElements::cancelModeChange(DriDevice &device)
+{
+    if (!device.modeChange)
+        return;
+
+    // Let the commit finish, the buffers it uses are released with the device.
+    device.worker.reset();
+    {
+        std::lock_guard<std::mutex> lock(device.modeChangeMutex);
+        if (device.modeChangeSource)
+            g_source_remove(device.modeChangeSource);
+        device.modeChangeSource = 0;
+    }
+    std::unique_ptr<ModeChange> change = std::move(device.modeChange);
+    device.finishModeChange(*change);
+    if (change->done)
+        change->done(false);
+}
+
+bool DRIElements::isModeChangePending()
+{
+    return std::any_of(mDeviceList.begin(), mDeviceList.end(),
+                       [](const std::pair<const std::string, DriDevice> &d) { return d.second.modeChange != nullptr; });
+}
 
+DriDevice *DRIElements::beginModeChange(uint32_t width, uint32_t height, uint8_t display_path, uint32_t vRefresh,
+                                        ModeChange &change)
+{
     // find connector based on display path
     // It is assumed that the connectorList stores the display in order from the primary.
-    //(display_path 0 means primary display, 1 means secondary display.)
-    uint8_t dIdx     = 0;
-    uint32_t crtc_id = 0;
-    for (auto &conn : device.connectorList) {
-        if (conn.isPlugged() && (dIdx == display_path)) {
-            crtc_id = conn.crtc_id;
-            break;
+    //(display_path 0 means primary display, 1 means secondary display.) Display paths continue over the
+    // connectors of the other devices, in the order they were added.
+    uint8_t dIdx      = 0;
+    uint32_t crtc_id  = 0;
+    DriDevice *device = nullptr;
+    for (auto &node : mDeviceNodes) {
+        auto devPair = mDeviceList.find(node);
+        if (devPair == mDeviceList.end())
+            continue;
+        for (auto &conn : devPair->second.connectorList) {
+            if (conn.isPlugged() && (dIdx == display_path)) {
+                crtc_id = conn.crtc_id;
+                device  = &devPair->second;
+                break;
+            }
+            dIdx++;
         }
-        dIdx++;
+        if (device)
+            break;
     }
+    if (!device)
+        return nullptr;
 
-    for (auto &crtc : device.crtcList) {
-        if (crtc.mCrtc->crtc_id == crtc_id) {
-            if (!device.setActiveMode(crtc, width, height)) {
-                // TODO:: Once set this value is not used .. remove it?
-                crtc.max.w = width;
-                crtc.max.h = height;
-                // change mConfigResolution instead
-                mConfiguredMode.h = height;
-                mConfiguredMode.w = width;
-                return true;
-            }
-            break;
-        }
+    if (device->modeChange) {
+        LOG_WARNING(MSGID_MODE_CHANGE_FAILED, 0, "A mode change is already in progress on %s",
+                    device->deviceName.c_str());
+        return nullptr;
     }
 
-    return false;
+    auto crtc = std::find_if(device->crtcList.begin(), device->crtcList.end(),
+                             [crtc_id](DrmCrtc &c) { return c.mCrtc->crtc_id == crtc_id; });
+    drmModeModeInfo mode;
+    if (crtc == device->crtcList.end() || !device->findMode(*crtc, width, height, vRefresh, mode))
+        return nullptr;
+    device->prepareModeChange(*crtc, mode, change);
+    return device;
 }
 
-bool DRIElements::getModeRange(uint32_t crtcId, VAL_VIDEO_SIZE_T &minSize, VAL_VIDEO_SIZE_T &maxSize)
+bool DRIElements::endModeChange(DriDevice &device, ModeChange &change)
 {
-    DriDevice &device = mDeviceList[mPrimaryDev];
-    auto crtc         = std::find_if(device.crtcList.begin(), device.crtcList.end(),
-                             [crtcId](DrmCrtc &c) { return c.mCrtc->crtc_id == crtcId; });
+    if (device.finishModeChange(change))
+        return false;
+
+    auto crtc = std::find_if(device.crtcList.begin(), device.crtcList.end(),
+                             [&change](DrmCrtc &c) { return c.mCrtc->crtc_id == change.crtcId; });
     if (crtc != device.crtcList.end()) {
+        // TODO:: Once set this value is not used .. remove it?
+        crtc->max.w = change.mode.hdisplay;
+        crtc->max.h = change.mode.vdisplay;
+    }
+    // change mConfigResolution instead
+    mConfiguredMode.h = change.mode.vdisplay;
+    mConfiguredMode.w = change.mode.hdisplay;
+    storeModeCache(device);
+    return true;
+}
+
+bool DRIElements::getModeRange(uint32_t crtcId, VAL_VIDEO_SIZE_T &minSize, VAL_VIDEO_SIZE_T &maxSize)
+{
+    DriDevice *device = nullptr;
+    DrmCrtc *crtc     = findCrtc(crtcId, device);
+    if (crtc) {
         minSize.w = crtc->min.w;
         minSize.h = crtc->min.h;
         maxSize.w = crtc->max.w;
@@ -202,6 +703,69 @@ bool DRIElements::getModeRange(uint32_t crtcId, VAL_VIDEO_SIZE_T &minSize, VAL_V
     return false;
 }
 
+bool DRIElements::getActiveMode(uint32_t crtcId, VAL_VIDEO_SIZE_T &size, uint32_t &vRefresh)
+{
+    DriDevice *device = nullptr;
+    DrmCrtc *crtc     = findCrtc(crtcId, device);
+    if (crtc && crtc->vrefresh) {
+        size     = crtc->active;
+        vRefresh = crtc->vrefresh;
+        return true;
+    }
+    return false;
+}
+
+bool DRIElements::getCurrentMode(uint32_t crtcId, drmModeModeInfo &mode)
+{
+    DriDevice *device = nullptr;
+    DrmCrtc *crtc     = findCrtc(crtcId, device);
+    if (!crtc || !crtc->vrefresh)
+        return false;
+    mode = crtc->mode;
+    return true;
+}
+
+bool DRIElements::findModeForFrameRate(uint32_t crtcId, uint32_t frameRate, drmModeModeInfo &mode)
+{
+    DriDevice *device = nullptr;
+    DrmCrtc *crtc     = findCrtc(crtcId, device);
+    if (!crtc || !crtc->vrefresh)
+        return false;
+
+    // Keep the resolution, only the refresh rate follows the content.
+    for (auto &conn : device->connectorList) {
+        if (!crtc->connectors.count(conn.mConnectorPtr->connector_id))
+            continue;
+        DrmDisplayMode match = conn.getModeForFrameRate(crtc->active.w, crtc->active.h, frameRate);
+        if (match.mModeInfoPtr) {
+            mode = *match.mModeInfoPtr;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DRIElements::setMode(uint32_t crtcId, const drmModeModeInfo &mode)
+{
+    DriDevice *device = nullptr;
+    DrmCrtc *crtc     = findCrtc(crtcId, device);
+    if (!crtc || !crtc->connectors.size())
+        return false;
+    if (device->modeChange) {
+        LOG_WARNING(MSGID_MODE_CHANGE_FAILED, 0, "A mode change is already in progress");
+        return false;
+    }
+    if (crtc->vrefresh && !memcmp(&crtc->mode, &mode, sizeof(mode)))
+        return true;
+
+    drmModeModeInfo info = mode;
+    if (device->applyMode(*crtc, info))
+        return false;
+    LOG_INFO(MSGID_DEVICE_STATUS, 0, "crtc %u set to %s@%.3f", crtcId, info.name, getRefreshMilliHz(info) / 1000.0);
+    storeModeCache(*device);
+    return true;
+}
+
 int DriDevice::geModeRange(VAL_VIDEO_SIZE_T &minSize, VAL_VIDEO_SIZE_T &maxSize)
 {
     // Get the min and max from the first valid connector to notify val
@@ -223,7 +787,7 @@ int DriDevice::geModeRange(VAL_VIDEO_SIZE_T &minSize, VAL_VIDEO_SIZE_T &maxSize)
     return -1;
 }
 
-int DriDevice::setupDevice(VAL_VIDEO_SIZE_T &confMode)
+int DriDevice::setupDevice(VAL_VIDEO_SIZE_T &confMode, uint32_t connectorId, HotplugChangeSet &changes)
 {
     if (!hasDumbBuffChecked) {
         hasDumbBuff();
@@ -231,82 +795,83 @@ int DriDevice::setupDevice(VAL_VIDEO_SIZE_T &confMode)
     }
 
     for (auto &conn : connectorList) {
-        uint32_t crtcId = 0;
-        uint32_t connId = conn.mConnectorPtr->connector_id;
-        if (!conn.isPlugged())
+        if (connectorId && conn.mConnectorPtr->connector_id != connectorId)
             continue;
 
-        crtcId = findCrtc(conn);
+        HotplugChange change;
+        change.connectorId  = conn.mConnectorPtr->connector_id;
+        change.wasPlugged   = conn.configuredPlugged;
+        change.plugged      = conn.isPlugged();
+        uint64_t modes      = change.plugged ? conn.getModesHash() : 0;
+        change.modesChanged = change.plugged && modes != conn.configuredModes;
 
-        if (!crtcId) {
-            LOG_ERROR(MSGID_DEVICE_ERROR, 0, "no valid crtc for connector %d", conn.mConnectorPtr->connector_id);
+        // Other outputs, and connectors that still look the same, are left alone.
+        if (change.plugged == change.wasPlugged && !change.modesChanged && (!change.plugged || conn.crtc_id))
             continue;
-        }
 
-        // associate crtcId to connector. used if planes are updated based on connector name
-        conn.setCrtcId(crtcId);
-        DrmDisplayMode min, max;
-        conn.getModeRange(min, max);
-        // associate the connector to crtcz
-        auto crtc =
-            std::find_if(crtcList.begin(), crtcList.end(), [crtcId](DrmCrtc &c) { return c.mCrtc->crtc_id == crtcId; });
-        if (crtc != crtcList.end()) {
-            if (crtc->connectors.size())
-                crtc->connectors.clear();
-            crtc->connectors.insert(connId);
-
-            if ((max.mModeInfoPtr->hdisplay < confMode.w || max.mModeInfoPtr->vdisplay < confMode.h) &&
-                max.mModeInfoPtr->hdisplay != 0 && max.mModeInfoPtr->vdisplay != 0) {
-                crtc->max.w = max.mModeInfoPtr->hdisplay;
-                crtc->max.h = max.mModeInfoPtr->vdisplay;
-            } else {
-                crtc->max.w = confMode.w;
-                crtc->max.h = confMode.h;
-            }
-            crtc->min.w = min.mModeInfoPtr->hdisplay;
-            crtc->min.h = min.mModeInfoPtr->vdisplay;
-        }
+        conn.configuredPlugged = change.plugged;
+        conn.configuredModes   = modes;
+        if (change.plugged)
+            setupConnector(conn, confMode);
+        change.crtcId = conn.crtc_id;
+        changes.push_back(change);
     }
     return 0;
 }
 
+void DriDevice::setupConnector(DrmConnector &conn, VAL_VIDEO_SIZE_T &confMode)
+{
+    uint32_t connId = conn.mConnectorPtr->connector_id;
+    uint32_t crtcId = findCrtc(conn);
+
+    if (!crtcId) {
+        LOG_ERROR(MSGID_DEVICE_ERROR, 0, "no valid crtc for connector %d", connId);
+        return;
+    }
+
+    // associate crtcId to connector. used if planes are updated based on connector name
+    conn.setCrtcId(crtcId);
+    DrmDisplayMode min, max;
+    if (!conn.getModeRange(min, max))
+        return;
+    // associate the connector to crtcz
+    auto crtc =
+        std::find_if(crtcList.begin(), crtcList.end(), [crtcId](DrmCrtc &c) { return c.mCrtc->crtc_id == crtcId; });
+    if (crtc != crtcList.end()) {
+        if (crtc->connectors.size())
+            crtc->connectors.clear();
+        crtc->connectors.insert(connId);
+
+        crtc->setModeRange(*min.mModeInfoPtr, *max.mModeInfoPtr, confMode);
+    }
+}
+
 uint32_t DriDevice::findCrtc(DrmConnector &conn)
 {
-    drmModeEncoder *enc = nullptr;
-    int32_t crtc        = 0;
+    UniqueDrmEncoder enc;
+    uint32_t crtc = 0;
     /* try the currently conected encoder+crtc */
     if (conn.mConnectorPtr->encoder_id) {
-        enc = drmModeGetEncoder(drmModuleFd, conn.mConnectorPtr->encoder_id);
+        enc.reset(drmModeGetEncoder(drmModuleFd, conn.mConnectorPtr->encoder_id));
     }
     if (enc) {
-        if (enc->crtc_id) {
-            crtc = enc->crtc_id;
-        }
-        drmModeFreeEncoder(enc);
-        return crtc;
+        return enc->crtc_id;
     }
 
-    drmModeResPtr res = drmModeGetResources(drmModuleFd);
-
-    /* if connector does not have encoder+crtc connected*/
+    /* if connector does not have encoder+crtc connected, take a crtc it can use, by its index in crtcList */
     for (int i = 0; i < conn.mConnectorPtr->count_encoders; i++) {
-        enc = drmModeGetEncoder(drmModuleFd, conn.mConnectorPtr->encoders[i]);
+        enc.reset(drmModeGetEncoder(drmModuleFd, conn.mConnectorPtr->encoders[i]));
         if (!enc) {
             LOG_DEBUG("encoder associated with connector not found");
             continue;
         }
-        for (int j = 0; j < res->count_crtcs; j++) {
-            if (!(enc->possible_crtcs & (1 << j))) {
-                continue;
-            }
-            crtc = res->crtcs[j];
-            if (crtc >= 0) {
+        for (auto &c : crtcList) {
+            if (enc->possible_crtcs & (1 << c.crtc_index)) {
+                crtc = c.mCrtc->crtc_id;
                 break;
             }
         }
-        drmModeFreeEncoder(enc);
     }
-    drmModeFreeResources(res);
     return crtc;
 }
 
@@ -345,13 +910,22 @@ uint32_t DriDevice::findConnector(uint32_t planeId)
 
 int DriDevice::setActiveMode(DrmCrtc &crtc, const uint32_t width, const uint32_t height, const uint32_t vRefresh)
 {
-    std::stringstream modeStr;
-    modeStr << width << "x" << height;
-    LOG_DEBUG("\n setActiveMode to %s", modeStr.str().c_str());
+    drmModeModeInfo mode;
+    if (!findMode(crtc, width, height, vRefresh, mode))
+        return -1;
+    return applyMode(crtc, mode);
+}
+
+bool DriDevice::findMode(DrmCrtc &crtc, const uint32_t width, const uint32_t height, const uint32_t vRefresh,
+                         drmModeModeInfo &found)
+{
+    char modeName[DRM_DISPLAY_MODE_LEN];
+    snprintf(modeName, sizeof(modeName), "%ux%u", width, height);
+    LOG_DEBUG("\n setActiveMode to %s", modeName);
     // If there are no connectors dont set mode.
     if (!crtc.connectors.size()) {
         LOG_INFO(MSGID_DEVICE_STATUS, 0, "No connectors set for crtc %d", crtc.mCrtc->crtc_id);
-        return -1;
+        return false;
     }
     LOG_DEBUG("connectors has been set for crtc %d", crtc.mCrtc->crtc_id);
 
@@ -367,45 +941,117 @@ int DriDevice::setActiveMode(DrmCrtc &crtc, const uint32_t width, const uint32_t
             continue;
         }
 
-        if (!conn->isModeSupported(modeStr.str())) {
-            LOG_ERROR(MSGID_INVALID_DISPLAY_MODE, 0, "Mode %s is not supported by %d", modeStr.str().c_str(),
-                      conn->mConnectorPtr->connector_id);
-            return -1;
+        if (!conn->isModeSupported(modeName, vRefresh)) {
+            LOG_ERROR(MSGID_INVALID_DISPLAY_MODE, 0, "Mode %s@%u is not supported by %d", modeName,
+                      vRefresh, conn->mConnectorPtr->connector_id);
+            return false;
         }
 
         if (!mode.mModeInfoPtr)
-            mode = conn->getMode(modeStr.str());
+            mode = conn->getMode(modeName, vRefresh);
     }
 
     if (!mode.mModeInfoPtr) {
         LOG_ERROR(MSGID_DISPLAY_NOT_CONNECTED, 0,
                   "cannot get a valid mode object or connector not connected for crtc %d", crtc.mCrtc->crtc_id);
-        return -1;
+        return false;
     }
 
-    // create a new Fb if current fb size is different
-    if (crtc.createScanoutFb(drmModuleFd, width, height)) // create failed
-    {
-        return -1;
-    }
+    found = *mode.mModeInfoPtr;
+    return true;
+}
 
-    uint32_t *conn_ids = (uint32_t *)calloc(crtc.connectors.size(), sizeof(uint32_t));
-    int index          = 0;
-    for (auto connId : crtc.connectors) {
-        conn_ids[index++] = connId;
-    }
-    LOG_DEBUG("crtc id : %d, scanout fb Id : %d", crtc.mCrtc->crtc_id, crtc.scanout_fbId);
-    for (int idx = 0; idx < (int)crtc.connectors.size(); idx++) {
-        LOG_DEBUG("conn_idx[%d] = %d", idx, conn_ids[idx]);
-    }
-    int ret = drmModeSetCrtc(drmModuleFd, crtc.mCrtc->crtc_id, crtc.scanout_fbId, 0, 0, conn_ids,
-                             crtc.connectors.size(), mode.mModeInfoPtr);
-    if (ret) {
-        LOG_ERROR(MSGID_DRM_MODESET_ERROR, 0, "Failed to set mode %d", ret);
+int DriDevice::applyMode(DrmCrtc &crtc, drmModeModeInfo &mode)
+{
+    ModeChange change;
+    prepareModeChange(crtc, mode, change);
+    change.commit();
+    return finishModeChange(change);
+}
+
+void DriDevice::prepareModeChange(DrmCrtc &crtc, const drmModeModeInfo &mode, ModeChange &change)
+{
+    change.fd     = drmModuleFd;
+    change.crtcId = crtc.mCrtc->crtc_id;
+    change.mode   = mode;
+    change.connectors.assign(crtc.connectors.begin(), crtc.connectors.end());
+}
+
+int DriDevice::finishModeChange(ModeChange &change)
+{
+    auto crtc = std::find_if(crtcList.begin(), crtcList.end(),
+                             [&change](DrmCrtc &c) { return c.mCrtc->crtc_id == change.crtcId; });
+    if (change.result || crtc == crtcList.end()) {
+        if (change.fbId)
+            drmModeRmFB(drmModuleFd, change.fbId);
+        bo_destroy(change.bo);
+        return change.result ? change.result : -1;
     }
+
+    // The previous buffer is off screen now. It is only released here, so that a failed modeset keeps it.
+    if (crtc->scanout_fbId)
+        drmModeRmFB(drmModuleFd, crtc->scanout_fbId);
+    bo_destroy(crtc->boHandle);
+    crtc->scanout_fbId = change.fbId;
+    crtc->boHandle     = change.bo;
+
+    // SetCrtc attaches the new scanout buffer to the primary plane again.
+    crtc->restorePrimaryAccounting();
+    crtc->active.w = change.mode.hdisplay;
+    crtc->active.h = change.mode.vdisplay;
+    crtc->vrefresh = change.mode.vrefresh;
+    crtc->mode     = change.mode;
     return 0;
 }
 
+bool DriDevice::disableCrtc(DrmCrtc &crtc)
+{
+    uint32_t crtcId = crtc.mCrtc->crtc_id;
+    TRACE_SCOPE(TRACE_DRM, "disableCrtc", crtcId);
+
+    // Planes may not stay enabled on a crtc that is off.
+    std::vector<uint32_t> planes;
+    for (auto &plane : planeList) {
+        if (findCrtc(plane.mDrmPlane->plane_id) == crtcId)
+            planes.push_back(plane.mDrmPlane->plane_id);
+    }
+    int fd            = drmModuleFd;
+    uint32_t fbId     = crtc.scanout_fbId;
+    struct bo *handle = crtc.boHandle;
+    auto off          = [fd, crtcId, planes, fbId, handle]() {
+        for (auto planeId : planes) {
+            if (drmModeSetPlane(fd, planeId, crtcId, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0))
+                LOG_WARNING(MSGID_DRM_SET_PLANE_FAILED, 0, "Failed to detach plane %u: %s", planeId, strerror(errno));
+        }
+        if (drmModeSetCrtc(fd, crtcId, 0, 0, 0, nullptr, 0, nullptr)) {
+            LOG_ERROR(MSGID_DRM_MODESET_ERROR, 0, "Failed to turn crtc %u off: %s", crtcId, strerror(errno));
+            return false;
+        }
+        // The buffer is released once the crtc no longer scans it out.
+        if (fbId)
+            drmModeRmFB(fd, fbId);
+        bo_destroy(handle);
+        return true;
+    };
+    uint64_t bytes = crtc.scanoutBytesPerFrame(); // handle may be gone once the worker has run
+    crtc.restorePrimaryAccounting();
+    if (deviceIndex)
+        worker->post(0, off);
+    else if (!off())
+        return false;
+
+    crtc.idle         = true;
+    crtc.idleBytes    = bytes;
+    crtc.idleFetch    = crtc.idleBytes * crtc.vrefresh;
+    crtc.scanout_fbId = 0;
+    crtc.boHandle     = nullptr;
+    crtc.vrefresh     = 0;
+    crtc.active       = {};
+    LOG_INFO(MSGID_DEVICE_STATUS, 0, "crtc %u off, %llu bytes released, %llu bytes/s of scanout saved", crtcId,
+             (unsigned long long)crtc.idleBytes, (unsigned long long)crtc.idleFetch);
+    return true;
+}
+
 int DriDevice::hasDumbBuff()
 {
     uint64_t has_dumb;
@@ -421,64 +1067,244 @@ int DriDevice::hasDumbBuff()
     return 0;
 }
 
-int DrmCrtc::createScanoutFb(const int fd, const uint32_t width, const uint32_t height)
+void ModeChange::commit()
 {
+    TRACE_SCOPE(TRACE_DRM, "commitModeChange", crtcId);
 
     uint32_t handles[4] = {0}, pitches[4] = {0}, offsets[4] = {0};
-    unsigned int fb_id;
+    uint32_t width = mode.hdisplay, height = mode.vdisplay;
 
-    int ret;
-    if (boHandle && scanout_fbId != 0) {
-        drmModeRmFB(fd, scanout_fbId);
-        bo_destroy(boHandle);
-    }
-
-    struct bo *bo = bo_create(fd, DEFAULT_PIXEL_FORMAT, width, height, handles, pitches, offsets);
+    bo = bo_create(fd, DEFAULT_PIXEL_FORMAT, width, height, handles, pitches, offsets, BUFFER_SCANOUT, crtcId);
     if (!bo) {
         LOG_ERROR(MSGID_BUFFER_CREATION_FAILED, 0, "failed to create frame buffers  (%ux%u): (%s)", width, height,
                   strerror(errno));
-        return -errno;
+        result = -errno;
+        return;
     }
 
+    // Start from black rather than whatever the buffer held before.
+    if (bo_fill(bo, 0))
+        LOG_WARNING(MSGID_BUFFER_CREATION_FAILED, 0, "failed to clear frame buffer (%ux%u)", width, height);
+
     // TODO:: set fourcc DRM_FORMAT_XRGB8888 as a config param
-    ret = drmModeAddFB2(fd, width, height, DRM_FORMAT_XRGB8888, handles, pitches, offsets, &fb_id, 0);
-    if (ret) {
+    result = drmModeAddFB2(fd, width, height, DRM_FORMAT_XRGB8888, handles, pitches, offsets, &fbId, 0);
+    if (result) {
         LOG_ERROR(MSGID_FB_CREATION_FAILED, 0, "failed to add fb (%ux%u): %s\n", width, height, strerror(errno));
-        bo_destroy(bo);
-        return ret;
+        fbId = 0;
+        return;
     }
 
-    scanout_fbId = fb_id;
-    boHandle     = bo;
-    return 0;
+    LOG_DEBUG("crtc id : %d, scanout fb Id : %d, %zu connectors", crtcId, fbId, connectors.size());
+    {
+        // Blocks until the sink has locked to the new timings.
+        TRACE_SCOPE(TRACE_DRM, "drmModeSetCrtc", crtcId);
+        result = drmModeSetCrtc(fd, crtcId, fbId, 0, 0, connectors.data(), connectors.size(), &mode);
+    }
+    if (result)
+        LOG_ERROR(MSGID_DRM_MODESET_ERROR, 0, "Failed to set mode %d", result);
 }
 
-DriDevice::~DriDevice()
+CommitWorker::CommitWorker() : mThread(&CommitWorker::run, this) {}
+
+CommitWorker::~CommitWorker()
 {
-    if (drmModuleFd) {
-        // close(drmModuleFd);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mCondition.notify_one();
+    mThread.join();
+}
+
+void CommitWorker::post(uint32_t key, std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (key) {
+            uint32_t geometryKey = (key & 3) == PLANE_COMMIT_STATE ? (key & ~3u) | PLANE_COMMIT_GEOMETRY : key;
+            auto superseded      = std::remove_if(mJobs.begin(), mJobs.end(),
+                                             [key, geometryKey](const std::pair<uint32_t, std::function<void()>> &j) {
+                                                 return j.first == key || j.first == geometryKey;
+                                             });
+            mReplaced += std::distance(superseded, mJobs.end());
+            mJobs.erase(superseded, mJobs.end());
+        }
+        mJobs.emplace_back(key, std::move(job));
+    }
+    mCondition.notify_one();
+}
+
+void CommitWorker::run()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;) {
+        mCondition.wait(lock, [this]() { return mStop || !mJobs.empty(); });
+        if (mJobs.empty())
+            return;
+        std::function<void()> job = std::move(mJobs.front().second);
+        mJobs.pop_front();
+        lock.unlock();
+        job();
+        lock.lock();
+    }
+}
+
+void DrmCrtc::setModeRange(const drmModeModeInfo &minMode, const drmModeModeInfo &maxMode,
+                           const VAL_VIDEO_SIZE_T &confMode)
+{
+    if ((maxMode.hdisplay < confMode.w || maxMode.vdisplay < confMode.h) && maxMode.hdisplay != 0 &&
+        maxMode.vdisplay != 0) {
+        max.w = maxMode.hdisplay;
+        max.h = maxMode.vdisplay;
+    } else {
+        max.w = confMode.w;
+        max.h = confMode.h;
+    }
+    min.w = minMode.hdisplay;
+    min.h = minMode.vdisplay;
+}
+
+uint64_t DrmCrtc::scanoutBytesPerFrame() const { return boHandle ? boHandle->size : 0; }
+
+void DrmCrtc::restorePrimaryAccounting()
+{
+    if (!primaryElided)
+        return;
+    gint64 elapsed = g_get_monotonic_time() - elidedSince;
+    primaryBytesSaved += scanoutBytesPerFrame() * vrefresh * static_cast<uint64_t>(elapsed) / G_USEC_PER_SEC;
+    primaryElided = false;
+}
+
+uint32_t DriDevice::getPropertyId(uint32_t objectId, uint32_t objectType, const std::string &name)
+{
+    uint32_t propId = 0;
+    UniqueDrmObjectProperties props(drmModeObjectGetProperties(drmModuleFd, objectId, objectType));
+    if (!props)
+        return 0;
+
+    for (uint32_t i = 0; i < props->count_props && !propId; i++) {
+        UniqueDrmProperty prop(drmModeGetProperty(drmModuleFd, props->props[i]));
+        if (prop && !strcasecmp(prop->name, name.c_str()))
+            propId = prop->prop_id;
+    }
+    return propId;
+}
+
+bool DriDevice::getProperty(uint32_t objectId, uint32_t objectType, const std::string &name, DrmProperty &property)
+{
+    UniqueDrmObjectProperties props(drmModeObjectGetProperties(drmModuleFd, objectId, objectType));
+    for (uint32_t i = 0; props && i < props->count_props; i++) {
+        UniqueDrmProperty prop(drmModeGetProperty(drmModuleFd, props->props[i]));
+        if (!prop || strcasecmp(prop->name, name.c_str()))
+            continue;
+        property.id        = prop->prop_id;
+        property.value     = props->prop_values[i];
+        property.immutable = prop->flags & DRM_MODE_PROP_IMMUTABLE;
+        if ((prop->flags & DRM_MODE_PROP_RANGE) && prop->count_values == 2) {
+            property.min = prop->values[0];
+            property.max = prop->values[1];
+        }
+        property.enums.clear();
+        if (prop->flags & (DRM_MODE_PROP_ENUM | DRM_MODE_PROP_BITMASK)) {
+            for (int j = 0; j < prop->count_enums; j++)
+                property.enums.emplace_back(prop->enums[j].name, prop->enums[j].value);
+        }
+        return true;
+    }
+    return false;
+}
+
+bool DrmProperty::findEnum(const std::string &name, uint64_t &enumValue) const
+{
+    auto e = std::find_if(enums.begin(), enums.end(), [&name](const std::pair<std::string, uint64_t> &p) {
+        return !strcasecmp(p.first.c_str(), name.c_str());
+    });
+    if (!id || e == enums.end())
+        return false;
+    enumValue = e->second;
+    return true;
+}
+
+void DriDevice::createBlankFb()
+{
+    uint32_t handles[4] = {0}, pitches[4] = {0}, offsets[4] = {0};
+    blankBo = bo_create(drmModuleFd, DRM_FORMAT_XRGB8888, 1, 1, handles, pitches, offsets, BUFFER_OVERLAY);
+    if (!blankBo || bo_fill(blankBo, 0) ||
+        drmModeAddFB2(drmModuleFd, 1, 1, DRM_FORMAT_XRGB8888, handles, pitches, offsets, &blankFbId, 0)) {
+        LOG_WARNING(MSGID_FB_CREATION_FAILED, 0, "No black buffer on %s, blanking detaches planes: %s",
+                    deviceName.c_str(), strerror(errno));
+        if (blankBo)
+            bo_destroy(blankBo);
+        blankBo   = nullptr;
+        blankFbId = 0;
+    }
+}
+
+DrmPlane *DriDevice::findPlane(uint32_t planeId)
+{
+    auto plane = std::find_if(planeList.begin(), planeList.end(),
+                              [planeId](DrmPlane &p) { return p.mDrmPlane->plane_id == planeId; });
+    return plane != planeList.end() ? &*plane : nullptr;
+}
+
+DriDevice::~DriDevice()
+{
+    worker.reset();
+    if (eventSource)
+        g_source_remove(eventSource);
+    if (modeChangeSource)
+        g_source_remove(modeChangeSource);
+    if (modeChange)
+        finishModeChange(*modeChange);
+    if (drmModuleFd < 0)
+        return;
+    if (blankFbId)
+        drmModeRmFB(drmModuleFd, blankFbId);
+    if (blankBo)
+        bo_destroy(blankBo);
+    for (auto &crtc : crtcList) {
+        if (crtc.scanout_fbId)
+            drmModeRmFB(drmModuleFd, crtc.scanout_fbId);
+        if (crtc.boHandle)
+            bo_destroy(crtc.boHandle);
     }
+    BufferPool::instance().drain(drmModuleFd);
+    close(drmModuleFd);
 }
 
 DRIElements::~DRIElements()
 {
+    stopModeValidation();
+    if (mHotplugSource)
+        g_source_remove(mHotplugSource);
+    // The devices finish their own commits as mDeviceList goes, but their done callbacks must not run.
+    for (auto &devPair : mDeviceList) {
+        if (devPair.second.modeChange)
+            devPair.second.modeChange->done = nullptr;
+    }
     g_source_remove(mTimeOutHandle);
     delete mUDev;
 }
 
 std::vector<uint32_t> DRIElements::getPlanes()
 {
-    DriDevice &driDevice = mDeviceList[mPrimaryDev];
     std::vector<uint32_t> planes;
 
-    for (auto &crtc : driDevice.crtcList) {
-        if (crtc.connectors.size()) {
-            LOG_DEBUG("DRIElements - getPlanes - crtc id : %d, crtc_index : %d", crtc.mCrtc->crtc_id, crtc.crtc_index);
-            for (auto &p : driDevice.planeList) {
-                if (p.mDrmPlane->possible_crtcs & (1 << crtc.crtc_index)) {
-                    LOG_DEBUG("mDrmPlane - plane id : %d, possible_crtcs : %d", p.mDrmPlane->plane_id,
-                              p.mDrmPlane->possible_crtcs);
-                    planes.push_back(p.mDrmPlane->plane_id);
+    for (auto &node : mDeviceNodes) {
+        auto devPair = mDeviceList.find(node);
+        if (devPair == mDeviceList.end())
+            continue;
+        DriDevice &driDevice = devPair->second;
+        for (auto &crtc : driDevice.crtcList) {
+            if (crtc.connectors.size()) {
+                LOG_DEBUG("DRIElements - getPlanes - crtc id : %d, crtc_index : %d", crtc.mCrtc->crtc_id,
+                          crtc.crtc_index);
+                for (auto &p : driDevice.planeList) {
+                    if (p.mDrmPlane->possible_crtcs & (1 << crtc.crtc_index)) {
+                        LOG_DEBUG("mDrmPlane - plane id : %d, possible_crtcs : %d", p.mDrmPlane->plane_id,
+                                  p.mDrmPlane->possible_crtcs);
+                        planes.push_back(driDevice.toGlobalId(p.mDrmPlane->plane_id));
+                    }
                 }
             }
         }
@@ -489,41 +1315,56 @@ std::vector<uint32_t> DRIElements::getPlanes()
 
 PLANE_TYPES_T DRIElements::getPlaneType(int deviceFd, uint32_t planeId)
 {
-    PLANE_TYPES_T ret                   = NONE;
-    std::vector<std::string> planeType  = {"Primary", "Overlay", "Cursor"};
-    drmModeObjectProperties *planeProps = drmModeObjectGetProperties(deviceFd, planeId, DRM_MODE_OBJECT_PLANE);
-    for (uint32_t i = 0; i < planeProps->count_props; ++i) {
-        drmModePropertyRes *prop = drmModeGetProperty(deviceFd, planeProps->props[i]);
-        for (int j = 0; j < prop->count_enums; ++j) {
+    PLANE_TYPES_T ret                  = NONE;
+    static const char *const planeType[] = {"Primary", "Overlay", "Cursor"};
+    UniqueDrmObjectProperties planeProps(drmModeObjectGetProperties(deviceFd, planeId, DRM_MODE_OBJECT_PLANE));
+    for (uint32_t i = 0; planeProps && i < planeProps->count_props; ++i) {
+        UniqueDrmProperty prop(drmModeGetProperty(deviceFd, planeProps->props[i]));
+        for (int j = 0; prop && j < prop->count_enums; ++j) {
             if (prop->enums[j].value == planeProps->prop_values[i]) {
-                auto it = std::find(planeType.begin(), planeType.end(), prop->enums[j].name);
-                ret     = static_cast<PLANE_TYPES_T>(std::distance(planeType.begin(), it));
+                auto it = std::find_if(std::begin(planeType), std::end(planeType),
+                                       [&](const char *type) { return !strcmp(type, prop->enums[j].name); });
+                ret     = static_cast<PLANE_TYPES_T>(std::distance(std::begin(planeType), it));
                 LOG_DEBUG("Type of planeID(%d) : %s, ret = %d", planeId, prop->enums[j].name, ret);
-                drmModeFreeProperty(prop);
-                drmModeFreeObjectProperties(planeProps);
                 return ret;
             }
         }
-        drmModeFreeProperty(prop);
     }
-    drmModeFreeObjectProperties(planeProps);
     return ret;
 }
 
 bool DRIElements::setPlane(uint planeId, uint fbId, uint32_t crtc_x, uint32_t crtc_y, uint32_t crtc_w, uint32_t crtc_h,
                            uint32_t src_x, uint32_t src_y, uint32_t src_w, uint32_t src_h)
 {
+    TRACE_SCOPE(TRACE_DRM, "drmModeSetPlane", planeId);
     LOG_DEBUG("Applying set plane to output {x:%u, y:%u, w:%u, h:%u} for source {x:%u, y:%u, w:%u, h:%u}, planeId %u",
               crtc_x, crtc_y, crtc_w, crtc_h, src_x, src_y, src_w, src_h, planeId);
 
-    DriDevice &driDevice = mDeviceList[mPrimaryDev];
-    for (auto &conn : driDevice.connectorList) {
-        auto crtc = std::find_if(driDevice.crtcList.begin(), driDevice.crtcList.end(),
-                                 [conn](DrmCrtc &c) { return c.mCrtc->crtc_id == conn.crtc_id; });
-
-        if (crtc != driDevice.crtcList.end()) {
-            if (drmModeSetPlane(driDevice.drmModuleFd, planeId, crtc->mCrtc->crtc_id, fbId, 0, crtc_x, crtc_y, crtc_w,
-                                crtc_h, src_x, src_y, src_w << 16, src_h << 16)) {
+    uint32_t localId     = 0;
+    DriDevice *driDevice = findDevice(planeId, localId);
+    if (!driDevice)
+        return false;
+    DrmPlane *plane = driDevice->findPlane(localId);
+    if (plane)
+        plane->fbId = fbId;
+    for (auto &conn : driDevice->connectorList) {
+        auto crtc = std::find_if(driDevice->crtcList.begin(), driDevice->crtcList.end(),
+                                 [&conn](DrmCrtc &c) { return c.mCrtc->crtc_id == conn.crtc_id; });
+
+        if (crtc != driDevice->crtcList.end()) {
+            int fd          = driDevice->drmModuleFd;
+            uint32_t crtcId = crtc->mCrtc->crtc_id;
+            if (driDevice->deviceIndex) {
+                // Other devices may be slow to commit, the update is applied on their worker.
+                driDevice->worker->post(CommitWorker::planeKey(localId, PLANE_COMMIT_STATE), [=]() {
+                    if (drmModeSetPlane(fd, localId, crtcId, fbId, 0, crtc_x, crtc_y, crtc_w, crtc_h, src_x, src_y,
+                                        src_w << 16, src_h << 16))
+                        LOG_ERROR(MSGID_DRM_SET_PLANE_FAILED, 0, "plane %u: %s", localId, strerror(errno));
+                });
+                break;
+            }
+            if (drmModeSetPlane(fd, localId, crtcId, fbId, 0, crtc_x, crtc_y, crtc_w, crtc_h, src_x, src_y,
+                                src_w << 16, src_h << 16)) {
                 LOG_ERROR(MSGID_DRM_SET_PLANE_FAILED, 0, "%s", strerror(errno));
                 return false;
             }
@@ -536,21 +1377,29 @@ bool DRIElements::setPlane(uint planeId, uint fbId, uint32_t crtc_x, uint32_t cr
 uint32_t DRIElements::getSupportedNumConnector()
 {
     uint32_t ret = 0;
-    for (auto &c : mDeviceList[mPrimaryDev].connectorList) {
-        if (c.isPlugged())
-            ret++;
+    for (auto &devPair : mDeviceList) {
+        for (auto &c : devPair.second.connectorList) {
+            if (c.isPlugged())
+                ret++;
+        }
     }
     return ret;
 }
 
 std::vector<VAL_VIDEO_SIZE_T> DRIElements::getSupportedModes(uint8_t connIndex)
 {
-    DriDevice &driDevice = mDeviceList[mPrimaryDev];
-    auto conn            = &driDevice.connectorList[connIndex];
     // Get unique wxh values.
+    for (auto &node : mDeviceNodes) {
+        auto devPair = mDeviceList.find(node);
+        if (devPair == mDeviceList.end())
+            continue;
+        DriDevice &driDevice = devPair->second;
+        if (connIndex >= driDevice.connectorList.size()) {
+            connIndex -= driDevice.connectorList.size();
+            continue;
+        }
 
-    if (driDevice.connectorList.size()) {
-        auto modes = conn->getSupportedModes();
+        auto modes = driDevice.connectorList[connIndex].getSupportedModes();
 
         modes.erase(std::unique(modes.begin(), modes.end(),
                                 [](const VAL_VIDEO_SIZE_T &lhs, const VAL_VIDEO_SIZE_T &rhs) {
@@ -566,18 +1415,784 @@ std::vector<VAL_VIDEO_SIZE_T> DRIElements::getSupportedModes(uint8_t connIndex)
 bool DRIElements::setPlaneProperties(PLANE_PROPS_T propType, uint planeId, uint64_t value)
 {
 
-    DriDevice &driDevice = mDeviceList[mPrimaryDev];
+    TRACE_SCOPE(TRACE_DRM, "drmModeObjectSetProperty", planeId);
+    uint32_t localId     = 0;
+    DriDevice *driDevice = findDevice(planeId, localId);
+    if (!driDevice)
+        return false;
     LOG_DEBUG("property type=%d, plane id = %d, value = %+" PRId64, propType, planeId, value);
+    DrmPlane *plane = driDevice->findPlane(localId);
+    if (plane && propType == SET_PLANE_FB_T)
+        plane->fbId = static_cast<uint32_t>(value);
 
-    if (drmModeObjectSetProperty(driDevice.drmModuleFd, planeId, DRM_MODE_OBJECT_PLANE, propType, (uint64_t)value)) {
+    if (driDevice->deviceIndex)
+        return postPlaneProperties(*driDevice, propType, localId, value);
+
+    if (drmModeObjectSetProperty(driDevice->drmModuleFd, localId, DRM_MODE_OBJECT_PLANE, propType, (uint64_t)value)) {
         LOG_ERROR(MSGID_DRM_SET_PROP_FAILED, 0, "%s", strerror(errno));
         return false;
     }
     return true;
 }
 
+bool DRIElements::setPlaneOrder(const std::vector<uint32_t> &planeIds)
+{
+    TRACE_SCOPE(TRACE_DRM, "setPlaneOrder", planeIds.size());
+
+    // Planes by device, in stacking order.
+    std::vector<std::pair<DriDevice *, std::vector<DrmPlane *>>> stacks;
+    for (auto planeId : planeIds) {
+        uint32_t localId  = 0;
+        DriDevice *device = findDevice(planeId, localId);
+        DrmPlane *plane   = device ? device->findPlane(localId) : nullptr;
+        if (!plane)
+            return false;
+        if (!plane->zpos.id || plane->zpos.immutable) {
+            LOG_WARNING(MSGID_DRM_SET_PROP_FAILED, 0, "Plane %u has no mutable zpos", planeId);
+            return false;
+        }
+        auto stack = std::find_if(stacks.begin(), stacks.end(),
+                                  [device](const std::pair<DriDevice *, std::vector<DrmPlane *>> &s) {
+                                      return s.first == device;
+                                  });
+        if (stack != stacks.end())
+            stack->second.push_back(plane);
+        else
+            stacks.emplace_back(device, std::vector<DrmPlane *>(1, plane));
+    }
+
+    // The planes keep the positions they hold between them, only who holds which changes. That leaves planes
+    // that are not listed, such as the primary plane, where they are.
+    std::vector<std::vector<uint64_t>> positions;
+    for (auto &stack : stacks) {
+        std::vector<uint64_t> zpos;
+        for (auto plane : stack.second)
+            zpos.push_back(plane->zpos.value);
+        std::sort(zpos.begin(), zpos.end());
+        for (size_t i = 0; i < zpos.size(); i++) {
+            DrmPlane *plane = stack.second[i];
+            if (i && zpos[i] <= zpos[i - 1])
+                zpos[i] = zpos[i - 1] + 1;
+            zpos[i] = std::max(zpos[i], plane->zpos.min);
+            if (zpos[i] > plane->zpos.max) {
+                LOG_ERROR(MSGID_DRM_SET_PROP_FAILED, 0, "zpos %llu out of range %llu-%llu for plane %u",
+                          (unsigned long long)zpos[i], (unsigned long long)plane->zpos.min,
+                          (unsigned long long)plane->zpos.max, plane->mDrmPlane->plane_id);
+                return false;
+            }
+        }
+        positions.push_back(zpos);
+    }
+
+    // Planes moved so far with their previous zpos, put back if a later one cannot move.
+    struct Move {
+        DriDevice *device;
+        DrmPlane *plane;
+        uint64_t from;
+    };
+    std::vector<Move> moved;
+    for (size_t s = 0; s < stacks.size(); s++) {
+        for (size_t i = 0; i < stacks[s].second.size(); i++) {
+            DrmPlane *plane = stacks[s].second[i];
+            uint64_t from   = plane->zpos.value;
+            if (from == positions[s][i])
+                continue;
+            LOG_DEBUG("plane %u zpos %llu -> %llu", plane->mDrmPlane->plane_id, (unsigned long long)from,
+                      (unsigned long long)positions[s][i]);
+            if (!setPlaneProperty(*stacks[s].first, plane->mDrmPlane->plane_id, plane->zpos, positions[s][i])) {
+                for (auto m = moved.rbegin(); m != moved.rend(); ++m)
+                    setPlaneProperty(*m->device, m->plane->mDrmPlane->plane_id, m->plane->zpos, m->from);
+                return false;
+            }
+            moved.push_back(Move{stacks[s].first, plane, from});
+        }
+    }
+    return true;
+}
+
+bool DRIElements::setPlaneProperty(DriDevice &device, uint32_t planeId, DrmProperty &property, uint64_t value)
+{
+    int fd          = device.drmModuleFd;
+    uint32_t propId = property.id;
+    if (device.deviceIndex) {
+        device.worker->post(0, [fd, planeId, propId, value]() {
+            if (drmModeObjectSetProperty(fd, planeId, DRM_MODE_OBJECT_PLANE, propId, value))
+                LOG_ERROR(MSGID_DRM_SET_PROP_FAILED, 0, "property %u of plane %u: %s", propId, planeId,
+                          strerror(errno));
+        });
+    } else if (drmModeObjectSetProperty(fd, planeId, DRM_MODE_OBJECT_PLANE, propId, value)) {
+        LOG_ERROR(MSGID_DRM_SET_PROP_FAILED, 0, "property %u of plane %u: %s", propId, planeId, strerror(errno));
+        return false;
+    }
+    property.value = value;
+    return true;
+}
+
+bool DRIElements::setPlaneAlpha(uint32_t planeId, uint16_t alpha)
+{
+    TRACE_SCOPE(TRACE_DRM, "setPlaneAlpha", planeId);
+    uint32_t localId  = 0;
+    DriDevice *device = findDevice(planeId, localId);
+    DrmPlane *plane   = device ? device->findPlane(localId) : nullptr;
+    if (!plane || !plane->alpha.id)
+        return false;
+
+    // A new value replaces a fade in progress.
+    mFades.erase(std::remove_if(mFades.begin(), mFades.end(),
+                                [planeId](const PlaneFade &fade) { return fade.planeId == planeId; }),
+                 mFades.end());
+    uint64_t value = std::min<uint64_t>(alpha, plane->alpha.max ? plane->alpha.max : PLANE_ALPHA_OPAQUE);
+    return plane->alpha.value == value || setPlaneProperty(*device, localId, plane->alpha, value);
+}
+
+bool DRIElements::setPlaneBlendMode(uint32_t planeId, const std::string &mode)
+{
+    TRACE_SCOPE(TRACE_DRM, "setPlaneBlendMode", planeId);
+    uint32_t localId  = 0;
+    DriDevice *device = findDevice(planeId, localId);
+    DrmPlane *plane   = device ? device->findPlane(localId) : nullptr;
+    uint64_t value    = 0;
+    if (!plane || !plane->blendMode.findEnum(mode, value)) {
+        LOG_WARNING(MSGID_DRM_SET_PROP_FAILED, 0, "Blend mode %s is not supported on plane %u", mode.c_str(), planeId);
+        return false;
+    }
+    return plane->blendMode.value == value || setPlaneProperty(*device, localId, plane->blendMode, value);
+}
+
+bool DRIElements::getPlaneBlend(uint32_t planeId, PlaneBlend &blend)
+{
+    uint32_t localId  = 0;
+    DriDevice *device = findDevice(planeId, localId);
+    DrmPlane *plane   = device ? device->findPlane(localId) : nullptr;
+    if (!plane)
+        return false;
+
+    blend.hasAlpha = plane->alpha.id != 0;
+    blend.alpha    = static_cast<uint16_t>(plane->alpha.id ? plane->alpha.value : PLANE_ALPHA_OPAQUE);
+    blend.mode.clear();
+    blend.modes.clear();
+    for (auto &e : plane->blendMode.enums) {
+        blend.modes.push_back(e.first);
+        if (e.second == plane->blendMode.value)
+            blend.mode = e.first;
+    }
+    blend.fading = std::any_of(mFades.begin(), mFades.end(),
+                               [planeId](const PlaneFade &fade) { return fade.planeId == planeId; });
+    return true;
+}
+
+uint32_t DRIElements::getPlaneRotations(uint32_t planeId)
+{
+    uint32_t localId  = 0;
+    DriDevice *device = findDevice(planeId, localId);
+    DrmPlane *plane   = device ? device->findPlane(localId) : nullptr;
+    if (!plane || !plane->rotation.id)
+        return 0;
+
+    // Bitmask enum values are bit numbers.
+    uint32_t supported = 0;
+    for (auto &e : plane->rotation.enums) {
+        if (e.second < 32)
+            supported |= 1u << e.second;
+    }
+    return supported;
+}
+
+bool DRIElements::setPlaneRotation(uint32_t planeId, uint32_t rotation)
+{
+    TRACE_SCOPE(TRACE_DRM, "setPlaneRotation", planeId);
+    uint32_t localId  = 0;
+    DriDevice *device = findDevice(planeId, localId);
+    DrmPlane *plane   = device ? device->findPlane(localId) : nullptr;
+    if (!plane)
+        return false;
+    if (!(rotation & PLANE_ROTATE_MASK))
+        rotation |= DRM_MODE_ROTATE_0;
+    if (rotation == DRM_MODE_ROTATE_0 && !plane->rotation.id)
+        return true;
+
+    // Reflecting both ways is a half turn, so every transform has a second form with the other reflections.
+    uint32_t supported = getPlaneRotations(planeId);
+    uint32_t rotate    = rotation & PLANE_ROTATE_MASK;
+    uint32_t turned    = ((rotate << 2) | (rotate >> 2)) & PLANE_ROTATE_MASK;
+    uint32_t other     = turned | (~rotation & PLANE_REFLECT_MASK);
+    uint32_t value     = 0;
+    if ((rotation & supported) == rotation)
+        value = rotation;
+    else if ((other & supported) == other)
+        value = other;
+
+    if (!value) {
+        LOG_INFO(MSGID_DEVICE_STATUS, 0, "Plane %u cannot apply rotation %#x (supports %#x)", planeId, rotation,
+                 supported);
+        // Whoever applies the transform in software expects an unrotated plane.
+        if (plane->rotation.id && plane->rotation.value != DRM_MODE_ROTATE_0 && (supported & DRM_MODE_ROTATE_0))
+            setPlaneProperty(*device, localId, plane->rotation, DRM_MODE_ROTATE_0);
+        return false;
+    }
+    return plane->rotation.value == value || setPlaneProperty(*device, localId, plane->rotation, value);
+}
+
+bool DRIElements::setPlaneColor(uint32_t planeId, COLOR_ENCODING_T encoding, bool fullRange)
+{
+    TRACE_SCOPE(TRACE_DRM, "setPlaneColor", planeId);
+    static const char *const encodings[] = {"ITU-R BT.601 YCbCr", "ITU-R BT.709 YCbCr", "ITU-R BT.2020 YCbCr"};
+    uint32_t localId  = 0;
+    DriDevice *device = findDevice(planeId, localId);
+    DrmPlane *plane   = device ? device->findPlane(localId) : nullptr;
+    uint64_t matrix   = 0, range = 0;
+    if (!plane || !plane->colorEncoding.findEnum(encodings[encoding], matrix) ||
+        !plane->colorRange.findEnum(fullRange ? "YCbCr full range" : "YCbCr limited range", range)) {
+        LOG_WARNING(MSGID_DRM_SET_PROP_FAILED, 0, "Plane %u cannot convert %s %s range", planeId, encodings[encoding],
+                    fullRange ? "full" : "limited");
+        return false;
+    }
+
+    bool ok = plane->colorEncoding.value == matrix || setPlaneProperty(*device, localId, plane->colorEncoding, matrix);
+    return (plane->colorRange.value == range || setPlaneProperty(*device, localId, plane->colorRange, range)) && ok;
+}
+
+bool DRIElements::getPlaneColor(uint32_t planeId, PlaneColor &color)
+{
+    uint32_t localId  = 0;
+    DriDevice *device = findDevice(planeId, localId);
+    DrmPlane *plane   = device ? device->findPlane(localId) : nullptr;
+    if (!plane)
+        return false;
+
+    color = PlaneColor();
+    for (auto &e : plane->colorEncoding.enums) {
+        color.encodings.push_back(e.first);
+        if (e.second == plane->colorEncoding.value)
+            color.encoding = e.first;
+    }
+    for (auto &e : plane->colorRange.enums) {
+        color.ranges.push_back(e.first);
+        if (e.second == plane->colorRange.value)
+            color.range = e.first;
+    }
+    return true;
+}
+
+uint32_t DRIElements::getPlaneFormat(uint32_t planeId)
+{
+    uint32_t localId  = 0;
+    DriDevice *device = findDevice(planeId, localId);
+    DrmPlane *plane   = device ? device->findPlane(localId) : nullptr;
+    if (!plane)
+        return 0;
+    // Players attach their buffers to planes of the primary device themselves.
+    UniqueDrmPlane state(device->deviceIndex ? nullptr : drmModeGetPlane(device->drmModuleFd, localId));
+    uint32_t fbId = device->deviceIndex ? plane->fbId : state ? state->fb_id : 0;
+    UniqueDrmFB2 fb(fbId ? drmModeGetFB2(device->drmModuleFd, fbId) : nullptr);
+    return fb ? fb->pixel_format : 0;
+}
+
+bool DRIElements::setCrtcBlob(DriDevice &device, uint32_t crtcId, DrmProperty &property, const void *data,
+                              uint32_t size)
+{
+    int fd          = device.drmModuleFd;
+    uint32_t propId = property.id;
+    uint32_t blobId = 0;
+    if (size && drmModeCreatePropertyBlob(fd, data, size, &blobId)) {
+        LOG_ERROR(MSGID_DRM_SET_PROP_FAILED, 0, "blob for property %u of crtc %u: %s", propId, crtcId, strerror(errno));
+        return false;
+    }
+    auto set = [fd, crtcId, propId, blobId]() {
+        bool ok = !drmModeObjectSetProperty(fd, crtcId, DRM_MODE_OBJECT_CRTC, propId, blobId);
+        if (!ok)
+            LOG_ERROR(MSGID_DRM_SET_PROP_FAILED, 0, "property %u of crtc %u: %s", propId, crtcId, strerror(errno));
+        if (blobId)
+            drmModeDestroyPropertyBlob(fd, blobId);
+        return ok;
+    };
+    if (device.deviceIndex)
+        device.worker->post(0, [set]() { set(); });
+    else if (!set())
+        return false;
+    property.value = blobId;
+    return true;
+}
+
+bool DRIElements::getCrtcPicture(uint32_t crtcId, PictureSettings &settings)
+{
+    DriDevice *device = nullptr;
+    DrmCrtc *crtc     = findCrtc(crtcId, device);
+    if (!crtc)
+        return false;
+    settings = crtc->picture;
+    return true;
+}
+
+bool DRIElements::setCrtcPicture(uint32_t crtcId, const PictureSettings &settings)
+{
+    TRACE_SCOPE(TRACE_DRM, "setCrtcPicture", crtcId);
+    DriDevice *device = nullptr;
+    DrmCrtc *crtc     = findCrtc(crtcId, device);
+    if (!crtc)
+        return false;
+    uint32_t localId = crtc->mCrtc->crtc_id;
+
+    bool saturation = settings.saturation != crtc->picture.saturation;
+    if (saturation && !crtc->ctm.id) {
+        LOG_WARNING(MSGID_DRM_SET_PROP_FAILED, 0, "Crtc %u has no CTM, cannot change the saturation", crtcId);
+        return false;
+    }
+    uint32_t size = crtc->gammaLut.id ? static_cast<uint32_t>(crtc->gammaLutSize.value) : crtc->mCrtc->gamma_size;
+    if (!size) {
+        LOG_WARNING(MSGID_DRM_SET_PROP_FAILED, 0, "Crtc %u has no gamma table", crtcId);
+        return false;
+    }
+
+    // Every table is built before the first one is set, the previous CTM to put back if the gamma cannot be set.
+    drm_color_ctm ctm, previousCtm;
+    PictureAdjust::buildCtm(settings, ctm);
+    PictureAdjust::buildCtm(crtc->picture, previousCtm);
+    auto setCtm = [&](const drm_color_ctm &matrix, int32_t value) {
+        // No blob is the identity, and lets the crtc bypass the matrix.
+        return setCrtcBlob(*device, localId, crtc->ctm, &matrix, value != PICTURE_SETTING_NEUTRAL ? sizeof(matrix) : 0);
+    };
+
+    std::vector<drm_color_lut> lut;
+    if (!crtc->gammaLut.id || !settings.isNeutral()) {
+        lut.resize(size);
+        PictureAdjust::buildGammaLut(settings, lut.data(), size);
+    }
+    // The legacy table, one array per channel.
+    std::vector<uint16_t> channels(crtc->gammaLut.id ? 0 : size * 3);
+    for (uint32_t i = 0; i < channels.size() / 3; i++) {
+        channels[i]            = lut[i].red;
+        channels[size + i]     = lut[i].green;
+        channels[2 * size + i] = lut[i].blue;
+    }
+
+    if (saturation && !setCtm(ctm, settings.saturation))
+        return false;
+
+    bool gammaSet = false;
+    if (crtc->gammaLut.id) {
+        // No blob is the identity, and lets the crtc bypass the LUT.
+        gammaSet = setCrtcBlob(*device, localId, crtc->gammaLut, lut.data(), lut.size() * sizeof(drm_color_lut));
+    } else {
+        int fd     = device->drmModuleFd;
+        auto apply = [fd, localId, size, channels]() mutable {
+            bool ok = !drmModeCrtcSetGamma(fd, localId, size, &channels[0], &channels[size], &channels[2 * size]);
+            if (!ok)
+                LOG_ERROR(MSGID_DRM_SET_PROP_FAILED, 0, "gamma of crtc %u: %s", localId, strerror(errno));
+            return ok;
+        };
+        if (device->deviceIndex) {
+            device->worker->post(0, [apply]() mutable { apply(); });
+            gammaSet = true;
+        } else {
+            gammaSet = apply();
+        }
+    }
+    if (!gammaSet) {
+        // Leaves the crtc as it was rather than with half of the settings.
+        if (saturation)
+            setCtm(previousCtm, crtc->picture.saturation);
+        return false;
+    }
+    crtc->picture = settings;
+    return true;
+}
+
+bool DRIElements::fadePlane(uint32_t planeId, uint16_t target, uint32_t duration)
+{
+    TRACE_SCOPE(TRACE_DRM, "fadePlane", planeId);
+    uint32_t localId  = 0;
+    DriDevice *device = findDevice(planeId, localId);
+    DrmPlane *plane   = device ? device->findPlane(localId) : nullptr;
+    if (!plane || !plane->alpha.id)
+        return false;
+
+    uint32_t crtcId = device->findCrtc(localId);
+    auto crtc       = std::find_if(device->crtcList.begin(), device->crtcList.end(),
+                             [crtcId](DrmCrtc &c) { return c.mCrtc->crtc_id == crtcId; });
+    uint16_t from   = static_cast<uint16_t>(plane->alpha.value);
+    if (!duration || crtc == device->crtcList.end() || crtc->idle || !crtc->vrefresh)
+        return setPlaneAlpha(planeId, target);
+
+    PlaneFade fade;
+    fade.planeId  = planeId;
+    fade.crtcId   = device->toGlobalId(crtcId);
+    fade.from     = from;
+    fade.to       = target;
+    fade.start    = g_get_monotonic_time();
+    fade.duration = static_cast<gint64>(duration) * 1000;
+    mFades.erase(std::remove_if(mFades.begin(), mFades.end(),
+                                [planeId](const PlaneFade &f) { return f.planeId == planeId; }),
+                 mFades.end());
+    mFades.push_back(fade);
+    LOG_DEBUG("fading plane %u from %u to %u in %u ms", planeId, from, target, duration);
+
+    if (!requestVblank(*device, *crtc)) {
+        mFades.pop_back();
+        return setPlaneAlpha(planeId, target);
+    }
+    return true;
+}
+
+bool DRIElements::setPlaneBlank(uint32_t planeId, bool blank, const VAL_VIDEO_RECT_T &src, const VAL_VIDEO_RECT_T &out,
+                                bool &detached)
+{
+    TRACE_SCOPE(TRACE_DRM, "setPlaneBlank", planeId);
+    uint32_t localId  = 0;
+    DriDevice *device = findDevice(planeId, localId);
+    DrmPlane *plane   = device ? device->findPlane(localId) : nullptr;
+    uint32_t crtcId   = plane ? device->findCrtc(localId) : 0;
+    if (!crtcId)
+        return false;
+    if (!blank && !plane->blanked)
+        return true;
+
+    // The buffer shown before blanking is put back on unblank. Later blank calls only move the black area. The
+    // kernel state of other devices may not have caught up with their worker yet, what was attached last counts.
+    int fd = device->drmModuleFd;
+    if (blank && !plane->blanked) {
+        UniqueDrmPlane state(device->deviceIndex ? nullptr : drmModeGetPlane(fd, localId));
+        uint32_t shown = device->deviceIndex ? plane->fbId : state ? state->fb_id : 0;
+        UniqueDrmFB fb(shown ? drmModeGetFB(fd, shown) : nullptr);
+        plane->blankedFbId     = fb ? shown : 0;
+        plane->blankedFbWidth  = fb ? fb->width : 0;
+        plane->blankedFbHeight = fb ? fb->height : 0;
+    }
+
+    uint32_t fbId = blank ? device->blankFbId : plane->blankedFbId;
+    if (!blank && fbId) {
+        // Players remove their buffers while the window is black, as on a channel change. The plane then stays
+        // detached until the next one is attached.
+        UniqueDrmFB fb(drmModeGetFB(fd, fbId));
+        if (!fb || fb->width != plane->blankedFbWidth || fb->height != plane->blankedFbHeight) {
+            LOG_DEBUG("buffer %u of plane %u is gone, unblanking detaches it", fbId, planeId);
+            fbId = 0;
+        }
+    }
+    uint32_t srcX = 0, srcY = 0, srcW = 1, srcH = 1;
+    if (!blank) {
+        srcX = src.x;
+        srcY = src.y;
+        srcW = src.w;
+        srcH = src.h;
+    }
+    detached = !fbId;
+    if (detached)
+        crtcId = 0;
+
+    auto commit = [fd, localId, crtcId, fbId, out, srcX, srcY, srcW, srcH]() {
+        TRACE_SCOPE(TRACE_DRM, "drmModeSetPlane", localId);
+        if (drmModeSetPlane(fd, localId, crtcId, fbId, 0, out.x, out.y, fbId ? out.w : 0, fbId ? out.h : 0,
+                            srcX << 16, srcY << 16, srcW << 16, srcH << 16)) {
+            LOG_ERROR(MSGID_DRM_SET_PLANE_FAILED, 0, "plane %u: %s", localId, strerror(errno));
+            return false;
+        }
+        return true;
+    };
+    if (device->deviceIndex)
+        device->worker->post(CommitWorker::planeKey(localId, PLANE_COMMIT_STATE), commit);
+    else if (!commit())
+        return false;
+
+    LOG_DEBUG("plane %u %s with fb %u", planeId, blank ? "blanked" : "unblanked", fbId);
+    plane->blanked = blank;
+    plane->fbId    = fbId;
+    if (!blank)
+        plane->blankedFbId = 0;
+    return true;
+}
+
+bool DRIElements::requestVblank(DriDevice &device, DrmCrtc &crtc)
+{
+    if (crtc.vblank.pending)
+        return true;
+
+    drmVBlank vbl;
+    memset(&vbl, 0, sizeof(vbl));
+    vbl.request.type = static_cast<drmVBlankSeqType>(DRM_VBLANK_RELATIVE | DRM_VBLANK_EVENT);
+    if (crtc.crtc_index == 1)
+        vbl.request.type = static_cast<drmVBlankSeqType>(vbl.request.type | DRM_VBLANK_SECONDARY);
+    else if (crtc.crtc_index > 1)
+        vbl.request.type = static_cast<drmVBlankSeqType>(
+            vbl.request.type | ((crtc.crtc_index << DRM_VBLANK_HIGH_CRTC_SHIFT) & DRM_VBLANK_HIGH_CRTC_MASK));
+    vbl.request.sequence = 1;
+    crtc.vblank.owner    = this;
+    crtc.vblank.crtcId   = device.toGlobalId(crtc.mCrtc->crtc_id);
+    vbl.request.signal   = reinterpret_cast<unsigned long>(&crtc.vblank);
+    if (drmWaitVBlank(device.drmModuleFd, &vbl)) {
+        LOG_WARNING(MSGID_DEVICE_ERROR, 0, "Failed to request a vblank event on crtc %u: %s", crtc.mCrtc->crtc_id,
+                    strerror(errno));
+        return false;
+    }
+    crtc.vblank.pending = true;
+
+    if (!device.eventSource)
+        device.eventSource = g_unix_fd_add(device.drmModuleFd, G_IO_IN, onDrmEvent, nullptr);
+    return true;
+}
+
+gboolean DRIElements::onDrmEvent(gint fd, GIOCondition condition, gpointer userData)
+{
+    drmEventContext context;
+    memset(&context, 0, sizeof(context));
+    context.version        = 2;
+    context.vblank_handler = onVblank;
+    drmHandleEvent(fd, &context);
+    return G_SOURCE_CONTINUE;
+}
+
+void DRIElements::onVblank(int fd, unsigned int sequence, unsigned int sec, unsigned int usec, void *userData)
+{
+    VblankTicket *ticket = static_cast<VblankTicket *>(userData);
+    TRACE_INSTANT(TRACE_VBLANK, "vblank", ticket->crtcId);
+    ticket->pending = false;
+    ticket->owner->stepFades(ticket->crtcId, static_cast<gint64>(sec) * G_USEC_PER_SEC + usec);
+}
+
+void DRIElements::stepFades(uint32_t crtcId, gint64 now)
+{
+    // The alpha follows the time of the vblank, so that a late or missed event does not slow the fade down.
+    bool more = false;
+    for (auto fade = mFades.begin(); fade != mFades.end();) {
+        if (fade->crtcId != crtcId) {
+            ++fade;
+            continue;
+        }
+        uint32_t localId  = 0;
+        DriDevice *device = findDevice(fade->planeId, localId);
+        DrmPlane *plane   = device ? device->findPlane(localId) : nullptr;
+        if (!plane) {
+            fade = mFades.erase(fade);
+            continue;
+        }
+        gint64 elapsed = std::min(std::max<gint64>(now - fade->start, 0), fade->duration);
+        uint64_t alpha = fade->from + (static_cast<int64_t>(fade->to) - fade->from) * elapsed / fade->duration;
+        if (alpha != plane->alpha.value)
+            setPlaneProperty(*device, localId, plane->alpha, alpha);
+        if (elapsed >= fade->duration) {
+            LOG_DEBUG("plane %u faded to %u", fade->planeId, fade->to);
+            fade = mFades.erase(fade);
+            continue;
+        }
+        more = true;
+        ++fade;
+    }
+    if (!more)
+        return;
+
+    DriDevice *device = nullptr;
+    DrmCrtc *crtc     = findCrtc(crtcId, device);
+    if (crtc && requestVblank(*device, *crtc))
+        return;
+    // The crtc went away or off, the fades jump to where they are headed.
+    for (auto fade = mFades.begin(); fade != mFades.end();) {
+        if (fade->crtcId != crtcId) {
+            ++fade;
+            continue;
+        }
+        uint32_t localId = 0;
+        device           = findDevice(fade->planeId, localId);
+        DrmPlane *plane  = device ? device->findPlane(localId) : nullptr;
+        if (plane)
+            setPlaneProperty(*device, localId, plane->alpha, fade->to);
+        fade = mFades.erase(fade);
+    }
+}
+
+bool DRIElements::postPlaneProperties(DriDevice &device, PLANE_PROPS_T propType, uint32_t planeId, uint64_t value)
+{
+    // Only the vc4 kernel knows the fake plane properties. Scaling and detaching map to a plain SetPlane on other
+    // drivers, the z order is fixed there.
+    int fd          = device.drmModuleFd;
+    uint32_t crtcId = device.findCrtc(planeId);
+    if (propType == SET_PLANE_FB_T && !value) {
+        device.worker->post(CommitWorker::planeKey(planeId, PLANE_COMMIT_STATE), [fd, planeId]() {
+            if (drmModeSetPlane(fd, planeId, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0))
+                LOG_ERROR(MSGID_DRM_SET_PLANE_FAILED, 0, "plane %u: %s", planeId, strerror(errno));
+        });
+        return true;
+    }
+    if (propType != SET_SCALING_T || !crtcId) {
+        LOG_WARNING(MSGID_DRM_SET_PROP_FAILED, 0, "Property %#x is not supported on %s", propType,
+                    device.deviceName.c_str());
+        return false;
+    }
+
+    // The value points to the caller's parameters, they are copied before the call returns.
+    scale_param_t scale = *reinterpret_cast<const scale_param_t *>(static_cast<uintptr_t>(value));
+    // The plane keeps the buffer the commits queued before this one attach.
+    device.worker->post(CommitWorker::planeKey(planeId, PLANE_COMMIT_GEOMETRY), [fd, planeId, crtcId, scale]() {
+        UniqueDrmPlane plane(drmModeGetPlane(fd, planeId));
+        if (!plane || !plane->fb_id)
+            return;
+        if (drmModeSetPlane(fd, planeId, crtcId, plane->fb_id, 0, scale.crtc_x, scale.crtc_y, scale.crtc_w,
+                            scale.crtc_h, scale.src_x << 16, scale.src_y << 16, scale.src_w << 16, scale.src_h << 16))
+            LOG_ERROR(MSGID_DRM_SET_PLANE_FAILED, 0, "plane %u: %s", planeId, strerror(errno));
+    });
+    return true;
+}
+
+bool DRIElements::setPrimaryPlaneEnabled(uint32_t crtcId, bool enable)
+{
+    TRACE_SCOPE(TRACE_DRM, "setPrimaryPlaneEnabled", crtcId);
+    DriDevice *device = nullptr;
+    DrmCrtc *crtc     = findCrtc(crtcId, device);
+    if (!crtc || !crtc->primaryPlaneId || !crtc->scanout_fbId)
+        return false;
+    uint32_t localId = crtc->mCrtc->crtc_id;
+    if (crtc->primaryElided == !enable)
+        return true;
+
+    int fd           = device->drmModuleFd;
+    uint32_t planeId = crtc->primaryPlaneId;
+    uint32_t fbId    = crtc->scanout_fbId;
+    uint32_t w = crtc->active.w, h = crtc->active.h;
+    if (enable) {
+        auto restore = [fd, planeId, localId, fbId, w, h]() {
+            if (drmModeSetPlane(fd, planeId, localId, fbId, 0, 0, 0, w, h, 0, 0, w << 16, h << 16)) {
+                LOG_ERROR(MSGID_DRM_SET_PLANE_FAILED, 0, "Failed to restore primary plane %u: %s", planeId,
+                          strerror(errno));
+                return false;
+            }
+            return true;
+        };
+        if (device->deviceIndex)
+            device->worker->post(0, restore);
+        else if (!restore())
+            return false;
+        crtc->restorePrimaryAccounting();
+        LOG_DEBUG("primary plane %u restored on crtc %u", planeId, crtcId);
+        return true;
+    }
+
+    // Letterbox areas are filled by the HVS background. Use the crtc background colour where the kernel offers it,
+    // vc4 otherwise enables its black background fill itself when no plane covers the whole screen.
+    uint32_t bgProp = device->getPropertyId(localId, DRM_MODE_OBJECT_CRTC, "BACKGROUND_COLOR");
+    auto detach     = [fd, planeId, localId, bgProp]() {
+        if (bgProp && drmModeObjectSetProperty(fd, localId, DRM_MODE_OBJECT_CRTC, bgProp, CRTC_BACKGROUND_BLACK)) {
+            LOG_WARNING(MSGID_DRM_SET_PROP_FAILED, 0, "Failed to set background colour on crtc %u: %s", localId,
+                        strerror(errno));
+        }
+        if (drmModeSetPlane(fd, planeId, localId, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0)) {
+            LOG_ERROR(MSGID_DRM_SET_PLANE_FAILED, 0, "Failed to detach primary plane %u: %s", planeId,
+                      strerror(errno));
+            return false;
+        }
+        return true;
+    };
+    if (device->deviceIndex)
+        device->worker->post(0, detach);
+    else if (!detach())
+        return false;
+    crtc->primaryElided = true;
+    crtc->elidedSince   = g_get_monotonic_time();
+    crtc->primaryElisions++;
+    LOG_DEBUG("primary plane %u detached on crtc %u", planeId, crtcId);
+    return true;
+}
+
+bool DRIElements::isPrimaryPlaneEnabled(uint32_t crtcId)
+{
+    DriDevice *device = nullptr;
+    DrmCrtc *crtc     = findCrtc(crtcId, device);
+    return !crtc || !crtc->primaryElided;
+}
+
+PrimaryPlaneStats DRIElements::getPrimaryPlaneStats()
+{
+    PrimaryPlaneStats stats;
+    gint64 now = g_get_monotonic_time();
+    for (auto &devPair : mDeviceList) {
+        for (auto &crtc : devPair.second.crtcList) {
+            stats.elisions += crtc.primaryElisions;
+            stats.bytesSaved += crtc.primaryBytesSaved;
+            if (crtc.primaryElided) {
+                stats.bytesPerFrame += crtc.scanoutBytesPerFrame();
+                stats.bytesSaved += crtc.scanoutBytesPerFrame() * crtc.vrefresh *
+                                    static_cast<uint64_t>(now - crtc.elidedSince) / G_USEC_PER_SEC;
+            }
+        }
+    }
+    return stats;
+}
+
+bool DRIElements::setDisplayPower(uint32_t crtcId, bool on)
+{
+    TRACE_SCOPE(TRACE_DRM, "setDisplayPower", crtcId);
+    DriDevice *device = nullptr;
+    DrmCrtc *crtc     = findCrtc(crtcId, device);
+    if (!crtc || !crtc->connectors.size())
+        return false;
+
+    // Other devices may block while their sinks wake up, they are set on their worker.
+    int fd = device->drmModuleFd;
+    for (auto connId : crtc->connectors) {
+        uint32_t prop = device->getPropertyId(connId, DRM_MODE_OBJECT_CONNECTOR, "DPMS");
+        auto dpms     = [fd, connId, prop, on]() {
+            if (!prop || drmModeConnectorSetProperty(fd, connId, prop, on ? DRM_MODE_DPMS_ON : DRM_MODE_DPMS_OFF)) {
+                LOG_ERROR(MSGID_DRM_SET_PROP_FAILED, 0, "Failed to set DPMS on connector %u: %s", connId,
+                          strerror(errno));
+                return false;
+            }
+            return true;
+        };
+        if (device->deviceIndex)
+            device->worker->post(0, dpms);
+        else if (!dpms())
+            return false;
+    }
+    crtc->displayOff = !on;
+    return true;
+}
+
+PowerStats DRIElements::getPowerStats()
+{
+    PowerStats stats;
+    stats.disables = mCrtcDisables;
+    for (auto &devPair : mDeviceList) {
+        for (auto &crtc : devPair.second.crtcList) {
+            if (crtc.idle) {
+                stats.idleCrtcs++;
+                stats.bytesReleased += crtc.idleBytes;
+                stats.fetchSaved += crtc.idleFetch;
+            }
+            if (crtc.displayOff)
+                stats.displaysOff++;
+        }
+    }
+    return stats;
+}
+
 uint32_t DRIElements::getPlaneBase() { return getPlanes()[0]; }
 
-uint32_t DRIElements::getCrtcId(uint32_t planeId) { return mDeviceList[mPrimaryDev].findCrtc(planeId); }
+DrmCrtc *DRIElements::findCrtc(uint32_t crtcId, DriDevice *&device)
+{
+    uint32_t localId = 0;
+    device           = findDevice(crtcId, localId);
+    if (!device)
+        return nullptr;
+    auto crtc = std::find_if(device->crtcList.begin(), device->crtcList.end(),
+                             [localId](DrmCrtc &c) { return c.mCrtc->crtc_id == localId; });
+    return crtc != device->crtcList.end() ? &*crtc : nullptr;
+}
 
-uint32_t DRIElements::getConnId(uint32_t planeId) { return mDeviceList[mPrimaryDev].findConnector(planeId); }
+uint32_t DRIElements::getCrtcId(uint32_t planeId)
+{
+    uint32_t localId  = 0;
+    DriDevice *device = findDevice(planeId, localId);
+    return device ? device->toGlobalId(device->findCrtc(localId)) : 0;
+}
+
+uint32_t DRIElements::getConnId(uint32_t planeId)
+{
+    uint32_t localId  = 0;
+    DriDevice *device = findDevice(planeId, localId);
+    return device ? device->toGlobalId(device->findConnector(localId)) : 0;
+}
+
+std::string DRIElements::getDeviceNode(uint32_t objectId)
+{
+    uint32_t localId  = 0;
+    DriDevice *device = findDevice(objectId, localId);
+    return device ? device->deviceName : std::string();
+}
@@ -29,13 +29,38 @@
 #include <glib.h>
 #include <set>
 #include <val/val_video.h>
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "bufferPool.h"
 #include "buffers.h"
+#include "drmHandles.h"
 #include "edid.h"
 #include "logging.h"
+#include "modeCache.h"
+#include "pictureAdjust.h"
+#include "trace.h"
 // clang-format on
 
 #define DEFAULT_PIXEL_FORMAT DRM_FORMAT_XRGB8888
+// Refresh rates within 1/FRAME_RATE_TOLERANCE of a multiple of the content rate play without judder.
+// This tells 24 and 23.976 apart (1/1001) while absorbing the pixel clock rounding of the modes.
+#define FRAME_RATE_TOLERANCE 5000
+#define MAX_FRAME_RATE_CADENCE 1000
+// Opaque black in the 16 bit per component ARGB layout of the BACKGROUND_COLOR crtc property
+#define CRTC_BACKGROUND_BLACK (0xffffULL << 48)
+// Crtc, connector and plane ids handed out by DRIElements carry the index of their device above this bit. The
+// primary device has index 0, so its ids are the plain DRM object ids.
+#define DEVICE_ID_SHIFT 24
+#define DEVICE_OBJECT_MASK ((1u << DEVICE_ID_SHIFT) - 1)
+#define PRIMARY_DRM_DRIVER "vc4"
+// Value of the plane alpha property for a fully opaque plane
+#define PLANE_ALPHA_OPAQUE 0xffff
+#define PLANE_ROTATE_MASK (DRM_MODE_ROTATE_0 | DRM_MODE_ROTATE_90 | DRM_MODE_ROTATE_180 | DRM_MODE_ROTATE_270)
+#define PLANE_REFLECT_MASK (DRM_MODE_REFLECT_X | DRM_MODE_REFLECT_Y)
 class DRIElements;
 class DriDevice;
 class DrmDisplayMode
@@ -67,25 +92,11 @@ struct compare_VAL_VIDEO_SIZE {
 };
 struct DrmConnector {
 
-    DrmConnector(int fd, drmModeConnectorPtr pConnector);
-    void copy(const DrmConnector &other)
-    {
-        mConnectorPtr = other.mConnectorPtr;
-        mProps        = other.mProps;
-        props_info    = other.props_info;
-        mDrmModulefd  = other.mDrmModulefd;
-        mName         = other.mName;
-        crtc_id       = other.crtc_id;
-    };
-    DrmConnector(const DrmConnector &other) { copy(other); }
-    DrmConnector &operator=(const DrmConnector &other)
-    {
-        copy(other);
-        return *this;
-    }
-
-    DrmConnector(){};
-    ~DrmConnector(){};
+    DrmConnector(int fd, UniqueDrmConnector connector);
+    DrmConnector(DrmConnector &&) = default;
+    DrmConnector &operator=(DrmConnector &&) = default;
+    DrmConnector(const DrmConnector &) = delete;
+    DrmConnector &operator=(const DrmConnector &) = delete;
 
     void setCrtcId(int id) { crtc_id = id; }
 
@@ -93,18 +104,24 @@ struct DrmConnector {
     std::vector<VAL_VIDEO_SIZE_T> getSupportedModes();
     bool getModeRange(DrmDisplayMode &min, DrmDisplayMode &max);
     DrmDisplayMode getMode(const std::string mode_name, const uint32_t vRefresh = 0);
+    DrmDisplayMode getModeForFrameRate(uint32_t width, uint32_t height, uint32_t frameRate);
     Edid getEdid();
+    static Edid readEdid(int fd, const drmModeConnector &connector);
     std::string getName() { return mName; }
 
     bool isPlugged();
+    // Hash of the probed mode list, compared across hotplug events.
+    uint64_t getModesHash();
     // void readProperties();
 
     int mDrmModulefd = -1; // is this needed
     uint32_t crtc_id = 0;  // connected to crtc
     std::string mName;
-    drmModeConnector *mConnectorPtr = nullptr;
-    drmModeObjectProperties *mProps = nullptr;
-    drmModePropertyRes **props_info = nullptr;
+    UniqueDrmConnector mConnectorPtr;
+
+    // Probed state at the last hotplug event, isPlugged() probes again whenever it is called.
+    bool configuredPlugged   = false;
+    uint64_t configuredModes = 0;
 
     friend DRIElements;
     friend DriDevice;
@@ -112,66 +129,179 @@ struct DrmConnector {
 
 class DrmEncoder
 {
-    drmModeEncoder *mEncoder = nullptr;
+    UniqueDrmEncoder mEncoder;
 
 public:
-    DrmEncoder(drmModeEncoder *encoder) : mEncoder(encoder){};
+    DrmEncoder(UniqueDrmEncoder encoder) : mEncoder(std::move(encoder)){};
 };
 
-struct DrmCrtc {
+// Passed with a vblank event request, to find the crtc again when the event arrives.
+struct VblankTicket {
+    DRIElements *owner = nullptr;
+    uint32_t crtcId    = 0; // as handed out by DRIElements
+    bool pending       = false;
+};
 
-    DrmCrtc(drmModeCrtc *crtc, uint32_t index) : mCrtc(crtc), crtc_index(index){};
+// A standard property of a DRM object, as read when the device is opened.
+struct DrmProperty {
+    uint32_t id    = 0; // 0 if the object does not have it
+    uint64_t min   = 0; // range of range properties
+    uint64_t max   = 0;
+    uint64_t value = 0; // last value set
+    bool immutable = false;
+    std::vector<std::pair<std::string, uint64_t>> enums; // names and values of enum and bitmask properties
 
-    void copy(const DrmCrtc &other)
-    {
-        mCrtc        = other.mCrtc;
-        boHandle     = other.boHandle;
-        scanout_fbId = other.scanout_fbId;
-        connectors   = other.connectors;
-        crtc_index   = other.crtc_index;
-        max.w        = other.max.w;
-        max.h        = other.max.h;
-        min.w        = other.min.w;
-        min.h        = other.min.h;
-    }
+    bool findEnum(const std::string &name, uint64_t &enumValue) const;
+};
 
-    DrmCrtc(const DrmCrtc &crtc) { copy(crtc); };
+struct DrmCrtc {
 
-    DrmCrtc &operator=(const DrmCrtc &crtc)
-    {
-        copy(crtc);
-        return *this;
-    };
+    DrmCrtc(UniqueDrmCrtc crtc, uint32_t index) : mCrtc(std::move(crtc)), crtc_index(index){};
+    DrmCrtc(DrmCrtc &&) = default;
+    DrmCrtc &operator=(DrmCrtc &&) = default;
+    DrmCrtc(const DrmCrtc &) = delete;
+    DrmCrtc &operator=(const DrmCrtc &) = delete;
 
-    int createScanoutFb(const int fd, const uint32_t width, const uint32_t height);
+    void setModeRange(const drmModeModeInfo &minMode, const drmModeModeInfo &maxMode, const VAL_VIDEO_SIZE_T &confMode);
+    uint64_t scanoutBytesPerFrame() const;
+    void restorePrimaryAccounting();
 
-    drmModeCrtc *mCrtc = nullptr;
+    UniqueDrmCrtc mCrtc;
     std::set<uint32_t> connectors;
-    uint32_t scanout_fbId = 0;
-    uint32_t crtc_index   = 0;
-    struct bo *boHandle   = nullptr;
-    VAL_VIDEO_SIZE_T max  = {};
-    VAL_VIDEO_SIZE_T min  = {};
+    uint32_t scanout_fbId   = 0;
+    uint32_t crtc_index     = 0;
+    struct bo *boHandle     = nullptr;
+    VAL_VIDEO_SIZE_T max    = {};
+    VAL_VIDEO_SIZE_T min    = {};
+    VAL_VIDEO_SIZE_T active = {}; // mode currently set on the crtc
+    uint32_t vrefresh       = 0;
+    drmModeModeInfo mode    = {};
+
+    // Primary plane scanning out boHandle, detached while a video plane covers the whole screen.
+    uint32_t primaryPlaneId    = 0;
+    bool primaryElided         = false;
+    gint64 elidedSince         = 0;
+    uint64_t primaryElisions   = 0;
+    uint64_t primaryBytesSaved = 0;
+
+    // Turned off while no sink is connected. mode is kept to bring the crtc back on replug.
+    bool idle          = false;
+    uint64_t idleBytes = 0;     // scanout buffer released
+    uint64_t idleFetch = 0;     // scanout fetches avoided, bytes per second
+    bool displayOff    = false; // connectors in DPMS off
+
+    VblankTicket vblank;
+
+    // Colour management, GAMMA_LUT and CTM blobs. Without GAMMA_LUT the legacy gamma table of gamma_size is used.
+    DrmProperty gammaLut;
+    DrmProperty gammaLutSize;
+    DrmProperty ctm;
+    PictureSettings picture; // as last applied
 
     friend DRIElements;
 };
 
 struct DrmPlane {
-    drmModePlane *mDrmPlane;
-
-    DrmPlane(drmModePlane *drmPlane) : mDrmPlane(drmPlane) {}
+    UniqueDrmPlane mDrmPlane;
+    DrmProperty zpos;
+    DrmProperty alpha;
+    DrmProperty blendMode;
+    DrmProperty rotation;
+    DrmProperty colorEncoding;
+    DrmProperty colorRange;
+
+    // Buffer last attached through DRIElements. Players attach theirs to planes of the primary device themselves.
+    uint32_t fbId = 0;
+
+    // While blanked the plane shows the black buffer of the device, or nothing. blankedFbId is what it showed, its
+    // size tells it from a buffer that took the id after it was removed.
+    bool blanked             = false;
+    uint32_t blankedFbId     = 0;
+    uint32_t blankedFbWidth  = 0;
+    uint32_t blankedFbHeight = 0;
+
+    DrmPlane(UniqueDrmPlane drmPlane) : mDrmPlane(std::move(drmPlane)) {}
 
     friend std::ostream &operator<<(std::ostream &os, const DrmPlane &dm);
 };
 
 void dumpProperties(std::ostream &os, drmModePropertyPtr prop, uint32_t prop_id, uint64_t value);
+// Exact refresh rate of the mode in mHz, from the pixel clock and the totals.
+uint32_t getRefreshMilliHz(const drmModeModeInfo &mode);
+// True if content at frameRate (mHz) plays on refresh (mHz) with every frame shown the same number of times.
+bool isFrameRateCadence(uint32_t refresh, uint32_t frameRate);
+
+// A modeset with its new scanout buffer. commit() only uses the fields below, so it can run on any thread, while
+// the crtc state is read before and updated after it on the main context.
+struct ModeChange {
+    int fd          = -1;
+    uint32_t crtcId = 0;
+    std::vector<uint32_t> connectors;
+    drmModeModeInfo mode = {};
+    struct bo *bo        = nullptr;
+    uint32_t fbId        = 0;
+    int result           = -1;
+    std::function<void(bool)> done;
+
+    // Allocates and clears the buffer, then sets the crtc. Blocks while the sink relocks.
+    void commit();
+
+    // Set for changes run on the commit worker, to finish them on the main context.
+    DRIElements *owner = nullptr;
+    DriDevice *device  = nullptr;
+};
+
+// Kinds of coalesced plane commits. A state commit sets the buffer and the geometry of the plane, a geometry commit
+// moves whatever buffer the plane shows when it runs, so it depends on the state commits queued before it.
+enum PLANE_COMMIT_T { PLANE_COMMIT_STATE = 1, PLANE_COMMIT_GEOMETRY = 2 };
+
+// Runs the DRM commits of one device in order on a thread of its own, so that a slow device, such as a display
+// behind USB, only delays its own updates.
+class CommitWorker
+{
+public:
+    CommitWorker();
+    ~CommitWorker(); // runs the jobs already queued
+    CommitWorker(const CommitWorker &) = delete;
+    CommitWorker &operator=(const CommitWorker &) = delete;
+
+    // Key of a commit of a plane, by its id on the device.
+    static uint32_t planeKey(uint32_t planeId, PLANE_COMMIT_T kind) { return planeId << 2 | kind; }
+    // A job with a non-zero key drops the queued jobs it supersedes: those with the same key and, for a state
+    // commit, the geometry commits of the same plane. It is queued last, after every job posted before it.
+    void post(uint32_t key, std::function<void()> job);
+    uint64_t getReplaced() { return mReplaced; }
+
+private:
+    void run();
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<std::pair<uint32_t, std::function<void()>>> mJobs;
+    bool mStop         = false;
+    uint64_t mReplaced = 0;
+    std::thread mThread;
+};
+
+// What a hotplug event changed on one connector.
+struct HotplugChange {
+    uint32_t connectorId = 0;
+    uint32_t crtcId      = 0; // crtc driving the connector, 0 if none could be assigned
+    bool plugged         = false;
+    bool wasPlugged      = false;
+    bool modesChanged    = false;
+};
+typedef std::vector<HotplugChange> HotplugChangeSet;
 
 class DriDevice
 {
 public:
     std::string deviceName; //"/dev/dri/card0"
+    std::string driverName;
+    uint32_t deviceIndex    = 0; // see DEVICE_ID_SHIFT
     int drmModuleFd         = -1;
     bool hasDumbBuffChecked = false;
+    bool hasUniversalPlanes = false;
 
     std::vector<DrmConnector> connectorList;
     std::vector<DrmEncoder> encoderList;
@@ -187,45 +317,182 @@ public:
     uint32_t findCrtc(uint32_t planeId);
     uint32_t findConnector(uint32_t planeId);
     int hasDumbBuff();
+    uint32_t getPropertyId(uint32_t objectId, uint32_t objectType, const std::string &name);
+    bool getProperty(uint32_t objectId, uint32_t objectType, const std::string &name, DrmProperty &property);
+    DrmPlane *findPlane(uint32_t planeId);
 
-    int setupDevice(VAL_VIDEO_SIZE_T &confMode);
+    // Probes the connector, or all of them for 0, and sets up those whose state changed since the last call.
+    int setupDevice(VAL_VIDEO_SIZE_T &confMode, uint32_t connectorId, HotplugChangeSet &changes);
+    void setupConnector(DrmConnector &conn, VAL_VIDEO_SIZE_T &confMode);
     int geModeRange(VAL_VIDEO_SIZE_T &minSize, VAL_VIDEO_SIZE_T &maxSize);
 
     DriDevice() {}
+    DriDevice(const DriDevice &) = delete;
+    DriDevice &operator=(const DriDevice &) = delete;
 
+    // Waits for the commits of the device, releases its scanout buffers and pooled buffers, and closes it.
     ~DriDevice();
 
+    // Id of one of the objects of the device as handed out by DRIElements.
+    uint32_t toGlobalId(uint32_t objectId) const { return objectId ? objectId | (deviceIndex << DEVICE_ID_SHIFT) : 0; }
+
+    std::unique_ptr<CommitWorker> worker;
+    std::unique_ptr<ModeChange> modeChange; // in flight on the worker
+    std::mutex modeChangeMutex;
+    guint modeChangeSource = 0;
+    guint eventSource      = 0; // DRM events on drmModuleFd, once a vblank event has been requested
+
+    // A 1x1 black buffer, scaled to the output of windows that are blanked. Allocated with the device, so that
+    // blanking never allocates.
+    struct bo *blankBo = nullptr;
+    uint32_t blankFbId = 0;
+    void createBlankFb();
+
     int setActiveMode(DrmCrtc &, const uint32_t width, const uint32_t vRefreshheight, const uint32_t vRefresh = 0);
+    bool findMode(DrmCrtc &crtc, const uint32_t width, const uint32_t height, const uint32_t vRefresh,
+                  drmModeModeInfo &mode);
+    int applyMode(DrmCrtc &crtc, drmModeModeInfo &mode);
+    void prepareModeChange(DrmCrtc &crtc, const drmModeModeInfo &mode, ModeChange &change);
+    // Swaps in the new scanout buffer after a successful commit, releases it otherwise.
+    int finishModeChange(ModeChange &change);
+    // Detaches the planes of the crtc, turns it off and releases its scanout buffer.
+    bool disableCrtc(DrmCrtc &crtc);
 
     friend DRIElements;
 };
 
 typedef enum { SET_PLANE_FB_T = 0xff01, SET_Z_ORDER_T = 0xff02, SET_SCALING_T = 0xff03 } PLANE_PROPS_T;
 
+// Value of SET_SCALING_T, passed by address.
+typedef struct {
+    /* Signed dest location allows it to be partially off screen */
+    int32_t crtc_x, crtc_y;
+    uint32_t crtc_w, crtc_h;
+
+    /* Source values are 16.16 fixed point */
+    uint32_t src_x, src_y;
+    uint32_t src_h, src_w;
+} scale_param_t;
+
 typedef enum { PRIMARY = 0, OVERLAY, CURSOR, NONE } PLANE_TYPES_T;
 
+struct PrimaryPlaneStats {
+    uint64_t elisions      = 0; // number of times a primary plane has been detached
+    uint64_t bytesSaved    = 0; // scanout fetches avoided while detached
+    uint64_t bytesPerFrame = 0; // current saving per frame
+};
+
+struct HotplugStats {
+    uint64_t received    = 0; // udev events
+    uint64_t processed   = 0; // updateDevice calls they turned into
+    uint64_t leadingEdge = 0; // events processed as soon as they arrived
+};
+
+// YCbCr to RGB conversion of a plane scanning out YUV buffers.
+typedef enum { COLOR_ENCODING_BT601 = 0, COLOR_ENCODING_BT709, COLOR_ENCODING_BT2020 } COLOR_ENCODING_T;
+
+struct PlaneColor {
+    std::string encoding; // enum names of the COLOR_ENCODING and COLOR_RANGE properties, empty without them
+    std::string range;
+    std::vector<std::string> encodings;
+    std::vector<std::string> ranges;
+};
+
+struct PlaneBlend {
+    bool hasAlpha  = false;
+    uint16_t alpha = PLANE_ALPHA_OPAQUE;
+    std::string mode; // pixel blend mode, empty if the plane has none
+    std::vector<std::string> modes;
+    bool fading = false;
+};
+
+struct PowerStats {
+    uint32_t idleCrtcs     = 0; // crtcs turned off for lack of a sink
+    uint64_t disables      = 0;
+    uint64_t bytesReleased = 0; // scanout memory currently given back
+    uint64_t fetchSaved    = 0; // scanout fetches currently avoided, bytes per second
+    uint32_t displaysOff   = 0; // crtcs whose sinks are in DPMS off
+};
+
 class DRIElements
 {
 public:
-    DRIElements(VAL_VIDEO_SIZE_T defResolution, std::function<void()>);
+    DRIElements(VAL_VIDEO_SIZE_T defResolution, std::function<void(const HotplugChangeSet &)>,
+                const std::string &modeCachePath = "", const std::vector<BufferClass> &bufferClasses = {},
+                uint64_t memoryBudget = 0);
     virtual ~DRIElements();
     DRIElements& operator=(const DRIElements&) = delete; // no copy
     DRIElements& operator=(DRIElements&&) = delete; // no move
 
-    std::string mPrimaryDev;
+    std::string mPrimaryDev; // the vc4 device if there is one, devices are added to mDeviceList as they appear
     int changeMode(uint32_t width, uint32_t height, uint8_t display_path, uint32_t vRefresh = 0);
+    // changeMode with the buffer allocation and the modeset on a worker thread. Returns false if the change could
+    // not be started, otherwise done is called with the result from the GLib main context.
+    bool changeModeAsync(uint32_t width, uint32_t height, uint8_t display_path, uint32_t vRefresh,
+                         std::function<void(bool)> done);
+    bool isModeChangePending();
     std::unordered_map<std::string, DriDevice> mDeviceList;
+    // Overlay planes of the crtcs with a sink, primary device first.
     std::vector<uint32_t> getPlanes();
     PLANE_TYPES_T getPlaneType(int deviceFd, uint32_t planeId);
     bool setPlane(unsigned int planeId, unsigned int fbId, uint32_t crtc_x, uint32_t crtc_y, uint32_t crtc_w,
                   uint32_t crtc_h, uint32_t src_x, uint32_t src_y, uint32_t src_w, uint32_t src_h);
+    // Connectors of all devices, primary device first, as counted by display paths.
     uint32_t getSupportedNumConnector();
     std::vector<VAL_VIDEO_SIZE_T> getSupportedModes(uint8_t connIndex = 0);
     bool setPlaneProperties(PLANE_PROPS_T propType, uint planeId, uint64_t value);
+    // Stacks the planes in the given order, bottom first, by exchanging their zpos values. Planes on different
+    // devices are stacked independently. Fails without changing anything if a plane cannot take its position, the
+    // planes already moved are put back when a write fails.
+    bool setPlaneOrder(const std::vector<uint32_t> &planeIds);
+    // Plane opacity, 0 for transparent to PLANE_ALPHA_OPAQUE. Stops a fade in progress.
+    bool setPlaneAlpha(uint32_t planeId, uint16_t alpha);
+    // How the pixel alpha is applied, one of the enum names of the plane: "None", "Pre-multiplied", "Coverage".
+    bool setPlaneBlendMode(uint32_t planeId, const std::string &mode);
+    bool getPlaneBlend(uint32_t planeId, PlaneBlend &blend);
+    // DRM_MODE_ROTATE_* and DRM_MODE_REFLECT_* bits the plane supports, 0 if it has no rotation property.
+    uint32_t getPlaneRotations(uint32_t planeId);
+    // Applies the transform, or the equivalent one the plane supports. false if the plane can do neither, the
+    // transform is then left to software and the plane is not rotated.
+    bool setPlaneRotation(uint32_t planeId, uint32_t rotation);
+    // Matrix and range the plane converts YUV buffers with. false if the plane cannot use them.
+    bool setPlaneColor(uint32_t planeId, COLOR_ENCODING_T encoding, bool fullRange);
+    bool getPlaneColor(uint32_t planeId, PlaneColor &color);
+    // DRM fourcc of the buffer the plane shows, 0 if it shows none.
+    uint32_t getPlaneFormat(uint32_t planeId);
+    // Applies the picture settings to everything the crtc scans out, through its gamma LUT and, for saturation,
+    // its CTM. false if the crtc has no gamma table, or no CTM while the saturation is changed. On failure the crtc
+    // keeps the previous settings.
+    bool setCrtcPicture(uint32_t crtcId, const PictureSettings &settings);
+    // The settings last applied to the crtc, neutral until some are.
+    bool getCrtcPicture(uint32_t crtcId, PictureSettings &settings);
+    // Moves the plane alpha to target over duration ms, a step on every vblank of its crtc.
+    bool fadePlane(uint32_t planeId, uint16_t target, uint32_t duration);
+    // Shows black over out instead of the plane's buffer, or the buffer again over out from src. detached is set
+    // if the plane had to be detached because the device has no black buffer, so that it covers nothing.
+    bool setPlaneBlank(uint32_t planeId, bool blank, const VAL_VIDEO_RECT_T &src, const VAL_VIDEO_RECT_T &out,
+                       bool &detached);
     bool getModeRange(uint32_t crtcId, VAL_VIDEO_SIZE_T &minSize, VAL_VIDEO_SIZE_T &maxSize);
+    bool getActiveMode(uint32_t crtcId, VAL_VIDEO_SIZE_T &size, uint32_t &vRefresh);
+    bool getCurrentMode(uint32_t crtcId, drmModeModeInfo &mode);
+    // Mode of the current size whose refresh rate best matches content at frameRate (mHz).
+    bool findModeForFrameRate(uint32_t crtcId, uint32_t frameRate, drmModeModeInfo &mode);
+    bool setMode(uint32_t crtcId, const drmModeModeInfo &mode);
     uint32_t getCrtcId(uint32_t planeId);
     uint32_t getConnId(uint32_t planeId);
+    // Device node the object is on, empty if the device is gone.
+    std::string getDeviceNode(uint32_t objectId);
     uint32_t getPlaneBase();
+    bool setPrimaryPlaneEnabled(uint32_t crtcId, bool enable);
+    bool isPrimaryPlaneEnabled(uint32_t crtcId);
+    PrimaryPlaneStats getPrimaryPlaneStats();
+    // DPMS of the sinks on a crtc, the crtc keeps its mode so that they come back without a modeset.
+    bool setDisplayPower(uint32_t crtcId, bool on);
+    PowerStats getPowerStats();
+    // Events for a connector are merged until it has been quiet for quietWindow ms, and processed at most
+    // once per minInterval ms. An event on a connector that has been idle for minInterval is processed at once.
+    void setHotplugPolicy(uint32_t quietWindow, uint32_t minInterval);
+    HotplugStats getHotplugStats() { return mHotplugStats; }
 
 private:
     class UDev
@@ -235,23 +502,105 @@ private:
         struct udev_list_entry *devices;
         struct udev_monitor *mon;
         int fd;
-        std::function<void(std::string)> updateFun;
+        std::function<void(std::string, uint32_t, bool)> updateFun;
 
     public:
-        UDev(std::function<void(std::string)>);
+        // fn gets the device node, the connector id of the event, 0 when the event does not name one, and whether
+        // the device was removed.
+        UDev(std::function<void(std::string, uint32_t, bool)>);
         static gboolean pollDRIDevices(gpointer userData);
         std::vector<std::string> getDeviceList();
     };
 
     void setupDevicePolling();
     void loadResources();
-    void updateDevice(std::string name);
+    // Opens a card and reads its resources, without touching the outputs.
+    bool openDevice(const std::string &node);
+    void addDevice(const std::string &node);
+    void removeDevice(const std::string &node);
+    // Device of an id handed out by DRIElements, objectId is set to the DRM object id on that device.
+    DriDevice *findDevice(uint32_t id, uint32_t &objectId);
+    DrmCrtc *findCrtc(uint32_t crtcId, DriDevice *&device);
+    // setPlaneProperties for a device other than the primary one, applied on its worker.
+    bool postPlaneProperties(DriDevice &device, PLANE_PROPS_T propType, uint32_t planeId, uint64_t value);
+    // Sets a standard property of a plane, on the worker for devices other than the primary one.
+    bool setPlaneProperty(DriDevice &device, uint32_t planeId, DrmProperty &property, uint64_t value);
+    // Sets a blob property of a crtc to a new blob holding data, or to no blob if size is 0. The blob is released
+    // once set, the crtc keeps its own reference.
+    bool setCrtcBlob(DriDevice &device, uint32_t crtcId, DrmProperty &property, const void *data, uint32_t size);
+
+    // Alpha fades, in ids handed out by DRIElements. Times are g_get_monotonic_time(), as are vblank timestamps.
+    struct PlaneFade {
+        uint32_t planeId = 0;
+        uint32_t crtcId  = 0;
+        uint16_t from    = 0;
+        uint16_t to      = 0;
+        gint64 start     = 0;
+        gint64 duration  = 0;
+    };
+    bool requestVblank(DriDevice &device, DrmCrtc &crtc);
+    static gboolean onDrmEvent(gint fd, GIOCondition condition, gpointer userData);
+    static void onVblank(int fd, unsigned int sequence, unsigned int sec, unsigned int usec, void *userData);
+    void stepFades(uint32_t crtcId, gint64 now);
+    void updateDevice(std::string name, uint32_t connectorId = 0);
+
+    // Hotplug state per device node and connector, connector 0 standing for all of them.
+    struct HotplugState {
+        std::string node;
+        uint32_t connectorId = 0;
+        bool pending         = false;
+        gint64 lastEvent     = 0; // g_get_monotonic_time(), us
+        gint64 lastProcessed = 0;
+    };
+    gint64 hotplugDue(const HotplugState &state) const;
+    void queueHotplug(const std::string &node, uint32_t connectorId);
+    void scheduleHotplugs();
+    static gboolean onHotplugTimeout(gpointer userData);
+
+    // Connector state from a forced probe, done off the main thread to check the modes taken from mModeCache.
+    struct ProbedConnector {
+        uint32_t connectorId;
+        uint64_t edidHash;
+        UniqueDrmConnector connector;
+    };
+    bool applyCachedModes(DriDevice &device);
+    void startModeValidation(DriDevice &device);
+    // Waits for the probe and drops its result.
+    void stopModeValidation();
+    static gboolean onModeValidated(gpointer userData);
+    void validateCachedModes();
+    void storeModeCache(DriDevice &device);
+    // Turns off crtcs whose sinks went away and brings them back when one returns.
+    void updateCrtcPower(DriDevice &device, const HotplugChangeSet &changes);
+
+    DriDevice *beginModeChange(uint32_t width, uint32_t height, uint8_t display_path, uint32_t vRefresh,
+                               ModeChange &change);
+    bool endModeChange(DriDevice &device, ModeChange &change);
+    static gboolean onModeChanged(gpointer userData);
+    void cancelModeChange(DriDevice &device);
 
     guint mTimeOutHandle;
     UDev *mUDev = nullptr;
     friend DriDevice;
 
-    std::function<void()> mValCallBack;
+    std::function<void(const HotplugChangeSet &)> mValCallBack;
     VAL_VIDEO_SIZE_T mInitialMode;    // Set from device_capability config file.
     VAL_VIDEO_SIZE_T mConfiguredMode; // Updated by changeMode or luna command.
+
+    ModeCache mModeCache;
+    std::thread mValidator;
+    std::mutex mValidationMutex;
+    std::vector<ProbedConnector> mProbedConnectors;
+    guint mValidationSource = 0;
+
+    uint64_t mCrtcDisables = 0;
+
+    std::vector<PlaneFade> mFades;
+    std::vector<std::string> mDeviceNodes; // by device index, empty for devices that went away
+
+    std::vector<HotplugState> mHotplugs;
+    guint mHotplugSource         = 0;
+    uint32_t mHotplugQuietWindow = 200;  // ms
+    uint32_t mHotplugMinInterval = 1000; // ms
+    HotplugStats mHotplugStats;
 };
@@ -0,0 +1,43 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <memory>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+// Owning handles for the objects libdrm allocates. They are move-only and free the object with the matching
+// drmModeFree* call when they go out of scope, so a handle stored in a container has exactly one owner.
+
+template <typename T, void (*Free)(T *)> struct DrmFree {
+    void operator()(T *object) const { Free(object); }
+};
+
+typedef std::unique_ptr<drmVersion, DrmFree<drmVersion, drmFreeVersion>> UniqueDrmVersion;
+typedef std::unique_ptr<drmModeRes, DrmFree<drmModeRes, drmModeFreeResources>> UniqueDrmRes;
+typedef std::unique_ptr<drmModePlaneRes, DrmFree<drmModePlaneRes, drmModeFreePlaneResources>> UniqueDrmPlaneRes;
+typedef std::unique_ptr<drmModeConnector, DrmFree<drmModeConnector, drmModeFreeConnector>> UniqueDrmConnector;
+typedef std::unique_ptr<drmModeCrtc, DrmFree<drmModeCrtc, drmModeFreeCrtc>> UniqueDrmCrtc;
+typedef std::unique_ptr<drmModeEncoder, DrmFree<drmModeEncoder, drmModeFreeEncoder>> UniqueDrmEncoder;
+typedef std::unique_ptr<drmModePlane, DrmFree<drmModePlane, drmModeFreePlane>> UniqueDrmPlane;
+typedef std::unique_ptr<drmModeFB, DrmFree<drmModeFB, drmModeFreeFB>> UniqueDrmFB;
+typedef std::unique_ptr<drmModeFB2, DrmFree<drmModeFB2, drmModeFreeFB2>> UniqueDrmFB2;
+typedef std::unique_ptr<drmModePropertyRes, DrmFree<drmModePropertyRes, drmModeFreeProperty>> UniqueDrmProperty;
+typedef std::unique_ptr<drmModePropertyBlobRes, DrmFree<drmModePropertyBlobRes, drmModeFreePropertyBlob>>
+    UniqueDrmPropertyBlob;
+typedef std::unique_ptr<drmModeObjectProperties, DrmFree<drmModeObjectProperties, drmModeFreeObjectProperties>>
+    UniqueDrmObjectProperties;
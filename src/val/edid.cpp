@@ -0,0 +1,391 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "edid.h"
+#include "logging.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <list>
+#include <mutex>
+
+#define EDID_BLOCK_SIZE 128
+#define EDID_CACHE_SIZE 8
+
+#define CEA_EXTENSION_TAG 0x02
+#define CEA_DB_VIDEO 2
+#define CEA_DB_VENDOR 3
+#define CEA_DB_EXTENDED 7
+#define CEA_EXT_DB_HDR_STATIC_METADATA 6
+#define CEA_EXT_DB_Y420_VIDEO 14
+#define CEA_EXT_DB_Y420_CAPABILITY_MAP 15
+#define HDMI_OUI 0x000c03
+#define HDMI_FORUM_OUI 0xc45dd8
+
+static const unsigned char edidHeader[8] = {0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00};
+
+static bool checksumValid(const unsigned char *block)
+{
+    unsigned char sum = 0;
+    for (int i = 0; i < EDID_BLOCK_SIZE; i++)
+        sum += block[i];
+    return sum == 0;
+}
+
+static void parseDetailedTiming(const unsigned char *d, EdidDetailedTiming &t)
+{
+    t.pixelClock    = (d[0] | d[1] << 8) * 10;
+    t.hActive       = d[2] | (d[4] & 0xf0) << 4;
+    t.hBlank        = d[3] | (d[4] & 0x0f) << 8;
+    t.vActive       = d[5] | (d[7] & 0xf0) << 4;
+    t.vBlank        = d[6] | (d[7] & 0x0f) << 8;
+    t.hSyncOffset   = d[8] | (d[11] & 0xc0) << 2;
+    t.hSyncWidth    = d[9] | (d[11] & 0x30) << 4;
+    t.vSyncOffset   = (d[10] >> 4) | (d[11] & 0x0c) << 2;
+    t.vSyncWidth    = (d[10] & 0x0f) | (d[11] & 0x03) << 4;
+    t.widthMm       = d[12] | (d[14] & 0xf0) << 4;
+    t.heightMm      = d[13] | (d[14] & 0x0f) << 8;
+    t.interlaced    = d[17] & 0x80;
+    // Only digital separate sync carries both polarities.
+    t.hSyncPositive = ((d[17] & 0x18) == 0x18) && (d[17] & 0x02);
+    t.vSyncPositive = ((d[17] & 0x18) == 0x18) && (d[17] & 0x04);
+}
+
+static std::string parseDescriptorString(const unsigned char *d)
+{
+    std::string str(reinterpret_cast<const char *>(d + 5), 13);
+    size_t end = str.find('\n');
+    if (end != std::string::npos)
+        str.erase(end);
+    str.erase(str.find_last_not_of(' ') + 1);
+    return str;
+}
+
+static void parseDescriptor(const unsigned char *d, EdidInfo &info)
+{
+    if (d[0] || d[1]) {
+        EdidDetailedTiming t;
+        parseDetailedTiming(d, t);
+        info.detailedTimings.push_back(t);
+        return;
+    }
+
+    switch (d[3]) {
+    case 0xff:
+        info.serialString = parseDescriptorString(d);
+        break;
+    case 0xfc:
+        info.monitorName = parseDescriptorString(d);
+        break;
+    case 0xfd:
+        info.minVRate      = d[5];
+        info.maxVRate      = d[6];
+        info.minHRate      = d[7];
+        info.maxHRate      = d[8];
+        info.maxPixelClock = d[9] * 10000;
+        break;
+    default:
+        break;
+    }
+}
+
+static bool parseBaseBlock(const unsigned char *b, EdidInfo &info)
+{
+    if (memcmp(b, edidHeader, sizeof(edidHeader))) {
+        LOG_ERROR(MSGID_EDID_PARSE_ERROR, 0, "Invalid EDID header");
+        return false;
+    }
+    if (!checksumValid(b)) {
+        LOG_ERROR(MSGID_EDID_PARSE_ERROR, 0, "Invalid EDID base block checksum");
+        return false;
+    }
+
+    info.manufacturer[0] = '@' + ((b[8] >> 2) & 0x1f);
+    info.manufacturer[1] = '@' + (((b[8] & 0x03) << 3) | (b[9] >> 5));
+    info.manufacturer[2] = '@' + (b[9] & 0x1f);
+    info.product         = b[10] | b[11] << 8;
+    info.serial          = b[12] | b[13] << 8 | b[14] << 16 | static_cast<uint32_t>(b[15]) << 24;
+    info.week            = b[16];
+    info.year            = b[17] + 1990;
+    info.version         = b[18];
+    info.revision        = b[19];
+    info.digital         = b[20] & 0x80;
+    if (info.digital && (info.version > 1 || info.revision >= 4)) {
+        uint8_t depth = (b[20] >> 4) & 0x07;
+        info.bpc      = (depth && depth < 7) ? 4 + 2 * depth : 0;
+    }
+    info.widthCm  = b[21];
+    info.heightCm = b[22];
+    info.gamma    = b[23] == 0xff ? 0 : (b[23] + 100) / 100.0f;
+
+    for (int i = 0; i < 4; i++)
+        parseDescriptor(b + 54 + i * 18, info);
+
+    return true;
+}
+
+static void parseVendorBlock(const unsigned char *p, int len, EdidInfo &info)
+{
+    if (len < 3)
+        return;
+    uint32_t oui = p[0] | p[1] << 8 | p[2] << 16;
+
+    if (oui == HDMI_OUI) {
+        info.hdmi = true;
+        if (len >= 5)
+            info.physicalAddress = p[3] << 8 | p[4];
+        if (len >= 6)
+            info.deepColor = p[5] & 0x78;
+        if (len >= 7)
+            info.maxTmdsClock = p[6] * 5000;
+    } else if (oui == HDMI_FORUM_OUI) {
+        info.hdmiForum = true;
+        if (len >= 5)
+            info.maxTmdsCharRate = p[4] * 5000;
+    }
+}
+
+static void parseHdrStaticMetadata(const unsigned char *p, int len, EdidInfo &info)
+{
+    if (len < 3)
+        return;
+    info.hasHdrStaticMetadata = true;
+    info.eotfs                = p[1] & 0x3f;
+    info.metadataTypes        = p[2];
+    if (len >= 4 && p[3])
+        info.maxLuminance = 50.0f * std::pow(2.0f, p[3] / 32.0f);
+    if (len >= 5 && p[4])
+        info.maxFrameAvgLuminance = 50.0f * std::pow(2.0f, p[4] / 32.0f);
+    if (len >= 6 && info.maxLuminance)
+        info.minLuminance = info.maxLuminance * (p[5] / 255.0f) * (p[5] / 255.0f) / 100.0f;
+}
+
+static uint8_t svdToVic(uint8_t svd, uint8_t revision, bool &native)
+{
+    // From CEA-861-F, values 129..192 are native vics 1..64, everything else is a plain 8 bit vic.
+    native = false;
+    if (revision >= 3 && svd >= 129 && svd <= 192) {
+        native = true;
+        return svd & 0x7f;
+    }
+    return svd;
+}
+
+static void parseCeaBlock(const unsigned char *b, EdidInfo &info)
+{
+    if (!checksumValid(b)) {
+        LOG_WARNING(MSGID_EDID_PARSE_ERROR, 0, "Skipping CEA extension with invalid checksum");
+        return;
+    }
+
+    info.hasCea      = true;
+    info.ceaRevision = b[1];
+    int dtdOffset    = std::min<int>(b[2], EDID_BLOCK_SIZE - 1);
+    if (info.ceaRevision >= 2) {
+        info.underscan  = b[3] & 0x80;
+        info.basicAudio = b[3] & 0x40;
+        info.ycbcr444   = b[3] & 0x20;
+        info.ycbcr422   = b[3] & 0x10;
+    }
+
+    // The 4:2:0 capability map indexes the video data block, resolve it once every block is read.
+    const unsigned char *y420Map = nullptr;
+    int y420MapLen               = -1;
+
+    for (int i = 4; info.ceaRevision >= 3 && i < dtdOffset;) {
+        int tag                = b[i] >> 5;
+        int len                = b[i] & 0x1f;
+        const unsigned char *p = b + i + 1;
+        if (i + 1 + len > dtdOffset)
+            break;
+
+        bool native;
+        switch (tag) {
+        case CEA_DB_VIDEO:
+            for (int j = 0; j < len; j++) {
+                uint8_t vic = svdToVic(p[j], info.ceaRevision, native);
+                info.vics.push_back(vic);
+                if (native)
+                    info.nativeVics.push_back(vic);
+            }
+            break;
+        case CEA_DB_VENDOR:
+            parseVendorBlock(p, len, info);
+            break;
+        case CEA_DB_EXTENDED:
+            if (len < 1)
+                break;
+            if (p[0] == CEA_EXT_DB_HDR_STATIC_METADATA) {
+                parseHdrStaticMetadata(p, len, info);
+            } else if (p[0] == CEA_EXT_DB_Y420_VIDEO) {
+                for (int j = 1; j < len; j++)
+                    info.y420OnlyVics.push_back(svdToVic(p[j], info.ceaRevision, native));
+            } else if (p[0] == CEA_EXT_DB_Y420_CAPABILITY_MAP) {
+                y420Map    = p + 1;
+                y420MapLen = len - 1;
+            }
+            break;
+        default:
+            break;
+        }
+        i += len + 1;
+    }
+
+    if (y420MapLen == 0) {
+        // An empty map means every vic of the video data block also supports 4:2:0.
+        info.y420CapableVics = info.vics;
+    } else if (y420MapLen > 0) {
+        for (size_t j = 0; j < info.vics.size() && j / 8 < static_cast<size_t>(y420MapLen); j++) {
+            if (y420Map[j / 8] & (1 << (j % 8)))
+                info.y420CapableVics.push_back(info.vics[j]);
+        }
+    }
+
+    for (int i = dtdOffset; dtdOffset >= 4 && i + 18 <= EDID_BLOCK_SIZE - 1; i += 18) {
+        if (!b[i] && !b[i + 1])
+            break;
+        EdidDetailedTiming t;
+        parseDetailedTiming(b + i, t);
+        info.detailedTimings.push_back(t);
+    }
+}
+
+static std::shared_ptr<const EdidInfo> parse(const std::vector<uint8_t> &blob)
+{
+    std::shared_ptr<EdidInfo> info = std::make_shared<EdidInfo>();
+    if (blob.size() < EDID_BLOCK_SIZE) {
+        LOG_ERROR(MSGID_EDID_PARSE_ERROR, 0, "EDID too short: %zu bytes", blob.size());
+        return info;
+    }
+    if (!parseBaseBlock(blob.data(), *info))
+        return info;
+
+    size_t extensions = blob[126];
+    for (size_t n = 1; n <= extensions && (n + 1) * EDID_BLOCK_SIZE <= blob.size(); n++) {
+        const unsigned char *ext = blob.data() + n * EDID_BLOCK_SIZE;
+        if (ext[0] == CEA_EXTENSION_TAG)
+            parseCeaBlock(ext, *info);
+    }
+
+    info->valid = true;
+    return info;
+}
+
+namespace
+{
+// Small LRU of the last parsed sinks, keyed by blob hash.
+class EdidCache
+{
+public:
+    struct Entry {
+        uint64_t hash;
+        Edid::Blob blob;
+        std::shared_ptr<const EdidInfo> info;
+    };
+
+    bool lookup(uint64_t hash, const unsigned char *data, size_t size, Entry &out)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+            // Compare the blob as well, a hash collision must not hand out the wrong sink.
+            if (it->hash == hash && it->blob->size() == size && !memcmp(it->blob->data(), data, size)) {
+                mEntries.splice(mEntries.begin(), mEntries, it);
+                out = mEntries.front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void insert(const Entry &entry)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mEntries.push_front(entry);
+        if (mEntries.size() > EDID_CACHE_SIZE)
+            mEntries.pop_back();
+    }
+
+private:
+    std::mutex mMutex;
+    std::list<Entry> mEntries;
+};
+
+EdidCache &edidCache()
+{
+    static EdidCache cache;
+    return cache;
+}
+} // namespace
+
+uint64_t Edid::hash(const unsigned char *data, size_t size)
+{
+    // FNV-1a
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        h ^= data[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+Edid::Edid() : mBlob(std::make_shared<const std::vector<uint8_t>>()), mInfo(std::make_shared<const EdidInfo>()) {}
+
+Edid::Edid(const unsigned char *edid, int size)
+{
+    size_t len = size > 0 ? static_cast<size_t>(size) : 0;
+    mHash      = hash(edid, len);
+
+    EdidCache::Entry entry;
+    if (edidCache().lookup(mHash, edid, len, entry)) {
+        LOG_DEBUG("EDID %016" PRIx64 " found in cache", mHash);
+    } else {
+        entry.hash = mHash;
+        entry.blob = std::make_shared<const std::vector<uint8_t>>(edid, edid + len);
+        entry.info = parse(*entry.blob);
+        edidCache().insert(entry);
+    }
+    mBlob = entry.blob;
+    mInfo = entry.info;
+}
+
+std::ostream &operator<<(std::ostream &os, const Edid &edid)
+{
+    const EdidInfo &info = *edid.mInfo;
+    if (!info.valid)
+        return os << "invalid EDID" << std::endl;
+
+    os << info.manufacturer << " " << info.monitorName << " product " << info.product << " " << info.year << "w"
+       << static_cast<int>(info.week) << " EDID " << static_cast<int>(info.version) << "."
+       << static_cast<int>(info.revision) << std::endl;
+    for (auto &t : info.detailedTimings) {
+        os << "  " << t.hActive << "x" << t.vActive << (t.interlaced ? "i" : "p") << " " << t.pixelClock << "kHz"
+           << std::endl;
+    }
+    if (info.hasCea) {
+        os << "  CEA rev " << static_cast<int>(info.ceaRevision) << " vics:";
+        for (auto vic : info.vics)
+            os << " " << static_cast<int>(vic);
+        os << std::endl;
+    }
+    if (info.hdmi)
+        os << "  HDMI max TMDS " << info.maxTmdsClock << "kHz" << std::endl;
+    if (info.hasHdrStaticMetadata)
+        os << "  HDR eotfs 0x" << std::hex << static_cast<int>(info.eotfs) << std::dec << " max " << info.maxLuminance
+           << " cd/m2" << std::endl;
+    return os;
+}
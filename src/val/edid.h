@@ -16,226 +16,105 @@
 
 #pragma once
 
+#include <cstdint>
 #include <iostream>
-#include <string.h>
-typedef unsigned int u32;
-typedef unsigned char u8;
-typedef unsigned short u16;
+#include <memory>
+#include <string>
+#include <vector>
 
-// This is a place holder for extracting information from Edid.
-class Edid
-{
-private:
-    char manuf_name[4];
-    unsigned int model;
-    unsigned int serial;
-    unsigned int year;
-    unsigned int week;
-    unsigned int version[2];
-    unsigned int nonconformant;
-    unsigned int type;
-    unsigned int bpp;
-    unsigned int xres;
-    unsigned int yres;
-    unsigned int voltage;
-    unsigned int sync;
-    unsigned int xsize_cm;
-    unsigned int ysize_cm;
-    /* used to compute timing for graphics chips. */
-    unsigned char phsync;
-    unsigned char pvsync;
-    unsigned int x_mm;
-    unsigned int y_mm;
-    unsigned int pixel_clock;
-    unsigned int link_clock;
-    unsigned int ha;
-    unsigned int hbl;
-    unsigned int hso;
-    unsigned int hspw;
-    unsigned int hborder;
-    unsigned int va;
-    unsigned int vbl;
-    unsigned int vso;
-    unsigned int vspw;
-    unsigned int vborder;
-    /* 3 variables needed for coreboot framebuffer.
-     * In most cases, they are the same as the ha
-     * and va variables, but not always, as in the
-     * case of a 1366 wide display.
-     */
-    u32 x_resolution;
-    u32 y_resolution;
-    u32 bytes_per_line;
-    /* it is unlikely we need these things. */
-    /* if one of these is non-zero, use that one. */
-    unsigned int aspect_landscape;
-    unsigned int aspect_portrait;
-    const char *range_class;
-    const char *syncmethod;
-    const char *stereo;
-    //	void set_vbe_mode_info_valid(struct edid *edid, uintptr_t fb_addr);
+// Detailed timing descriptor, from the base block or a CEA-861 extension.
+struct EdidDetailedTiming {
+    uint32_t pixelClock  = 0; // kHz
+    uint16_t hActive     = 0;
+    uint16_t hBlank      = 0;
+    uint16_t hSyncOffset = 0;
+    uint16_t hSyncWidth  = 0;
+    uint16_t vActive     = 0;
+    uint16_t vBlank      = 0;
+    uint16_t vSyncOffset = 0;
+    uint16_t vSyncWidth  = 0;
+    uint16_t widthMm     = 0;
+    uint16_t heightMm    = 0;
+    bool interlaced      = false;
+    bool hSyncPositive   = false;
+    bool vSyncPositive   = false;
+};
 
-    unsigned char *mBlob = nullptr;
-    int mEdidLen         = 0;
+struct EdidInfo {
+    bool valid = false;
 
-public:
-    Edid(unsigned char *edid, int size):model(0),
-    serial(0),
-    year(0),
-    week(0),
-    nonconformant(0),
-    type(0),
-    bpp(0),
-    xres(0),
-    yres(0),
-    voltage(0),
-    sync(0),
-    xsize_cm(0),
-    ysize_cm(0),
-    phsync(0),
-    pvsync(0),
-    x_mm(0),
-    y_mm(0),
-    pixel_clock(0),
-    link_clock(0),
-    ha(0),
-    hbl(0),
-    hso(0),
-    hspw(0),
-    hborder(0),
-    va(0),
-    vbl(0),
-    vso(0),
-    vspw(0),
-    vborder(0),
-    x_resolution(0),
-    y_resolution(0),
-    bytes_per_line(0),
-    aspect_landscape(0),
-    aspect_portrait(0),
-    range_class(nullptr),
-    syncmethod(nullptr),
-    stereo(nullptr)
-    {
-        mBlob = new unsigned char[size]();
-        memcpy(mBlob, edid, size);
-        mEdidLen = size;
-    }
+    // Base block
+    char manufacturer[4] = {0};
+    uint16_t product     = 0;
+    uint32_t serial      = 0;
+    uint8_t week         = 0;
+    uint16_t year        = 0;
+    uint8_t version      = 0;
+    uint8_t revision     = 0;
+    bool digital         = false;
+    uint8_t bpc          = 0; // 0 if undefined
+    uint8_t widthCm      = 0;
+    uint8_t heightCm     = 0;
+    float gamma          = 0;
+    std::string monitorName;
+    std::string serialString;
+    uint8_t minVRate       = 0; // Hz, from the range limits descriptor
+    uint8_t maxVRate       = 0;
+    uint8_t minHRate       = 0; // kHz
+    uint8_t maxHRate       = 0;
+    uint32_t maxPixelClock = 0; // kHz
+    std::vector<EdidDetailedTiming> detailedTimings;
 
-    Edid():model(0),
-    serial(0),
-    year(0),
-    week(0),
-    nonconformant(0),
-    type(0),
-    bpp(0),
-    xres(0),
-    yres(0),
-    voltage(0),
-    sync(0),
-    xsize_cm(0),
-    ysize_cm(0),
-    phsync(0),
-    pvsync(0),
-    x_mm(0),
-    y_mm(0),
-    pixel_clock(0),
-    link_clock(0),
-    ha(0),
-    hbl(0),
-    hso(0),
-    hspw(0),
-    hborder(0),
-    va(0),
-    vbl(0),
-    vso(0),
-    vspw(0),
-    vborder(0),
-    x_resolution(0),
-    y_resolution(0),
-    bytes_per_line(0),
-    aspect_landscape(0),
-    aspect_portrait(0),
-    range_class(nullptr),
-    syncmethod(nullptr),
-    stereo(nullptr) {}
+    // CEA-861 extension
+    bool hasCea         = false;
+    uint8_t ceaRevision = 0;
+    bool underscan      = false;
+    bool basicAudio     = false;
+    bool ycbcr444       = false;
+    bool ycbcr422       = false;
+    std::vector<uint8_t> vics; // video data block, in order
+    std::vector<uint8_t> nativeVics;
+    std::vector<uint8_t> y420OnlyVics;    // YCbCr 4:2:0 video data block
+    std::vector<uint8_t> y420CapableVics; // vics also supporting 4:2:0, from the capability map
 
-    Edid(const Edid &other):model(0),
-    serial(0),
-    year(0),
-    week(0),
-    nonconformant(0),
-    type(0),
-    bpp(0),
-    xres(0),
-    yres(0),
-    voltage(0),
-    sync(0),
-    xsize_cm(0),
-    ysize_cm(0),
-    phsync(0),
-    pvsync(0),
-    x_mm(0),
-    y_mm(0),
-    pixel_clock(0),
-    link_clock(0),
-    ha(0),
-    hbl(0),
-    hso(0),
-    hspw(0),
-    hborder(0),
-    va(0),
-    vbl(0),
-    vso(0),
-    vspw(0),
-    vborder(0),
-    x_resolution(0),
-    y_resolution(0),
-    bytes_per_line(0),
-    aspect_landscape(0),
-    aspect_portrait(0),
-    range_class(nullptr),
-    syncmethod(nullptr),
-    stereo(nullptr)
-    { Edid(other.mBlob, other.mEdidLen); };
+    // HDMI vendor specific data blocks
+    bool hdmi                = false;
+    uint16_t physicalAddress = 0;
+    uint8_t deepColor        = 0; // DC_48bit/36bit/30bit/Y444 flags of the HDMI VSDB
+    uint32_t maxTmdsClock    = 0; // kHz, 0 if not given
+    bool hdmiForum           = false;
+    uint32_t maxTmdsCharRate = 0; // kHz, from the HF-VSDB
 
-    Edid& operator=(const Edid& other)
-    {
-        // check for self-assignment
-        if (&other == this)
-            return *this;
+    // HDR static metadata data block
+    bool hasHdrStaticMetadata  = false;
+    uint8_t eotfs              = 0; // bit 0 SDR, 1 HDR, 2 SMPTE ST 2084, 3 HLG
+    uint8_t metadataTypes      = 0;
+    float maxLuminance         = 0; // cd/m2, 0 if not given
+    float maxFrameAvgLuminance = 0;
+    float minLuminance         = 0;
+};
 
-        if (mBlob) {
-            delete[] mBlob;
-            mBlob = nullptr;
-        }
+// Parsed EDID. Instances share the raw blob and the parse result, which are immutable and cached by
+// the hash of the blob so that reconnecting the same sink does not parse it again.
+class Edid
+{
+public:
+    typedef std::shared_ptr<const std::vector<uint8_t>> Blob;
 
-        unsigned char *edid = other.mBlob;
-        int size = other.mEdidLen;
+    Edid();
+    Edid(const unsigned char *edid, int size);
 
-        mBlob = new unsigned char[size]();
-        memcpy(mBlob, edid, size);
-        mEdidLen = size;
+    bool isValid() const { return mInfo->valid; }
+    const EdidInfo &getInfo() const { return *mInfo; }
+    Blob getBlob() const { return mBlob; }
+    uint64_t getHash() const { return mHash; }
 
-        return *this;
-    }
+    static uint64_t hash(const unsigned char *data, size_t size);
 
-    ~Edid()
-    {
-        if (mBlob) {
-            delete[] mBlob;
-            mBlob = nullptr;
-        }
-    }
+    friend std::ostream &operator<<(std::ostream &os, const Edid &edid);
 
-    friend std::ostream &operator<<(std::ostream &os, const Edid &edid)
-    {
-        for (int j = 0; j < edid.mEdidLen; j++) {
-            os << *(edid.mBlob + j);
-            if (!((j + 1) % 8)) {
-                os << std::endl;
-            }
-        }
-        return os;
-    }
+private:
+    Blob mBlob;
+    std::shared_ptr<const EdidInfo> mInfo;
+    uint64_t mHash = 0;
 };
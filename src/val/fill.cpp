@@ -0,0 +1,384 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "fill.h"
+#include "logging.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_FILL_X86 1
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HAVE_FILL_NEON 1
+#if !defined(__aarch64__)
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+#endif
+
+namespace
+{
+
+bool supportedAlways() { return true; }
+
+void fenceNone() {}
+
+void copyScalar(void *dst, const void *src, size_t size) { memcpy(dst, src, size); }
+
+void fillScalar(void *dst, uint32_t value, size_t size)
+{
+    uint32_t *d = static_cast<uint32_t *>(dst);
+    for (size_t i = 0; i < size / 4; i++)
+        d[i] = value;
+}
+
+// Bytes up to the next alignment boundary, no more than size.
+inline size_t headBytes(const void *dst, size_t alignment, size_t size)
+{
+    size_t head = (alignment - (reinterpret_cast<uintptr_t>(dst) & (alignment - 1))) & (alignment - 1);
+    return std::min(head, size);
+}
+
+#ifdef HAVE_FILL_X86
+bool supportedSse2() { return __builtin_cpu_supports("sse2"); }
+
+__attribute__((target("sse2"))) void copySse2(void *dst, const void *src, size_t size)
+{
+    uint8_t *d       = static_cast<uint8_t *>(dst);
+    const uint8_t *s = static_cast<const uint8_t *>(src);
+    size_t head      = headBytes(d, 16, size);
+
+    memcpy(d, s, head);
+    d += head;
+    s += head;
+    size -= head;
+
+    for (; size >= 64; size -= 64, d += 64, s += 64) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 16));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 32));
+        __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 48));
+        _mm_stream_si128(reinterpret_cast<__m128i *>(d), a);
+        _mm_stream_si128(reinterpret_cast<__m128i *>(d + 16), b);
+        _mm_stream_si128(reinterpret_cast<__m128i *>(d + 32), c);
+        _mm_stream_si128(reinterpret_cast<__m128i *>(d + 48), e);
+    }
+    for (; size >= 16; size -= 16, d += 16, s += 16)
+        _mm_stream_si128(reinterpret_cast<__m128i *>(d), _mm_loadu_si128(reinterpret_cast<const __m128i *>(s)));
+    memcpy(d, s, size);
+}
+
+__attribute__((target("sse2"))) void fillSse2(void *dst, uint32_t value, size_t size)
+{
+    uint8_t *d  = static_cast<uint8_t *>(dst);
+    size_t head = headBytes(d, 16, size);
+    __m128i v   = _mm_set1_epi32(static_cast<int>(value));
+
+    fillScalar(d, value, head);
+    d += head;
+    size -= head;
+
+    for (; size >= 16; size -= 16, d += 16)
+        _mm_stream_si128(reinterpret_cast<__m128i *>(d), v);
+    fillScalar(d, value, size);
+}
+
+__attribute__((target("sse2"))) void fenceSse2() { _mm_sfence(); }
+
+bool supportedAvx2() { return __builtin_cpu_supports("avx2"); }
+
+__attribute__((target("avx2"))) void copyAvx2(void *dst, const void *src, size_t size)
+{
+    uint8_t *d       = static_cast<uint8_t *>(dst);
+    const uint8_t *s = static_cast<const uint8_t *>(src);
+    size_t head      = headBytes(d, 32, size);
+
+    memcpy(d, s, head);
+    d += head;
+    s += head;
+    size -= head;
+
+    for (; size >= 64; size -= 64, d += 64, s += 64) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + 32));
+        _mm256_stream_si256(reinterpret_cast<__m256i *>(d), a);
+        _mm256_stream_si256(reinterpret_cast<__m256i *>(d + 32), b);
+    }
+    for (; size >= 32; size -= 32, d += 32, s += 32)
+        _mm256_stream_si256(reinterpret_cast<__m256i *>(d), _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s)));
+    memcpy(d, s, size);
+}
+
+__attribute__((target("avx2"))) void fillAvx2(void *dst, uint32_t value, size_t size)
+{
+    uint8_t *d  = static_cast<uint8_t *>(dst);
+    size_t head = headBytes(d, 32, size);
+    __m256i v   = _mm256_set1_epi32(static_cast<int>(value));
+
+    fillScalar(d, value, head);
+    d += head;
+    size -= head;
+
+    for (; size >= 32; size -= 32, d += 32)
+        _mm256_stream_si256(reinterpret_cast<__m256i *>(d), v);
+    fillScalar(d, value, size);
+}
+#endif
+
+#ifdef HAVE_FILL_NEON
+bool supportedNeon()
+{
+#ifdef __aarch64__
+    return true;
+#else
+    return getauxval(AT_HWCAP) & HWCAP_NEON;
+#endif
+}
+
+// NEON has no non-temporal hint; 64 byte bursts of quad stores let the write-combining buffer drain whole lines.
+void copyNeon(void *dst, const void *src, size_t size)
+{
+    uint8_t *d       = static_cast<uint8_t *>(dst);
+    const uint8_t *s = static_cast<const uint8_t *>(src);
+
+    for (; size >= 64; size -= 64, d += 64, s += 64) {
+        uint8x16_t a = vld1q_u8(s);
+        uint8x16_t b = vld1q_u8(s + 16);
+        uint8x16_t c = vld1q_u8(s + 32);
+        uint8x16_t e = vld1q_u8(s + 48);
+        vst1q_u8(d, a);
+        vst1q_u8(d + 16, b);
+        vst1q_u8(d + 32, c);
+        vst1q_u8(d + 48, e);
+    }
+    for (; size >= 16; size -= 16, d += 16, s += 16)
+        vst1q_u8(d, vld1q_u8(s));
+    memcpy(d, s, size);
+}
+
+void fillNeon(void *dst, uint32_t value, size_t size)
+{
+    uint8_t *d   = static_cast<uint8_t *>(dst);
+    uint8x16_t v = vreinterpretq_u8_u32(vdupq_n_u32(value));
+
+    for (; size >= 64; size -= 64, d += 64) {
+        vst1q_u8(d, v);
+        vst1q_u8(d + 16, v);
+        vst1q_u8(d + 32, v);
+        vst1q_u8(d + 48, v);
+    }
+    for (; size >= 16; size -= 16, d += 16)
+        vst1q_u8(d, v);
+    fillScalar(d, value, size);
+}
+#endif
+
+const FillKernel kernels[] = {
+#ifdef HAVE_FILL_X86
+    {"avx2", supportedAvx2, copyAvx2, fillAvx2, fenceSse2},
+    {"sse2", supportedSse2, copySse2, fillSse2, fenceSse2},
+#endif
+#ifdef HAVE_FILL_NEON
+    {"neon", supportedNeon, copyNeon, fillNeon, fenceNone},
+#endif
+    {"scalar", supportedAlways, copyScalar, fillScalar, fenceNone},
+};
+
+const FillKernel *bestKernel()
+{
+    for (auto &kernel : kernels) {
+        if (kernel.supported())
+            return &kernel;
+    }
+    return &kernels[sizeof(kernels) / sizeof(kernels[0]) - 1];
+}
+
+std::atomic<const FillKernel *> activeKernel(nullptr);
+
+// Persistent workers, so that a fill costs a wake-up rather than thread creation. The caller works on bands too,
+// and concurrent callers take turns.
+class FillPool
+{
+public:
+    FillPool()
+    {
+        unsigned int cores = std::min(std::thread::hardware_concurrency(), static_cast<unsigned int>(FILL_MAX_THREADS));
+        for (unsigned int i = 1; i < cores; i++)
+            mWorkers.emplace_back(&FillPool::worker, this);
+    }
+
+    ~FillPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mWake.notify_all();
+        for (auto &worker : mWorkers)
+            worker.join();
+    }
+
+    unsigned int threads() const { return static_cast<unsigned int>(mWorkers.size()) + 1; }
+
+    void run(unsigned int bands, const std::function<void(unsigned int)> &fn)
+    {
+        std::lock_guard<std::mutex> turn(mRunMutex);
+        std::unique_lock<std::mutex> lock(mMutex);
+        mJob     = &fn;
+        mBands   = bands;
+        mNext    = 0;
+        mPending = bands;
+        mGeneration++;
+        mWake.notify_all();
+
+        work(lock);
+        mDone.wait(lock, [this] { return !mPending; });
+        mJob = nullptr;
+    }
+
+private:
+    void worker()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        uint64_t seen = mGeneration;
+        while (true) {
+            mWake.wait(lock, [&] { return mStop || mGeneration != seen; });
+            if (mStop)
+                return;
+            seen = mGeneration;
+            work(lock);
+        }
+    }
+
+    // Takes bands until there are none left. Called with mMutex held.
+    void work(std::unique_lock<std::mutex> &lock)
+    {
+        while (mJob && mNext < mBands) {
+            unsigned int band = mNext++;
+            auto &job         = *mJob;
+            lock.unlock();
+            job(band);
+            lock.lock();
+            if (!--mPending)
+                mDone.notify_all();
+        }
+    }
+
+    std::vector<std::thread> mWorkers;
+    std::mutex mRunMutex;
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mDone;
+    const std::function<void(unsigned int)> *mJob = nullptr;
+    unsigned int mBands                           = 0;
+    unsigned int mNext                            = 0;
+    unsigned int mPending                         = 0;
+    uint64_t mGeneration                          = 0;
+    bool mStop                                    = false;
+};
+
+FillPool &pool()
+{
+    static FillPool instance;
+    return instance;
+}
+
+} // namespace
+
+const FillKernel &Fill::kernel()
+{
+    const FillKernel *kernel = activeKernel.load(std::memory_order_acquire);
+    if (!kernel) {
+        kernel = bestKernel();
+        activeKernel.store(kernel, std::memory_order_release);
+        LOG_DEBUG("Using %s fill kernel, %u threads", kernel->name, threads());
+    }
+    return *kernel;
+}
+
+const char *Fill::kernelName(unsigned int index)
+{
+    for (auto &kernel : kernels) {
+        if (kernel.supported() && index-- == 0)
+            return kernel.name;
+    }
+    return nullptr;
+}
+
+bool Fill::setKernel(const char *name)
+{
+    for (auto &kernel : kernels) {
+        if (!strcmp(kernel.name, name) && kernel.supported()) {
+            activeKernel.store(&kernel, std::memory_order_release);
+            return true;
+        }
+    }
+    return false;
+}
+
+unsigned int Fill::threads() { return pool().threads(); }
+
+void Fill::parallelRows(unsigned int rows, size_t bytes,
+                        const std::function<void(unsigned int first, unsigned int last)> &fn)
+{
+    // Bands run on the pool, so a fill nested in a band runs inline rather than waiting for itself.
+    static thread_local bool inBand = false;
+    const FillKernel &k             = kernel();
+    unsigned int bands              = std::min(rows, threads());
+
+    if (bytes < FILL_PARALLEL_MIN_BYTES || bands < 2 || inBand) {
+        fn(0, rows);
+        k.fence();
+        return;
+    }
+
+    unsigned int rowsPerBand = (rows + bands - 1) / bands;
+    pool().run(bands, [&](unsigned int band) {
+        unsigned int first = band * rowsPerBand;
+        if (first >= rows)
+            return;
+        inBand = true;
+        fn(first, std::min(rows, first + rowsPerBand));
+        k.fence();
+        inBand = false;
+    });
+}
+
+void Fill::fillRows(void *dst, uint32_t pitch, size_t rowBytes, unsigned int rows, uint32_t value)
+{
+    uint8_t *base       = static_cast<uint8_t *>(dst);
+    const FillKernel &k = kernel();
+
+    // Contiguous rows are filled as one run per band, so the kernels see long streams.
+    if (rowBytes == pitch) {
+        parallelRows(rows, rowBytes * rows, [&](unsigned int first, unsigned int last) {
+            k.fill(base + static_cast<size_t>(first) * pitch, value, rowBytes * (last - first));
+        });
+        return;
+    }
+    parallelRows(rows, rowBytes * rows, [&](unsigned int first, unsigned int last) {
+        for (unsigned int row = first; row < last; row++)
+            k.fill(base + static_cast<size_t>(row) * pitch, value, rowBytes);
+    });
+}
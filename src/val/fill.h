@@ -0,0 +1,55 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// CPU writes to dumb buffers. The mappings are usually write-combined, where reads are uncached and partial
+// writes are expensive, so the kernels only ever write, with non-temporal stores where the CPU has them.
+// Large fills are split into horizontal bands that run on a small pool of threads.
+
+struct FillKernel {
+    const char *name;
+    bool (*supported)();
+    void (*copy)(void *dst, const void *src, size_t size);
+    void (*fill)(void *dst, uint32_t value, size_t size); // dst and size 4 byte aligned
+    void (*fence)();                                      // orders the stores of the calling thread
+};
+
+#define FILL_MAX_THREADS 4                   // one per core of the Pi 4
+#define FILL_PARALLEL_MIN_BYTES (512 * 1024) // smaller fills are not worth waking the pool
+
+class Fill
+{
+public:
+    // The fastest kernel the CPU supports, unless another one has been set.
+    static const FillKernel &kernel();
+    // Supported kernels, the fastest first. Returns nullptr past the last one.
+    static const char *kernelName(unsigned int index);
+    static bool setKernel(const char *name);
+
+    static unsigned int threads();
+    // Calls fn(first, last) for bands of [0, rows) on the pool and the calling thread, and returns once all
+    // bands are done. Stores of each band are fenced before it completes. bytes sizes the whole job.
+    static void parallelRows(unsigned int rows, size_t bytes,
+                             const std::function<void(unsigned int first, unsigned int last)> &fn);
+
+    // Fills rows of rowBytes, pitch apart, with a 32 bit value.
+    static void fillRows(void *dst, uint32_t pitch, size_t rowBytes, unsigned int rows, uint32_t value);
+};
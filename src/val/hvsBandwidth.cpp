@@ -0,0 +1,177 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "hvsBandwidth.h"
+#include <algorithm>
+#include <drm_fourcc.h>
+
+unsigned int HvsBandwidthModel::planeCpp(uint32_t format, unsigned int cpp[3], unsigned int &hsub,
+                                         unsigned int &vsub)
+{
+    hsub = 1;
+    vsub = 1;
+
+    switch (format) {
+    case DRM_FORMAT_NV12:
+    case DRM_FORMAT_NV21:
+        hsub   = 2;
+        vsub   = 2;
+        cpp[0] = 1;
+        cpp[1] = 2;
+        return 2;
+
+    case DRM_FORMAT_NV16:
+    case DRM_FORMAT_NV61:
+        hsub   = 2;
+        cpp[0] = 1;
+        cpp[1] = 2;
+        return 2;
+
+    case DRM_FORMAT_YUV420:
+    case DRM_FORMAT_YVU420:
+        hsub   = 2;
+        vsub   = 2;
+        cpp[0] = 1;
+        cpp[1] = 1;
+        cpp[2] = 1;
+        return 3;
+
+    case DRM_FORMAT_UYVY:
+    case DRM_FORMAT_VYUY:
+    case DRM_FORMAT_YUYV:
+    case DRM_FORMAT_YVYU:
+    case DRM_FORMAT_RGB565:
+    case DRM_FORMAT_BGR565:
+        cpp[0] = 2;
+        return 1;
+
+    case DRM_FORMAT_RGB888:
+    case DRM_FORMAT_BGR888:
+        cpp[0] = 3;
+        return 1;
+
+    default:
+        // 32bpp RGB, and the worst case for anything we don't know about.
+        cpp[0] = 4;
+        return 1;
+    }
+}
+
+static inline bool isScaled(const HvsPlaneLoad &plane)
+{
+    return plane.src_w != plane.dst_w || plane.src_h != plane.dst_h;
+}
+
+uint64_t HvsBandwidthModel::membusLoadPerFrame(const HvsPlaneLoad &plane)
+{
+    unsigned int cpp[3] = {0};
+    unsigned int hsub, vsub;
+    unsigned int numPlanes = planeCpp(plane.format, cpp, hsub, vsub);
+    uint64_t load          = 0;
+
+    if (!plane.dst_w || !plane.dst_h)
+        return 0;
+
+    for (unsigned int i = 0; i < numPlanes; i++) {
+        uint64_t src_w = i ? plane.src_w / hsub : plane.src_w;
+        uint64_t src_h = i ? plane.src_h / vsub : plane.src_h;
+        // When downscaling, more source lines have to be read in the time of a single output line,
+        // so the plane load is multiplied by the vertical downscale factor.
+        uint64_t vscale_factor = (src_h + plane.dst_h - 1) / plane.dst_h;
+        load += src_w * src_h * std::max<uint64_t>(vscale_factor, 1) * cpp[i];
+    }
+    return load;
+}
+
+uint64_t HvsBandwidthModel::hvsLoadPerFrame(const HvsPlaneLoad &plane)
+{
+    unsigned int cpp[3] = {0};
+    unsigned int hsub, vsub;
+    unsigned int numPlanes = planeCpp(plane.format, cpp, hsub, vsub);
+
+    // The HVS processes 2 pixels/cycle when scaling, 4 pixels/cycle otherwise.
+    uint64_t pixels = static_cast<uint64_t>(plane.dst_w) * plane.dst_h * numPlanes;
+    return pixels >> (isScaled(plane) ? 1 : 2);
+}
+
+HvsLoad HvsBandwidthModel::estimate(const std::vector<HvsPlaneLoad> &planes, uint32_t vRefresh) const
+{
+    HvsLoad load;
+    for (auto &plane : planes) {
+        load.membusLoad += membusLoadPerFrame(plane);
+        load.hvsLoad += hvsLoadPerFrame(plane);
+    }
+    load.membusLoad *= vRefresh;
+    load.hvsLoad *= vRefresh;
+    return load;
+}
+
+bool HvsBandwidthModel::fits(const HvsLoad &load) const
+{
+    if (!mBudget.enabled)
+        return true;
+    return load.membusLoad <= mBudget.membusLoad && load.hvsLoad <= mBudget.hvsLoad;
+}
+
+HVS_VERDICT_T HvsBandwidthModel::admit(std::vector<HvsPlaneLoad> &planes, size_t index, uint32_t vRefresh) const
+{
+    HvsLoad load = estimate(planes, vRefresh);
+    if (fits(load))
+        return HVS_ACCEPT;
+    if (load.hvsLoad > mBudget.hvsLoad)
+        return HVS_REJECT_HVS;
+
+    if (!mBudget.downgrade || index >= planes.size())
+        return HVS_REJECT_MEMBUS;
+
+    HvsPlaneLoad requested = planes[index];
+    if (!requested.dst_h || !requested.dst_w)
+        return HVS_REJECT_MEMBUS;
+
+    // Fewer source pixels mean less to fetch, and a smaller vertical downscale factor. The crop steps by 1/16 of
+    // the requested size and stays on the chroma subsampling grid of the format.
+    const uint32_t steps = 16;
+    unsigned int cpp[3]  = {0};
+    unsigned int hsub, vsub;
+    planeCpp(requested.format, cpp, hsub, vsub);
+    for (uint32_t step = steps - 1; step >= steps / 2; step--) {
+        HvsPlaneLoad &candidate = planes[index];
+        candidate.src_w         = requested.src_w * step / steps / hsub * hsub;
+        candidate.src_h         = requested.src_h * step / steps / vsub * vsub;
+        candidate.src_x         = requested.src_x + (requested.src_w - candidate.src_w) / 2 / hsub * hsub;
+        candidate.src_y         = requested.src_y + (requested.src_h - candidate.src_h) / 2 / vsub * vsub;
+        if (candidate.src_w && candidate.src_h && fits(estimate(planes, vRefresh)))
+            return HVS_DOWNGRADE;
+    }
+
+    planes[index] = requested;
+    return HVS_REJECT_MEMBUS;
+}
+
+const char *HvsBandwidthModel::verdictName(HVS_VERDICT_T verdict)
+{
+    switch (verdict) {
+    case HVS_ACCEPT:
+        return "accepted";
+    case HVS_DOWNGRADE:
+        return "cropped";
+    case HVS_REJECT_MEMBUS:
+        return "membusExceeded";
+    case HVS_REJECT_HVS:
+        return "hvsExceeded";
+    }
+    return "unknown";
+}
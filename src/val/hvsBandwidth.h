@@ -0,0 +1,80 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Load model for the vc4 HVS, following the kernel load tracker (vc4_plane_calc_load / vc4_load_tracker_atomic_check).
+// It has no DRM or VAL dependencies so that window layouts can be checked without hardware.
+
+struct HvsBudget {
+    bool enabled        = true;
+    uint64_t membusLoad = 1536ULL * 1024 * 1024; // bytes fetched per second (kernel limit SZ_1G + SZ_512M)
+    uint64_t hvsLoad    = 240000000ULL;          // HVS cycles per second (250MHz core clock with margin)
+    bool downgrade      = false;                 // opt-in, crop the source instead of rejecting
+};
+
+struct HvsPlaneLoad {
+    uint32_t format = 0; // DRM fourcc of the scanned out buffer
+    uint32_t src_x  = 0;
+    uint32_t src_y  = 0;
+    uint32_t src_w  = 0;
+    uint32_t src_h  = 0;
+    int32_t dst_x   = 0;
+    int32_t dst_y   = 0;
+    uint32_t dst_w  = 0;
+    uint32_t dst_h  = 0;
+};
+
+struct HvsLoad {
+    uint64_t membusLoad = 0; // bytes per second
+    uint64_t hvsLoad    = 0; // cycles per second
+};
+
+// A rejection names the limit that is exceeded, the memory bus or the HVS cycles.
+typedef enum { HVS_ACCEPT = 0, HVS_DOWNGRADE, HVS_REJECT_MEMBUS, HVS_REJECT_HVS } HVS_VERDICT_T;
+
+class HvsBandwidthModel
+{
+public:
+    HvsBandwidthModel(const HvsBudget &budget) : mBudget(budget) {}
+
+    // Bytes per pixel of each plane of the format and the chroma subsampling. Returns the number of planes.
+    static unsigned int planeCpp(uint32_t format, unsigned int cpp[3], unsigned int &hsub, unsigned int &vsub);
+
+    static uint64_t membusLoadPerFrame(const HvsPlaneLoad &plane);
+    static uint64_t hvsLoadPerFrame(const HvsPlaneLoad &plane);
+
+    HvsLoad estimate(const std::vector<HvsPlaneLoad> &planes, uint32_t vRefresh) const;
+    bool fits(const HvsLoad &load) const;
+
+    // Checks planes[index] against the rest of the set. Only with downgrade, and only when the memory bus is the
+    // limit exceeded, the source of planes[index] is cropped around its centre, keeping its aspect ratio, to the
+    // largest step that fits the budget, and HVS_DOWNGRADE returned. Its destination is left as requested, the
+    // window shows less of the picture but never covers more of the screen. Sources are not cropped to less than
+    // half their size, the request is rejected instead. The HVS cycles only depend on the destination, a crop
+    // cannot bring them down.
+    HVS_VERDICT_T admit(std::vector<HvsPlaneLoad> &planes, size_t index, uint32_t vRefresh) const;
+    static const char *verdictName(HVS_VERDICT_T verdict);
+
+    const HvsBudget &getBudget() const { return mBudget; }
+
+private:
+    HvsBudget mBudget;
+};
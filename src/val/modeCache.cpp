@@ -0,0 +1,188 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "modeCache.h"
+#include "edid.h"
+#include "logging.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <glib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool ModeCache::Entry::matches(uint64_t hash, const drmModeModeInfo *probed, int count) const
+{
+    if (hash != edidHash || count < 0 || modes.size() != static_cast<size_t>(count))
+        return false;
+    return !count || !memcmp(modes.data(), probed, count * sizeof(drmModeModeInfo));
+}
+
+bool ModeCache::load()
+{
+    if (mPath.empty())
+        return false;
+
+    int fd = open(mPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_DEBUG("No mode cache at %s: %s", mPath.c_str(), strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) || st.st_size < static_cast<off_t>(sizeof(ModeCacheHeader))) {
+        close(fd);
+        return false;
+    }
+
+    void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        LOG_WARNING(MSGID_MODE_CACHE, 0, "Failed to map %s: %s", mPath.c_str(), strerror(errno));
+        return false;
+    }
+
+    mLoaded = parse(static_cast<const uint8_t *>(map), st.st_size);
+    munmap(map, st.st_size);
+
+    if (!mLoaded) {
+        LOG_WARNING(MSGID_MODE_CACHE, 0, "Ignoring invalid mode cache %s", mPath.c_str());
+        mEntries.clear();
+    }
+    return mLoaded;
+}
+
+bool ModeCache::parse(const uint8_t *data, size_t size)
+{
+    ModeCacheHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != MODE_CACHE_MAGIC || header.version != MODE_CACHE_VERSION ||
+        header.modeSize != sizeof(drmModeModeInfo))
+        return false;
+    if (header.checksum != Edid::hash(data + sizeof(header), size - sizeof(header)))
+        return false;
+
+    size_t offset = sizeof(header);
+    for (uint32_t i = 0; i < header.count; i++) {
+        ModeCacheRecord record;
+        if (size - offset < sizeof(record))
+            return false;
+        memcpy(&record, data + offset, sizeof(record));
+        offset += sizeof(record);
+
+        size_t modesSize = record.modeCount * sizeof(drmModeModeInfo);
+        if (record.modeCount > MODE_CACHE_MAX_MODES || size - offset < modesSize)
+            return false;
+
+        Entry entry;
+        entry.connectorType   = record.connectorType;
+        entry.connectorTypeId = record.connectorTypeId;
+        entry.edidHash        = record.edidHash;
+        entry.hasChosen       = record.hasChosen;
+        entry.chosen          = record.chosen;
+        entry.modes.resize(record.modeCount);
+        if (modesSize)
+            memcpy(entry.modes.data(), data + offset, modesSize);
+        offset += modesSize;
+        mEntries.push_back(entry);
+    }
+    return true;
+}
+
+bool ModeCache::save()
+{
+    if (mPath.empty() || !mDirty)
+        return true;
+
+    std::vector<uint8_t> data(sizeof(ModeCacheHeader));
+    for (auto &entry : mEntries) {
+        ModeCacheRecord record = {};
+        record.connectorType   = entry.connectorType;
+        record.connectorTypeId = entry.connectorTypeId;
+        record.edidHash        = entry.edidHash;
+        record.modeCount       = static_cast<uint32_t>(entry.modes.size());
+        record.hasChosen       = entry.hasChosen;
+        record.chosen          = entry.chosen;
+
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&record);
+        data.insert(data.end(), bytes, bytes + sizeof(record));
+        bytes = reinterpret_cast<const uint8_t *>(entry.modes.data());
+        data.insert(data.end(), bytes, bytes + entry.modes.size() * sizeof(drmModeModeInfo));
+    }
+
+    ModeCacheHeader header;
+    header.magic    = MODE_CACHE_MAGIC;
+    header.version  = MODE_CACHE_VERSION;
+    header.modeSize = sizeof(drmModeModeInfo);
+    header.count    = static_cast<uint32_t>(mEntries.size());
+    header.checksum = Edid::hash(data.data() + sizeof(header), data.size() - sizeof(header));
+    memcpy(data.data(), &header, sizeof(header));
+
+    // Write a temporary file and rename it over the cache, so a reader never sees a partial file.
+    gchar *dir = g_path_get_dirname(mPath.c_str());
+    g_mkdir_with_parents(dir, 0755);
+    g_free(dir);
+
+    std::string tmpPath = mPath + ".tmp";
+    int fd              = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOG_WARNING(MSGID_MODE_CACHE, 0, "Failed to create %s: %s", tmpPath.c_str(), strerror(errno));
+        return false;
+    }
+    ssize_t written = write(fd, data.data(), data.size());
+    if (written != static_cast<ssize_t>(data.size()) || fsync(fd)) {
+        LOG_WARNING(MSGID_MODE_CACHE, 0, "Failed to write %s: %s", tmpPath.c_str(), strerror(errno));
+        close(fd);
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    close(fd);
+
+    if (rename(tmpPath.c_str(), mPath.c_str())) {
+        LOG_WARNING(MSGID_MODE_CACHE, 0, "Failed to replace %s: %s", mPath.c_str(), strerror(errno));
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    mDirty = false;
+    LOG_DEBUG("Saved %zu connectors to mode cache %s", mEntries.size(), mPath.c_str());
+    return true;
+}
+
+const ModeCache::Entry *ModeCache::find(uint32_t connectorType, uint32_t connectorTypeId) const
+{
+    for (auto &entry : mEntries) {
+        if (entry.connectorType == connectorType && entry.connectorTypeId == connectorTypeId)
+            return &entry;
+    }
+    return nullptr;
+}
+
+void ModeCache::update(const Entry &entry)
+{
+    for (auto &e : mEntries) {
+        if (e.connectorType == entry.connectorType && e.connectorTypeId == entry.connectorTypeId) {
+            if (e.hasChosen == entry.hasChosen && !memcmp(&e.chosen, &entry.chosen, sizeof(e.chosen)) &&
+                e.matches(entry.edidHash, entry.modes.data(), static_cast<int>(entry.modes.size())))
+                return;
+            e      = entry;
+            mDirty = true;
+            return;
+        }
+    }
+    mEntries.push_back(entry);
+    mDirty = true;
+}
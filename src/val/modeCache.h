@@ -0,0 +1,81 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <xf86drmMode.h>
+
+// On-disk layout, native endianness. The header is followed by count records, each followed by
+// modeCount drmModeModeInfo. The checksum covers everything after the header.
+#define MODE_CACHE_MAGIC 0x31434d56 // "VMC1"
+#define MODE_CACHE_VERSION 1
+#define MODE_CACHE_MAX_MODES 256
+
+struct ModeCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t modeSize; // sizeof(drmModeModeInfo), catches libdrm ABI changes
+    uint32_t count;
+    uint64_t checksum;
+};
+
+struct ModeCacheRecord {
+    uint32_t connectorType;
+    uint32_t connectorTypeId;
+    uint64_t edidHash;
+    uint32_t modeCount;
+    uint32_t hasChosen;
+    drmModeModeInfo chosen;
+};
+
+// Last seen EDID, mode table and chosen mode per connector, persisted across boots so that the
+// initial mode can be set before the connectors have been probed.
+class ModeCache
+{
+public:
+    struct Entry {
+        uint32_t connectorType   = 0; // connectors are keyed by type and type id, which are stable across boots
+        uint32_t connectorTypeId = 0;
+        uint64_t edidHash        = 0;
+        bool hasChosen           = false;
+        drmModeModeInfo chosen   = {};
+        std::vector<drmModeModeInfo> modes;
+
+        bool matches(uint64_t hash, const drmModeModeInfo *probed, int count) const;
+    };
+
+    ModeCache(const std::string &path) : mPath(path) {}
+
+    bool isEnabled() const { return !mPath.empty(); }
+    bool isLoaded() const { return mLoaded; }
+
+    bool load();
+    bool save();
+
+    const Entry *find(uint32_t connectorType, uint32_t connectorTypeId) const;
+    void update(const Entry &entry);
+
+private:
+    bool parse(const uint8_t *data, size_t size);
+
+    std::string mPath;
+    std::vector<Entry> mEntries;
+    bool mLoaded = false;
+    bool mDirty  = false;
+};
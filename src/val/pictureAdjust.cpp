@@ -0,0 +1,186 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "pictureAdjust.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define HAVE_LUT_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HAVE_LUT_NEON 1
+#endif
+
+namespace
+{
+
+// BT.709 luma weights, the saturation matrix keeps the luma of every colour.
+const double lumaWeights[3] = {0.2126, 0.7152, 0.0722};
+
+// Per entry v = x * scale + offset, clamped to [0, 1], then multiplied by the gain of each channel.
+struct LutParams {
+    float scale;
+    float offset;
+    float gain[3]; // 0xffff times the white point gain
+};
+
+LutParams lutParams(const PictureSettings &settings, uint32_t size)
+{
+    float contrast   = settings.contrast / static_cast<float>(PICTURE_SETTING_NEUTRAL); // 0 to 2
+    float brightness = (settings.brightness - PICTURE_SETTING_NEUTRAL) / 100.0f;        // -0.5 to 0.5
+    float t          = settings.colorTemperature / static_cast<float>(PICTURE_TEMPERATURE_MAX);
+
+    // Warm takes blue and some green away, cool takes red and some green away.
+    float red   = t > 0 ? 1 - 0.3f * t : 1;
+    float green = 1 - 0.1f * std::fabs(t);
+    float blue  = t < 0 ? 1 + 0.3f * t : 1;
+
+    LutParams params;
+    params.scale   = size > 1 ? contrast / (size - 1) : 0;
+    params.offset  = 0.5f - 0.5f * contrast + brightness;
+    params.gain[0] = red * 0xffff;
+    params.gain[1] = green * 0xffff;
+    params.gain[2] = blue * 0xffff;
+    return params;
+}
+
+inline uint16_t lutValue(float v, float gain) { return static_cast<uint16_t>(v * gain + 0.5f); }
+
+void buildScalar(const LutParams &params, drm_color_lut *lut, uint32_t first, uint32_t size)
+{
+    for (uint32_t i = first; i < size; i++) {
+        float v         = std::min(std::max(i * params.scale + params.offset, 0.0f), 1.0f);
+        lut[i].red      = lutValue(v, params.gain[0]);
+        lut[i].green    = lutValue(v, params.gain[1]);
+        lut[i].blue     = lutValue(v, params.gain[2]);
+        lut[i].reserved = 0;
+    }
+}
+
+#ifdef HAVE_LUT_SSE2
+// 16 bit values of four 32 bit lanes, packs_epi32 saturates to signed 16 bit so the range is moved down first.
+inline __m128i packUnsigned(__m128 v, __m128 gain)
+{
+    __m128i i = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, gain), _mm_set1_ps(0.5f)));
+    i         = _mm_sub_epi32(i, _mm_set1_epi32(0x8000));
+    return _mm_xor_si128(_mm_packs_epi32(i, i), _mm_set1_epi16(static_cast<short>(0x8000)));
+}
+
+uint32_t buildSimd(const LutParams &params, drm_color_lut *lut, uint32_t size)
+{
+    const __m128 scale  = _mm_set1_ps(params.scale);
+    const __m128 offset = _mm_set1_ps(params.offset);
+    const __m128 zero   = _mm_setzero_ps();
+    const __m128 one    = _mm_set1_ps(1.0f);
+    const __m128 red    = _mm_set1_ps(params.gain[0]);
+    const __m128 green  = _mm_set1_ps(params.gain[1]);
+    const __m128 blue   = _mm_set1_ps(params.gain[2]);
+    __m128 index        = _mm_setr_ps(0, 1, 2, 3);
+
+    uint32_t i = 0;
+    for (; i + 4 <= size; i += 4, index = _mm_add_ps(index, _mm_set1_ps(4))) {
+        __m128 v  = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(index, scale), offset), zero), one);
+        __m128i r = packUnsigned(v, red);
+        __m128i g = packUnsigned(v, green);
+        __m128i b = packUnsigned(v, blue);
+        // Interleave to red, green, blue, reserved entries.
+        __m128i rg = _mm_unpacklo_epi16(r, g);
+        __m128i b0 = _mm_unpacklo_epi16(b, _mm_setzero_si128());
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lut + i), _mm_unpacklo_epi32(rg, b0));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lut + i + 2), _mm_unpackhi_epi32(rg, b0));
+    }
+    return i;
+}
+#endif
+
+#ifdef HAVE_LUT_NEON
+inline uint16x4_t narrowUnsigned(float32x4_t v, float32x4_t gain)
+{
+    return vmovn_u32(vcvtq_u32_f32(vaddq_f32(vmulq_f32(v, gain), vdupq_n_f32(0.5f))));
+}
+
+uint32_t buildSimd(const LutParams &params, drm_color_lut *lut, uint32_t size)
+{
+    const float32x4_t scale  = vdupq_n_f32(params.scale);
+    const float32x4_t offset = vdupq_n_f32(params.offset);
+    const float32x4_t zero   = vdupq_n_f32(0.0f);
+    const float32x4_t one    = vdupq_n_f32(1.0f);
+    const float32x4_t red    = vdupq_n_f32(params.gain[0]);
+    const float32x4_t green  = vdupq_n_f32(params.gain[1]);
+    const float32x4_t blue   = vdupq_n_f32(params.gain[2]);
+    const float start[4]     = {0, 1, 2, 3};
+    float32x4_t index        = vld1q_f32(start);
+
+    uint32_t i = 0;
+    for (; i + 4 <= size; i += 4, index = vaddq_f32(index, vdupq_n_f32(4))) {
+        float32x4_t v = vminq_f32(vmaxq_f32(vmlaq_f32(offset, index, scale), zero), one);
+        uint16x4x4_t entries;
+        entries.val[0] = narrowUnsigned(v, red);
+        entries.val[1] = narrowUnsigned(v, green);
+        entries.val[2] = narrowUnsigned(v, blue);
+        entries.val[3] = vdup_n_u16(0);
+        // Stores interleaved, as red, green, blue, reserved entries.
+        vst4_u16(reinterpret_cast<uint16_t *>(lut + i), entries);
+    }
+    return i;
+}
+#endif
+
+uint64_t toCtmValue(double value)
+{
+    uint64_t magnitude = static_cast<uint64_t>(std::fabs(value) * (1ULL << 32) + 0.5);
+    return value < 0 ? magnitude | (1ULL << 63) : magnitude;
+}
+
+} // namespace
+
+void PictureAdjust::buildGammaLut(const PictureSettings &settings, drm_color_lut *lut, uint32_t size)
+{
+    LutParams params = lutParams(settings, size);
+    uint32_t done    = 0;
+#if defined(HAVE_LUT_SSE2) || defined(HAVE_LUT_NEON)
+    done = buildSimd(params, lut, size);
+#endif
+    buildScalar(params, lut, done, size);
+}
+
+void PictureAdjust::buildGammaLutScalar(const PictureSettings &settings, drm_color_lut *lut, uint32_t size)
+{
+    buildScalar(lutParams(settings, size), lut, 0, size);
+}
+
+void PictureAdjust::buildCtm(const PictureSettings &settings, drm_color_ctm &ctm)
+{
+    // out = s * in + (1 - s) * luma(in), row major.
+    double s = settings.saturation / static_cast<double>(PICTURE_SETTING_NEUTRAL);
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 3; col++)
+            ctm.matrix[row * 3 + col] = toCtmValue((1 - s) * lumaWeights[col] + (row == col ? s : 0));
+    }
+}
+
+const char *PictureAdjust::simdName()
+{
+#if defined(HAVE_LUT_SSE2)
+    return "sse2";
+#elif defined(HAVE_LUT_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,56 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstdint>
+#include <xf86drmMode.h>
+
+#define PICTURE_SETTING_MAX 100
+#define PICTURE_SETTING_NEUTRAL 50
+#define PICTURE_TEMPERATURE_MAX 50
+#define PICTURE_TEMPERATURE_NEUTRAL 0
+
+// Picture settings of a display. Brightness, contrast and saturation go from 0 to 100 with 50 for no change,
+// the colour temperature from -50 (warm) to 50 (cool) with 0 for no change.
+struct PictureSettings {
+    int32_t brightness       = PICTURE_SETTING_NEUTRAL;
+    int32_t contrast         = PICTURE_SETTING_NEUTRAL;
+    int32_t saturation       = PICTURE_SETTING_NEUTRAL;
+    int32_t colorTemperature = PICTURE_TEMPERATURE_NEUTRAL;
+
+    bool isNeutral() const
+    {
+        return brightness == PICTURE_SETTING_NEUTRAL && contrast == PICTURE_SETTING_NEUTRAL &&
+               saturation == PICTURE_SETTING_NEUTRAL && colorTemperature == PICTURE_TEMPERATURE_NEUTRAL;
+    }
+};
+
+// The settings are applied by the crtc, through its gamma LUT and colour transformation matrix, so they cost
+// nothing per frame. The tables are only computed when a setting changes.
+class PictureAdjust
+{
+public:
+    // Entry i of size maps input i / (size - 1) to: contrast around mid grey, then brightness, clamped, then the
+    // white point gains of the colour temperature. Four entries at a time with SIMD where the CPU has it.
+    static void buildGammaLut(const PictureSettings &settings, drm_color_lut *lut, uint32_t size);
+    // The same, one entry at a time.
+    static void buildGammaLutScalar(const PictureSettings &settings, drm_color_lut *lut, uint32_t size);
+    // Saturation around the BT.709 luma, in the S31.32 sign-magnitude format of the CTM property.
+    static void buildCtm(const PictureSettings &settings, drm_color_ctm &ctm);
+    // Name of the SIMD path of buildGammaLut, "scalar" without one.
+    static const char *simdName();
+};
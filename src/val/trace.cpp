@@ -0,0 +1,120 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "trace.h"
+#include "logging.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace
+{
+
+const size_t TRACE_RING_SIZE = 16384; // power of two
+
+// Each slot is guarded by a sequence number: odd while the event is being written, 2 * (index + 1) once
+// event index is complete. Readers drop slots whose sequence changed while they were copied.
+struct TraceSlot {
+    std::atomic<uint64_t> seq;
+    TraceEvent event;
+};
+
+TraceSlot gRing[TRACE_RING_SIZE];
+std::atomic<uint64_t> gHead(0);
+
+const char *const categoryNames[TRACE_CATEGORY_COUNT] = {"val", "drm", "udev", "vblank"};
+
+uint32_t currentTid()
+{
+    static thread_local uint32_t tid = static_cast<uint32_t>(syscall(SYS_gettid));
+    return tid;
+}
+
+uint64_t monotonicNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+} // namespace
+
+std::atomic<bool> Trace::sEnabled(false);
+
+void Trace::setEnabled(bool enable)
+{
+    sEnabled.store(enable, std::memory_order_relaxed);
+    LOG_INFO(MSGID_DEVICE_STATUS, 0, "Tracing %s", enable ? "enabled" : "disabled");
+}
+
+void Trace::record(char phase, TRACE_CATEGORY_T category, const char *name, uint64_t arg)
+{
+    uint64_t index  = gHead.fetch_add(1, std::memory_order_relaxed);
+    TraceSlot &slot = gRing[index & (TRACE_RING_SIZE - 1)];
+
+    slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.event.ts       = monotonicNs();
+    slot.event.name     = name;
+    slot.event.arg      = arg;
+    slot.event.tid      = currentTid();
+    slot.event.phase    = phase;
+    slot.event.category = static_cast<uint8_t>(category);
+    slot.seq.store(2 * index + 2, std::memory_order_release);
+}
+
+bool Trace::dump(const std::string &path)
+{
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file) {
+        LOG_ERROR(MSGID_DEVICE_ERROR, 0, "Failed to open trace file %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    uint64_t head  = gHead.load(std::memory_order_acquire);
+    uint64_t first = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+    int pid        = getpid();
+    size_t count   = 0;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    for (uint64_t index = first; index < head; index++) {
+        TraceSlot &slot  = gRing[index & (TRACE_RING_SIZE - 1)];
+        uint64_t seq     = slot.seq.load(std::memory_order_acquire);
+        TraceEvent event = slot.event;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq != 2 * index + 2 || slot.seq.load(std::memory_order_relaxed) != seq)
+            continue; // overwritten, or still being written
+
+        fprintf(file, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%u",
+                count ? "," : "", event.name, categoryNames[event.category], event.phase, event.ts / 1000.0, pid,
+                event.tid);
+        if (event.phase == 'i')
+            fprintf(file, ",\"s\":\"t\"");
+        if (event.phase != 'E')
+            fprintf(file, ",\"args\":{\"arg\":%llu}", static_cast<unsigned long long>(event.arg));
+        fprintf(file, "}");
+        count++;
+    }
+    fprintf(file, "\n]}\n");
+
+    bool ok = !ferror(file);
+    fclose(file);
+    LOG_INFO(MSGID_DEVICE_STATUS, 0, "Wrote %zu trace events to %s", count, path.c_str());
+    return ok;
+}
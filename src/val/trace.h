@@ -0,0 +1,85 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// In-process event trace. Events go to a fixed-size ring shared by all threads, without locks or allocation,
+// and can be written out as Chrome trace JSON (chrome://tracing, ui.perfetto.dev). While tracing is disabled
+// recording an event costs a relaxed atomic load.
+
+typedef enum { TRACE_VAL = 0, TRACE_DRM, TRACE_UDEV, TRACE_VBLANK, TRACE_CATEGORY_COUNT } TRACE_CATEGORY_T;
+
+struct TraceEvent {
+    uint64_t ts;      // CLOCK_MONOTONIC, ns
+    const char *name; // string literal, only the pointer is stored
+    uint64_t arg;
+    uint32_t tid;
+    char phase; // 'B'egin, 'E'nd or 'i'nstant
+    uint8_t category;
+};
+
+class Trace
+{
+public:
+    static bool isEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+    static void setEnabled(bool enable);
+
+    static void record(char phase, TRACE_CATEGORY_T category, const char *name, uint64_t arg = 0);
+    // Writes the events still in the ring. The ring keeps recording while it is written.
+    static bool dump(const std::string &path);
+
+private:
+    static std::atomic<bool> sEnabled;
+};
+
+class TraceScope
+{
+public:
+    TraceScope(TRACE_CATEGORY_T category, const char *name, uint64_t arg = 0)
+        : mName(name), mCategory(category), mActive(Trace::isEnabled())
+    {
+        if (mActive)
+            Trace::record('B', mCategory, mName, arg);
+    }
+    ~TraceScope()
+    {
+        if (mActive)
+            Trace::record('E', mCategory, mName);
+    }
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *mName;
+    TRACE_CATEGORY_T mCategory;
+    bool mActive;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+// Span from here to the end of the enclosing block.
+#define TRACE_SCOPE(category, name, ...) TraceScope TRACE_CONCAT(traceScope, __LINE__)(category, name, ##__VA_ARGS__)
+
+#define TRACE_INSTANT(category, name, arg)           \
+    do {                                             \
+        if (Trace::isEnabled())                      \
+            Trace::record('i', category, name, arg); \
+    } while (0)
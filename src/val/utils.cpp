@@ -155,6 +155,23 @@ std::string mode_type_str(int type)
     return ret;
 }
 
+uint32_t getRefreshMilliHz(const drmModeModeInfo &mode)
+{
+    // Same as drm_mode_vrefresh(), without rounding to whole Hz so that 1000/1001 rates can be told apart.
+    uint64_t lines = static_cast<uint64_t>(mode.htotal) * mode.vtotal;
+    if (!lines)
+        return mode.vrefresh * 1000;
+    if (mode.flags & DRM_MODE_FLAG_DBLSCAN)
+        lines *= 2;
+    if (mode.vscan > 1)
+        lines *= mode.vscan;
+
+    uint64_t refresh = static_cast<uint64_t>(mode.clock) * 1000 * 1000;
+    if (mode.flags & DRM_MODE_FLAG_INTERLACE)
+        refresh *= 2;
+    return static_cast<uint32_t>((refresh + lines / 2) / lines);
+}
+
 std::ostream &operator<<(std::ostream &os, const DrmDisplayMode &dm)
 {
     // TODO::jsonify
@@ -175,7 +192,7 @@ std::ostream &operator<<(std::ostream &os, const DrmPlane &dm)
     os << "Plane:\n";
     os << "id\tcrtc\tfb\tCRTC x,y\tx,y\tgamma size\tpossible crtcs\n";
 
-    auto ovr = dm.mDrmPlane;
+    auto ovr = dm.mDrmPlane.get();
     os << ovr->plane_id << "\t" << ovr->crtc_id << "\t" << ovr->fb_id << "\t" << ovr->crtc_x << "\t" << ovr->crtc_y
        << "\t" << ovr->x << "\t" << ovr->y << "\t" << ovr->gamma_size << "x" << ovr->possible_crtcs;
 
@@ -17,6 +17,7 @@
 #include "val_impl.h"
 #include "config.h"
 #include "logging.h"
+#include "trace.h"
 #include "val_settings_impl.h"
 #include "val_video_impl.h"
 #include <sstream>
@@ -44,8 +45,12 @@ VAL *VAL::getInstance()
 
 bool val_impl::initialize()
 {
-    video    = new val_video_impl(mDevCap);
-    controls = new VAL_ControlSettings_Impl();
+    if (mDevCap.isTraceEnabled())
+        Trace::setEnabled(true);
+
+    val_video_impl *videoImpl = new val_video_impl(mDevCap);
+    video                     = videoImpl;
+    controls                  = new VAL_ControlSettings_Impl(*videoImpl);
 
     return true;
 }
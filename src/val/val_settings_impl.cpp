@@ -14,13 +14,40 @@
 //
 // SPDX-License-Identifier: Apache-2.0
 #include "val_settings_impl.h"
+#include "logging.h"
+#include "val_video_impl.h"
 
 using namespace std::placeholders;
 
-VAL_ControlSettings_Impl::VAL_ControlSettings_Impl() {}
+VAL_ControlSettings_Impl::VAL_ControlSettings_Impl(val_video_impl &video) : mVideo(video) {}
 
 bool VAL_ControlSettings_Impl::configureVideoSettings(const std::string control, const VAL_VIDEO_WID_T winID,
                                                       const int32_t controlVal[])
 {
-    return true;
+    // The settings belong to the crtc showing the window, every window on it shares them.
+    PictureSettings settings;
+    if (!controlVal || !mVideo.getPictureSettings(winID, settings))
+        return false;
+    int32_t value = controlVal[0];
+    bool valid    = value >= 0 && value <= PICTURE_SETTING_MAX;
+    if (control == "brightness")
+        settings.brightness = value;
+    else if (control == "contrast")
+        settings.contrast = value;
+    else if (control == "saturation")
+        settings.saturation = value;
+    else if (control == "colorTemperature") {
+        settings.colorTemperature = value;
+        valid                     = value >= -PICTURE_TEMPERATURE_MAX && value <= PICTURE_TEMPERATURE_MAX;
+    } else {
+        LOG_WARNING(MSGID_VIDEO_SETTINGS_FAILED, 0, "Unknown video setting %s", control.c_str());
+        return false;
+    }
+    if (!valid) {
+        LOG_WARNING(MSGID_VIDEO_SETTINGS_FAILED, 0, "Video setting %s out of range: %d", control.c_str(), value);
+        return false;
+    }
+
+    // The tables are computed and uploaded once here, nothing is done per frame.
+    return mVideo.setPictureSettings(winID, settings);
 }
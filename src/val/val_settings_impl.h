@@ -20,11 +20,18 @@
 #include <functional>
 #include <string>
 #include <val_api.h>
+#include "pictureAdjust.h"
+
+class val_video_impl;
 
 class VAL_ControlSettings_Impl : public VAL_ControlSettings
 {
 
 public:
-    VAL_ControlSettings_Impl();
+    VAL_ControlSettings_Impl(val_video_impl &video);
+    // ctrl is "brightness", "contrast", "saturation" or "colorTemperature", with the value in the first element.
     bool configureVideoSettings(const std::string ctrl, VAL_VIDEO_WID_T winID, const int32_t[]);
+
+private:
+    val_video_impl &mVideo;
 };
@@ -18,6 +18,7 @@
 #include "driElements.h"
 #include <algorithm>
 #include <cinttypes>
+#include <cstring>
 #include <unordered_set>
 #include <val/val_video.h>
 
@@ -25,38 +26,36 @@ VAL_VIDEO_RECT_T val_video_impl::getDisplayResolution() { return VAL_VIDEO_RECT_
 
 val_video_impl::val_video_impl(DeviceCapability &deviceCapability)
     : mDeviceCapability(deviceCapability),
-      driElements(mDeviceCapability.getMaxResolution(), [this](void) { this->updatePlanes(); })
+      driElements(mDeviceCapability.getMaxResolution(),
+                  [this](const HotplugChangeSet &changes) { this->updatePlanes(changes); },
+                  mDeviceCapability.getModeCachePath(), mDeviceCapability.getBufferClasses(),
+                  mDeviceCapability.getMemoryBudget()),
+      mHvsModel(mDeviceCapability.getHvsBudget())
 {
     const std::set<std::string> &planeNames = mDeviceCapability.getPlaneNames();
     int wid                                 = 0;
 
+    const HotplugPolicy &hotplug = mDeviceCapability.getHotplugPolicy();
+    driElements.setHotplugPolicy(hotplug.quietWindow, hotplug.minInterval);
+
     for (auto &pstr : planeNames) {
         // TODO: window id should come from config file
         logicalPlanes.push_back(VAL_PLANE_T{(VAL_VIDEO_WID_T)wid++, pstr, mDeviceCapability.getMinResolution(),
                                             mDeviceCapability.getMaxResolution()});
     }
 
-    // Acquire a pool of physical plane Ids (one per logical planes)
-    std::vector<unsigned int> pplaneList = driElements.getPlanes();
-
-    auto physicalPlaneId = pplaneList.begin();
-    for (VAL_PLANE_T &plane : logicalPlanes) {
-        if (physicalPlaneId != pplaneList.end()) {
-            physicalPlanes.push_back(*physicalPlaneId);
-            uint32_t crtcId = driElements.getCrtcId(*physicalPlaneId);
-            uint32_t connId = driElements.getConnId(*physicalPlaneId);
-            LOG_DEBUG("plane Name / wId : %s / %d, plane id : %d, crtc id : %d, conn id : %d", plane.planeName.c_str(),
-                      plane.wId, *physicalPlaneId, crtcId, connId);
-            videoSinks.insert(std::make_pair(plane.wId, new SinkInfo(*physicalPlaneId, crtcId, connId)));
-            physicalPlaneId++;
-        } else {
-            LOG_DEBUG("insert dummy videoSinks for logical id of planes %d", plane.wId);
-            videoSinks.insert(std::make_pair(plane.wId, new SinkInfo(0, 0, 0)));
-        }
-    }
+    for (VAL_PLANE_T &plane : logicalPlanes)
+        videoSinks.insert(std::make_pair(plane.wId, new SinkInfo(0, 0, 0)));
+    bindSinks();
     updatePlanes();
 }
 
+val_video_impl::~val_video_impl()
+{
+    if (mRevertTimeout)
+        g_source_remove(mRevertTimeout);
+}
+
 bool val_video_impl::getDeviceCapabilities(VAL_VIDEO_SIZE_T &minDownscaleSize, VAL_VIDEO_SIZE_T &maxUpscaleSize)
 {
     // TODO::vc4 crtc property has max and min resolution.(0x0-2048x2048)
@@ -91,6 +90,7 @@ bool val_video_impl::isSinkConnected(VAL_VIDEO_WID_T wId)
 bool val_video_impl::connect(VAL_VIDEO_WID_T wId, VAL_VSC_INPUT_SRC_INFO_T vscInput, VAL_VSC_OUTPUT_MODE_T outputmode,
                              unsigned int *planeId)
 {
+    TRACE_SCOPE(TRACE_VAL, "connect", wId);
     if (!isValidSink(wId)) {
         return false;
     }
@@ -107,12 +107,26 @@ bool val_video_impl::connect(VAL_VIDEO_WID_T wId, VAL_VSC_INPUT_SRC_INFO_T vscIn
 
 bool val_video_impl::disconnect(VAL_VIDEO_WID_T wId)
 {
+    TRACE_SCOPE(TRACE_VAL, "disconnect", wId);
     LOG_DEBUG("disconnect called for wId %d", wId);
     if (!isSinkConnected(wId)) {
         LOG_DEBUG("Sink %d is not connected", wId);
         return false;
     }
-    videoSinks[wId]->connected = false;
+    if (videoSinks[wId]->blanked)
+        setWindowBlanking(wId, false, videoSinks[wId]->srcRect, videoSinks[wId]->outRect);
+    videoSinks[wId]->connected   = false;
+    videoSinks[wId]->hasGeometry = false;
+    videoSinks[wId]->blanked     = false;
+    videoSinks[wId]->detached    = false;
+    videoSinks[wId]->hvsVerdict  = HVS_ACCEPT;
+    if (videoSinks[wId]->transform != DRM_MODE_ROTATE_0)
+        driElements.setPlaneRotation(videoSinks[wId]->planeId, DRM_MODE_ROTATE_0);
+    videoSinks[wId]->transform         = DRM_MODE_ROTATE_0;
+    videoSinks[wId]->softwareTransform = false;
+    updatePrimaryPlane(videoSinks[wId]->crtcId);
+    if (videoSinks[wId]->frameRate)
+        setContentFrameRate(wId, 0);
     return true;
 #if 0
     if (!driElements.setPlaneProperties(SET_PLANE_FB_T, videoSinks[wId]->planeId, 0)) {
@@ -123,21 +137,12 @@ bool val_video_impl::disconnect(VAL_VIDEO_WID_T wId)
 #endif
 }
 
-typedef struct {
-    /* Signed dest location allows it to be partially off screen */
-    int32_t crtc_x, crtc_y;
-    uint32_t crtc_w, crtc_h;
-
-    /* Source values are 16.16 fixed point */
-    uint32_t src_x, src_y;
-    uint32_t src_h, src_w;
-} scale_param_t;
-
 scale_param_t scale_param;
 
 bool val_video_impl::applyScaling(VAL_VIDEO_WID_T wId, VAL_VIDEO_RECT_T srcInfo, bool adaptive,
                                   VAL_VIDEO_RECT_T inputRegion, VAL_VIDEO_RECT_T outputRegion)
 {
+    TRACE_SCOPE(TRACE_VAL, "applyScaling", wId);
     LOG_DEBUG("applyScaling called with srcInfo {x:%u, y:%u, w:%u, h:%u},"
               "inputRegion {x:%u, y:%u, w:%u, h:%u}, outputRegion {x:%u, y:%u, w:%u, h:%u}",
               srcInfo.x, srcInfo.y, srcInfo.w, srcInfo.h, inputRegion.x, inputRegion.y, inputRegion.w, inputRegion.h,
@@ -156,6 +161,33 @@ bool val_video_impl::applyScaling(VAL_VIDEO_WID_T wId, VAL_VIDEO_RECT_T srcInfo,
         return false;
     }
 
+    // The player attached its buffer before scaling it, use its real format from now on. A blanked plane shows
+    // the black buffer instead.
+    uint32_t format = videoSinks[wId]->blanked ? 0 : driElements.getPlaneFormat(videoSinks[wId]->planeId);
+    if (format)
+        videoSinks[wId]->format = format;
+
+    // The verdict is kept for allWindows, so that the caller can tell why the window was refused.
+    HVS_VERDICT_T verdict = admitWindow(wId, inputRegion, outputRegion);
+    if (verdict == HVS_REJECT_MEMBUS || verdict == HVS_REJECT_HVS) {
+        LOG_ERROR(MSGID_HVS_BUDGET_EXCEEDED, 0, "Rejecting scaling for wId %d, HVS budget exceeded: %s", wId,
+                  HvsBandwidthModel::verdictName(verdict));
+        return false;
+    }
+
+    // A blanked window keeps showing black, over its new output, until it is unblanked with this geometry.
+    if (videoSinks[wId]->blanked) {
+        bool detached = false;
+        if (!driElements.setPlaneBlank(videoSinks[wId]->planeId, true, inputRegion, outputRegion, detached))
+            return false;
+        videoSinks[wId]->detached    = detached;
+        videoSinks[wId]->srcRect     = inputRegion;
+        videoSinks[wId]->outRect     = outputRegion;
+        videoSinks[wId]->hasGeometry = true;
+        updatePrimaryPlane(videoSinks[wId]->crtcId);
+        return true;
+    }
+
     scale_param = {outputRegion.x, outputRegion.y, outputRegion.w, outputRegion.h,
                    inputRegion.x,  inputRegion.y,  inputRegion.h,  inputRegion.w};
 
@@ -167,9 +199,124 @@ bool val_video_impl::applyScaling(VAL_VIDEO_WID_T wId, VAL_VIDEO_RECT_T srcInfo,
         return true;
     }
 
+    videoSinks[wId]->srcRect     = inputRegion;
+    videoSinks[wId]->outRect     = outputRegion;
+    videoSinks[wId]->hasGeometry = true;
+    updatePrimaryPlane(videoSinks[wId]->crtcId);
     return true;
 }
 
+static bool isOpaqueFormat(uint32_t format)
+{
+    switch (format) {
+    case DRM_FORMAT_ARGB8888:
+    case DRM_FORMAT_ABGR8888:
+    case DRM_FORMAT_RGBA8888:
+    case DRM_FORMAT_BGRA8888:
+    case DRM_FORMAT_ARGB4444:
+    case DRM_FORMAT_ABGR4444:
+    case DRM_FORMAT_RGBA4444:
+    case DRM_FORMAT_BGRA4444:
+    case DRM_FORMAT_ARGB1555:
+    case DRM_FORMAT_ABGR1555:
+    case DRM_FORMAT_RGBA5551:
+    case DRM_FORMAT_BGRA5551:
+    case DRM_FORMAT_ARGB2101010:
+    case DRM_FORMAT_ABGR2101010:
+    case DRM_FORMAT_RGBA1010102:
+    case DRM_FORMAT_BGRA1010102:
+        return false;
+    default:
+        return true;
+    }
+}
+
+static bool coversDisplay(uint32_t format, const VAL_VIDEO_RECT_T &out, const VAL_VIDEO_SIZE_T &display)
+{
+    return isOpaqueFormat(format) && out.x == 0 && out.y == 0 && out.w >= display.w && out.h >= display.h;
+}
+
+bool val_video_impl::isPrimaryOccluded(uint32_t crtcId, VAL_VIDEO_SIZE_T display)
+{
+    for (auto &s : videoSinks) {
+        SinkInfo *sink = s.second;
+        if (sink->connected && sink->hasGeometry && !sink->detached && sink->crtcId == crtcId &&
+            coversDisplay(sink->format, sink->outRect, display))
+            return true;
+    }
+    return false;
+}
+
+void val_video_impl::updatePrimaryPlane(uint32_t crtcId)
+{
+    VAL_VIDEO_SIZE_T display = {};
+    uint32_t vRefresh        = 0;
+
+    if (!driElements.getActiveMode(crtcId, display, vRefresh))
+        return;
+
+    // The primary plane only shows the black scanout buffer, skip fetching it while a video plane hides it.
+    bool occluded = isPrimaryOccluded(crtcId, display);
+    if (driElements.isPrimaryPlaneEnabled(crtcId) == occluded)
+        driElements.setPrimaryPlaneEnabled(crtcId, !occluded);
+}
+
+static HvsPlaneLoad toPlaneLoad(uint32_t format, const VAL_VIDEO_RECT_T &src, const VAL_VIDEO_RECT_T &out)
+{
+    HvsPlaneLoad load;
+    load.format = format;
+    load.src_x  = src.x;
+    load.src_y  = src.y;
+    load.src_w  = src.w;
+    load.src_h  = src.h;
+    load.dst_x  = out.x;
+    load.dst_y  = out.y;
+    load.dst_w  = out.w;
+    load.dst_h  = out.h;
+    return load;
+}
+
+HVS_VERDICT_T val_video_impl::admitWindow(VAL_VIDEO_WID_T wId, VAL_VIDEO_RECT_T &inputRegion,
+                                          VAL_VIDEO_RECT_T outputRegion)
+{
+    VAL_VIDEO_SIZE_T display = {};
+    uint32_t vRefresh        = 0;
+    SinkInfo *sink           = videoSinks[wId];
+
+    sink->hvsVerdict = HVS_ACCEPT;
+    // Nothing to check for the 1 pixel work around value or before a mode is set.
+    if (outputRegion.w <= 1 || outputRegion.h <= 1 || !driElements.getActiveMode(sink->crtcId, display, vRefresh))
+        return HVS_ACCEPT;
+
+    // The primary plane scans out the full screen buffer unless a window will cover it,
+    // then every other window on the same crtc.
+    std::vector<HvsPlaneLoad> planes;
+    bool occluded = coversDisplay(sink->format, outputRegion, display);
+    for (auto &s : videoSinks) {
+        if (s.first == wId || !s.second->connected || !s.second->hasGeometry || s.second->crtcId != sink->crtcId)
+            continue;
+        planes.push_back(toPlaneLoad(s.second->format, s.second->srcRect, s.second->outRect));
+        occluded = occluded || coversDisplay(s.second->format, s.second->outRect, display);
+    }
+    if (!occluded) {
+        planes.insert(planes.begin(), toPlaneLoad(DEFAULT_PIXEL_FORMAT, VAL_VIDEO_RECT_T{0, 0, display.w, display.h},
+                                                  VAL_VIDEO_RECT_T{0, 0, display.w, display.h}));
+    }
+    planes.push_back(toPlaneLoad(sink->format, inputRegion, outputRegion));
+
+    sink->hvsVerdict = mHvsModel.admit(planes, planes.size() - 1, vRefresh);
+    if (sink->hvsVerdict == HVS_DOWNGRADE) {
+        const HvsPlaneLoad &cropped = planes.back();
+        LOG_WARNING(MSGID_HVS_BUDGET_EXCEEDED, 0, "Cropping wId %d source %ux%u to %ux%u to fit HVS budget", wId,
+                    inputRegion.w, inputRegion.h, cropped.src_w, cropped.src_h);
+        inputRegion.x = static_cast<UINT16>(cropped.src_x);
+        inputRegion.y = static_cast<UINT16>(cropped.src_y);
+        inputRegion.w = static_cast<UINT16>(cropped.src_w);
+        inputRegion.h = static_cast<UINT16>(cropped.src_h);
+    }
+    return sink->hvsVerdict;
+}
+
 bool val_video_impl::setDualVideo(bool enable)
 { // Do nothing.
     return true;
@@ -177,71 +324,79 @@ bool val_video_impl::setDualVideo(bool enable)
 
 bool val_video_impl::setCompositionParams(std::vector<VAL_WINDOW_INFO_T> zOrder)
 {
-#if 0 //RPI doesn't support to set Zorder
+    TRACE_SCOPE(TRACE_VAL, "setCompositionParams", zOrder.size());
+    // Windows are listed from the bottom up. The zpos of their planes is exchanged to match, so that the HVS
+    // stacks them and nothing has to be composited again.
+    std::vector<uint32_t> planes;
     for (size_t i = 0; i < zOrder.size(); ++i) {
-        LOG_DEBUG("zorder %d  for wId %d", i, zOrder[i].wId);
+        LOG_DEBUG("zorder %zu  for wId %d", i, zOrder[i].wId);
         if (!isValidSink(zOrder[i].wId)) {
             return false;
         }
+        uint32_t planeId = videoSinks[zOrder[i].wId]->planeId;
+        if (!planeId)
+            continue;
+        if (std::find(planes.begin(), planes.end(), planeId) != planes.end()) {
+            LOG_ERROR(MSGID_SET_ZORDER_FAILED, 0, "wId %d is listed twice", zOrder[i].wId);
+            return false;
+        }
+        planes.push_back(planeId);
     }
-    uint64_t zarg = 0;
-    for (size_t i = 0, p = physicalPlanes.size() - 1; i < zOrder.size() && p >= 0; ++i) {
-        zarg = zarg << 16;
-        zarg |= zOrder[i].wId;
-    }
-
-    uint16_t plane = driElements.getPlaneBase(); // plane must be any valid plane id.
 
-    if (!driElements.setPlaneProperties(SET_Z_ORDER_T, plane, zarg)) {
+    if (planes.size() > 1 && !driElements.setPlaneOrder(planes)) {
         LOG_ERROR(MSGID_SET_ZORDER_FAILED, 0, "Failed to apply zorder for sink");
         return false;
     }
-#endif
     return true;
 }
 
 bool val_video_impl::setWindowBlanking(VAL_VIDEO_WID_T wId, bool blank, VAL_VIDEO_RECT_T inputRegion,
                                        VAL_VIDEO_RECT_T outputRegion)
 {
-#if 0
+    TRACE_SCOPE(TRACE_VAL, "setWindowBlanking", wId);
     if (!isSinkConnected(wId)) {
         LOG_ERROR(MSGID_VIDEO_BLANKING_FAILED, 0, "Sink %d is not connected", wId);
         return false;
     }
 
-    if (blank) {
-        /*FIX:PLAT-48894 Scaling is not working sometimes in Youtube app
-          We cannot initialize the values from the same object which is being constructed */
-        scale_param_t scale_param{outputRegion.x, outputRegion.y, outputRegion.w, outputRegion.h, 0, 0, 0, 0};
-
-        LOG_DEBUG("Calling setPlaneProperties with scale_params %d, %d, %d, %d %d %d %d %d ", scale_param.crtc_x,
-                  scale_param.crtc_y, scale_param.crtc_w, scale_param.crtc_h, scale_param.src_x, scale_param.src_y,
-                  scale_param.src_h, scale_param.src_w);
-
-        if (!driElements.setPlaneProperties(SET_SCALING_T, videoSinks[wId]->planeId, (uint64_t)&scale_param)) {
+    // Blanking shows a shared black buffer scaled to the window, unblanking puts the video back with the last
+    // geometry applied to the window. Neither allocates, so both stay cheap during channel changes.
+    SinkInfo *sink = videoSinks[wId];
+    if (sink->hasGeometry) {
+        inputRegion  = sink->srcRect;
+        outputRegion = sink->outRect;
+    }
+    bool detached = false;
+    if (!driElements.setPlaneBlank(sink->planeId, blank, inputRegion, outputRegion, detached)) {
+        if (blank)
             LOG_ERROR(MSGID_VIDEO_BLANKING_FAILED, 0, "Failed to blank wId %d", wId);
-            return false;
-        }
-    } else {
-        scale_param_t scale_param{outputRegion.x, outputRegion.y, outputRegion.w, outputRegion.h,
-                                  inputRegion.x,  inputRegion.y,  inputRegion.h,  inputRegion.w};
-
-        LOG_DEBUG("Calling setPlaneProperties with scale_params %d, %d, %d, %d %d %d %d %d ", scale_param.crtc_x,
-                  scale_param.crtc_y, scale_param.crtc_w, scale_param.crtc_h, scale_param.src_x, scale_param.src_y,
-                  scale_param.src_w, scale_param.src_h);
-
-        if (!driElements.setPlaneProperties(SET_SCALING_T, videoSinks[wId]->planeId, (uint64_t)&scale_param)) {
-            LOG_ERROR(MSGID_VIDEO_UNBLANKING_FAILED, 0, "Failed to apply scaling for plane %d",
-                      videoSinks[wId]->planeId);
-            return false;
-        }
+        else
+            LOG_ERROR(MSGID_VIDEO_UNBLANKING_FAILED, 0, "Failed to unblank wId %d", wId);
+        return false;
     }
-#endif
-
+    sink->blanked  = blank;
+    sink->detached = blank && detached;
+    updatePrimaryPlane(sink->crtcId);
     return true;
 }
 
-bool val_video_impl::setDisplayResolution(VAL_VIDEO_SIZE_T win, uint8_t display_path)
+bool val_video_impl::setPictureSettings(VAL_VIDEO_WID_T wId, const PictureSettings &settings)
+{
+    TRACE_SCOPE(TRACE_VAL, "setPictureSettings", wId);
+    if (!isValidSink(wId) || !videoSinks[wId]->crtcId)
+        return false;
+    // The crtc applies them, so they also change the other windows and the graphics on the same display.
+    return driElements.setCrtcPicture(videoSinks[wId]->crtcId, settings);
+}
+
+bool val_video_impl::getPictureSettings(VAL_VIDEO_WID_T wId, PictureSettings &settings)
+{
+    if (!isValidSink(wId) || !videoSinks[wId]->crtcId)
+        return false;
+    return driElements.getCrtcPicture(videoSinks[wId]->crtcId, settings);
+}
+
+bool val_video_impl::checkDisplayResolution(VAL_VIDEO_SIZE_T win, uint8_t display_path)
 {
     uint16_t numDisplay;
 
@@ -255,23 +410,111 @@ bool val_video_impl::setDisplayResolution(VAL_VIDEO_SIZE_T win, uint8_t display_
         LOG_ERROR(MSGID_MODE_CHANGE_FAILED, 0, "Invalid display path specified %d ", display_path);
         return false;
     }
-    if (driElements.changeMode(win.w, win.h, display_path)) {
+    return true;
+}
+
+bool val_video_impl::setDisplayResolution(VAL_VIDEO_SIZE_T win, uint8_t display_path)
+{
+    TRACE_SCOPE(TRACE_VAL, "setDisplayResolution", display_path);
 
+    if (!checkDisplayResolution(win, display_path))
+        return false;
+    // An explicit resolution replaces the mode to return to after playback.
+    mDesktopModes.clear();
+    if (!driElements.changeMode(win.w, win.h, display_path)) {
         LOG_ERROR(MSGID_MODE_CHANGE_FAILED, 0, "Resolution change failed %dx%d ", win.w, win.h);
         return false;
     }
     return true;
 }
 
-void val_video_impl::updatePlanes() // callback function
+bool val_video_impl::setDisplayResolutionAsync(VAL_VIDEO_SIZE_T win, uint8_t display_path,
+                                               std::function<void(bool)> done)
+{
+    TRACE_SCOPE(TRACE_VAL, "setDisplayResolutionAsync", display_path);
+
+    if (!checkDisplayResolution(win, display_path))
+        return false;
+    mDesktopModes.clear();
+    return driElements.changeModeAsync(win.w, win.h, display_path, 0, [win, done](bool ok) {
+        if (!ok)
+            LOG_ERROR(MSGID_MODE_CHANGE_FAILED, 0, "Resolution change failed %dx%d ", win.w, win.h);
+        if (done)
+            done(ok);
+    });
+}
+
+void val_video_impl::updatePlanes()
+{
+    for (auto &p : this->logicalPlanes)
+        updatePlaneRange(p);
+}
+
+void val_video_impl::bindSinks()
+{
+    // Windows keep their plane while it is on a crtc with a sink, the others take the free planes in order.
+    std::vector<unsigned int> pplaneList = driElements.getPlanes();
+    for (auto &plane : logicalPlanes) {
+        SinkInfo *sink = videoSinks[plane.wId];
+        if (!sink->planeId || driElements.getCrtcId(sink->planeId))
+            continue;
+        LOG_INFO(MSGID_DEVICE_STATUS, 0, "Plane %u of window %d went away", sink->planeId, plane.wId);
+        sink->planeId     = 0;
+        sink->crtcId      = 0;
+        sink->connId      = 0;
+        sink->connected   = false;
+        sink->hasGeometry = false;
+    }
+
+    physicalPlanes.clear();
+    auto physicalPlaneId = pplaneList.begin();
+    for (VAL_PLANE_T &plane : logicalPlanes) {
+        SinkInfo *sink = videoSinks[plane.wId];
+        if (sink->planeId) {
+            physicalPlanes.push_back(sink->planeId);
+            continue;
+        }
+        // Acquire a physical plane Id not used by another window.
+        while (physicalPlaneId != pplaneList.end() &&
+               std::any_of(videoSinks.begin(), videoSinks.end(),
+                           [physicalPlaneId](const std::pair<const VAL_VIDEO_WID_T, SinkInfo *> &s) {
+                               return s.second->planeId == *physicalPlaneId;
+                           }))
+            physicalPlaneId++;
+        if (physicalPlaneId == pplaneList.end()) {
+            LOG_DEBUG("insert dummy videoSinks for logical id of planes %d", plane.wId);
+            continue;
+        }
+        sink->planeId = *physicalPlaneId;
+        sink->crtcId  = driElements.getCrtcId(sink->planeId);
+        sink->connId  = driElements.getConnId(sink->planeId);
+        physicalPlanes.push_back(sink->planeId);
+        LOG_DEBUG("plane Name / wId : %s / %d, plane id : %d, crtc id : %d, conn id : %d", plane.planeName.c_str(),
+                  plane.wId, sink->planeId, sink->crtcId, sink->connId);
+        physicalPlaneId++;
+    }
+}
+
+void val_video_impl::updatePlanes(const HotplugChangeSet &changes) // callback function
+{
+    // Outputs of a device that came or went take windows or give them back.
+    bindSinks();
+    // Only windows on a crtc whose connector changed are updated.
+    for (auto &p : this->logicalPlanes) {
+        uint32_t crtcId = videoSinks[p.wId]->crtcId;
+        if (std::any_of(changes.begin(), changes.end(),
+                        [crtcId](const HotplugChange &change) { return change.crtcId == crtcId; }))
+            updatePlaneRange(p);
+    }
+}
+
+void val_video_impl::updatePlaneRange(VAL_PLANE_T &plane)
 {
     VAL_VIDEO_SIZE_T min = {};
     VAL_VIDEO_SIZE_T max = {};
-    for (auto &p : this->logicalPlanes) {
-        if (driElements.getModeRange(videoSinks[p.wId]->crtcId, min, max)) {
-            if (mDeviceCapability.getMaxResolution().h >= max.h || mDeviceCapability.getMaxResolution().w >= max.w) {
-                p.maxSizeT = max;
-            }
+    if (driElements.getModeRange(videoSinks[plane.wId]->crtcId, min, max)) {
+        if (mDeviceCapability.getMaxResolution().h >= max.h || mDeviceCapability.getMaxResolution().w >= max.w) {
+            plane.maxSizeT = max;
         }
     }
 }
@@ -294,48 +537,547 @@ std::vector<VAL_VIDEO_SIZE_T> val_video_impl::getSupportedResolutions(uint8_t di
     return modes;
 }
 
+bool val_video_impl::matchFrameRate(uint32_t crtcId, uint32_t frameRate)
+{
+    drmModeModeInfo current, mode;
+    if (!driElements.getCurrentMode(crtcId, current))
+        return false;
+    if (!driElements.findModeForFrameRate(crtcId, frameRate, mode)) {
+        LOG_INFO(MSGID_DEVICE_STATUS, 0, "No %ux%u mode for %.3f fps on crtc %u", current.hdisplay, current.vdisplay,
+                 frameRate / 1000.0, crtcId);
+        return false;
+    }
+    if (!memcmp(&mode, &current, sizeof(mode)))
+        return true;
+
+    if (!mDesktopModes.count(crtcId))
+        mDesktopModes[crtcId] = current;
+    if (!driElements.setMode(crtcId, mode)) {
+        LOG_ERROR(MSGID_MODE_CHANGE_FAILED, 0, "Failed to switch crtc %u to %s@%.3f", crtcId, mode.name,
+                  getRefreshMilliHz(mode) / 1000.0);
+        return false;
+    }
+    updatePrimaryPlane(crtcId);
+    return true;
+}
+
+void val_video_impl::setContentFrameRate(VAL_VIDEO_WID_T wId, uint32_t frameRate)
+{
+    SinkInfo *sink  = videoSinks[wId];
+    sink->frameRate = frameRate;
+
+    const FrameRatePolicy &policy = mDeviceCapability.getFrameRatePolicy();
+    if (!policy.autoSwitch || !sink->crtcId)
+        return;
+
+    if (!frameRate) {
+        // Restore the previous mode only once playback has stayed stopped for a while, so that a playlist or
+        // an ad break does not switch back and forth.
+        if (mDesktopModes.empty())
+            return;
+        if (mRevertTimeout)
+            g_source_remove(mRevertTimeout);
+        mRevertTimeout = g_timeout_add(policy.revertDelay, revertModes, this);
+        return;
+    }
+
+    if (mRevertTimeout) {
+        g_source_remove(mRevertTimeout);
+        mRevertTimeout = 0;
+    }
+
+    // Stay on the current mode as long as it shows every frame the same number of times.
+    drmModeModeInfo current;
+    if (driElements.getCurrentMode(sink->crtcId, current) &&
+        isFrameRateCadence(getRefreshMilliHz(current), frameRate)) {
+        LOG_DEBUG("%.3f Hz already matches %.3f fps", getRefreshMilliHz(current) / 1000.0, frameRate / 1000.0);
+        return;
+    }
+    matchFrameRate(sink->crtcId, frameRate);
+}
+
+gboolean val_video_impl::revertModes(gpointer userData)
+{
+    val_video_impl *self = static_cast<val_video_impl *>(userData);
+    self->mRevertTimeout = 0;
+
+    for (auto it = self->mDesktopModes.begin(); it != self->mDesktopModes.end();) {
+        uint32_t crtcId = it->first;
+        bool playing    = std::any_of(self->videoSinks.begin(), self->videoSinks.end(),
+                                   [crtcId](const std::pair<const VAL_VIDEO_WID_T, SinkInfo *> &s) {
+                                       return s.second->crtcId == crtcId && s.second->frameRate;
+                                   });
+        if (playing) {
+            ++it;
+            continue;
+        }
+        if (self->driElements.setMode(crtcId, it->second))
+            self->updatePrimaryPlane(crtcId);
+        it = self->mDesktopModes.erase(it);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+const std::unordered_map<std::string, val_video_impl::GetControl> &val_video_impl::getControls()
+{
+    static const std::unordered_map<std::string, GetControl> controls = {
+        {VAL_CTRL_DRM_RESOURCES, &val_video_impl::controlDrmResources},
+        {VAL_CTRL_NUM_CONNECTOR, &val_video_impl::controlNumConnector},
+        {VAL_CTRL_PRIMARY_PLANE_STATS, &val_video_impl::controlPrimaryPlaneStats},
+        {VAL_CTRL_DISPLAY_REFRESH_RATE, &val_video_impl::controlDisplayRefreshRate},
+        {VAL_CTRL_ALL_WINDOWS, &val_video_impl::controlAllWindows},
+        {VAL_CTRL_BUFFER_STATS, &val_video_impl::controlBufferStats},
+        {VAL_CTRL_HOTPLUG_STATS, &val_video_impl::controlHotplugStats},
+        {VAL_CTRL_DISPLAY_RESOLUTION, &val_video_impl::controlGetDisplayResolution},
+        {VAL_CTRL_POWER_STATS, &val_video_impl::controlPowerStats},
+        {VAL_CTRL_MEMORY_STATS, &val_video_impl::controlMemoryStats},
+        {VAL_CTRL_WINDOW_BLEND, &val_video_impl::controlGetWindowBlend},
+        {VAL_CTRL_WINDOW_TRANSFORM, &val_video_impl::controlGetWindowTransform},
+        {VAL_CTRL_VIDEO_COLOR, &val_video_impl::controlGetVideoColor},
+    };
+    return controls;
+}
+
+const std::unordered_map<std::string, val_video_impl::SetControl> &val_video_impl::setControls()
+{
+    static const std::unordered_map<std::string, SetControl> controls = {
+        {VAL_CTRL_CONTENT_FRAME_RATE, &val_video_impl::controlContentFrameRate},
+        {VAL_CTRL_MATCH_FRAME_RATE, &val_video_impl::controlMatchFrameRate},
+        {VAL_CTRL_TRACE, &val_video_impl::controlTrace},
+        {VAL_CTRL_TRACE_DUMP, &val_video_impl::controlTraceDump},
+        {VAL_CTRL_DISPLAY_RESOLUTION, &val_video_impl::controlSetDisplayResolution},
+        {VAL_CTRL_DISPLAY_POWER, &val_video_impl::controlDisplayPower},
+        {VAL_CTRL_WINDOW_BLEND, &val_video_impl::controlSetWindowBlend},
+        {VAL_CTRL_WINDOW_TRANSFORM, &val_video_impl::controlSetWindowTransform},
+        {VAL_CTRL_VIDEO_COLOR, &val_video_impl::controlSetVideoColor},
+    };
+    return controls;
+}
+
+bool val_video_impl::setParam(std::string control, pbnjson::JValue param)
+{
+    TRACE_SCOPE(TRACE_VAL, "setParam");
+    LOG_DEBUG("setParam control : %s", control.c_str());
+
+    auto handler = setControls().find(control);
+    if (handler == setControls().end()) {
+        LOG_DEBUG("Not supported control : %s", control.c_str());
+        return false;
+    }
+    return (this->*handler->second)(param);
+}
+
 pbnjson::JValue val_video_impl::getParam(std::string control, pbnjson::JValue param)
 {
-    int ret       = false;
-    int wId_param = 0;
-    bool wIdSet = false;
+    TRACE_SCOPE(TRACE_VAL, "getParam");
+    LOG_DEBUG("getParam control : %s", control.c_str());
+
+    auto handler = getControls().find(control);
+    if (handler == getControls().end()) {
+        LOG_DEBUG("Not supported control : %s", control.c_str());
+        return pbnjson::JValue{{"returnValue", false}};
+    }
+    return (this->*handler->second)(param);
+}
+
+bool val_video_impl::getWindowParam(pbnjson::JValue &param, VAL_VIDEO_WID_T &wId)
+{
+    if (!param.hasKey("wId"))
+        return false;
+    wId = static_cast<VAL_VIDEO_WID_T>(param["wId"].asNumber<int>());
+    return isValidSink(wId);
+}
+
+bool val_video_impl::getFrameRateParam(pbnjson::JValue &param, VAL_VIDEO_WID_T &wId, uint32_t &frameRate)
+{
+    if (!getWindowParam(param, wId) || !param.hasKey("frameRate"))
+        return false;
+    double fps = param["frameRate"].asNumber<double>();
+    if (fps < 0 || fps > 1000)
+        return false;
+    frameRate = static_cast<uint32_t>(fps * 1000 + 0.5);
+    return true;
+}
+
+pbnjson::JValue val_video_impl::controlDrmResources(pbnjson::JValue &param)
+{
     VAL_VIDEO_WID_T wId;
+    if (!getWindowParam(param, wId))
+        return pbnjson::JValue{{"returnValue", false}};
 
-    if (wIdSet = param.hasKey("wId"))
-        wId_param = param["wId"].asNumber<int>();
+    SinkInfo *sink = videoSinks[wId];
+    return pbnjson::JValue{{"returnValue", true},
+                           {"planeId", static_cast<int>(sink->planeId)},
+                           {"crtcId", static_cast<int>(sink->crtcId)},
+                           {"connId", static_cast<int>(sink->connId)}};
+}
 
-    LOG_DEBUG("getParam control : %s for wId:%d", control.c_str(), wId_param);
+pbnjson::JValue val_video_impl::controlNumConnector(pbnjson::JValue &param)
+{
+    int numConnector = driElements.getSupportedNumConnector();
+    if (numConnector <= 0)
+        return pbnjson::JValue{{"returnValue", false}};
+    return pbnjson::JValue{{"returnValue", true}, {"numConnector", numConnector}};
+}
 
-    if (control == VAL_CTRL_DRM_RESOURCES) {
-        int planeId = 0;
-        int crtcId  = 0;
-        int connId  = 0;
+pbnjson::JValue val_video_impl::controlPrimaryPlaneStats(pbnjson::JValue &param)
+{
+    PrimaryPlaneStats stats = driElements.getPrimaryPlaneStats();
+    return pbnjson::JValue{{"returnValue", true},
+                           {"elisions", static_cast<int64_t>(stats.elisions)},
+                           {"bytesSaved", static_cast<int64_t>(stats.bytesSaved)},
+                           {"bytesPerFrame", static_cast<int64_t>(stats.bytesPerFrame)}};
+}
 
-        if (!wIdSet)
-            return pbnjson::JValue{{"returnValue", false}};
+pbnjson::JValue val_video_impl::controlDisplayRefreshRate(pbnjson::JValue &param)
+{
+    VAL_VIDEO_WID_T wId;
+    drmModeModeInfo mode;
+    if (!getWindowParam(param, wId) || !driElements.getCurrentMode(videoSinks[wId]->crtcId, mode))
+        return pbnjson::JValue{{"returnValue", false}};
 
-        wId = static_cast<VAL_VIDEO_WID_T>(wId_param);
+    return pbnjson::JValue{{"returnValue", true},
+                           {"width", static_cast<int>(mode.hdisplay)},
+                           {"height", static_cast<int>(mode.vdisplay)},
+                           {"refreshRate", getRefreshMilliHz(mode) / 1000.0}};
+}
 
-        if (videoSinks.find(wId) != videoSinks.end()) {
-            planeId = videoSinks[wId]->planeId;
-            crtcId  = videoSinks[wId]->crtcId;
-            connId  = videoSinks[wId]->connId;
+static pbnjson::JValue rectToJson(const VAL_VIDEO_RECT_T &rect)
+{
+    return pbnjson::JValue{{"x", static_cast<int>(rect.x)},
+                           {"y", static_cast<int>(rect.y)},
+                           {"w", static_cast<int>(rect.w)},
+                           {"h", static_cast<int>(rect.h)}};
+}
 
-            ret = true;
-            return pbnjson::JValue{{"returnValue", ret}, {"planeId", planeId}, {"crtcId", crtcId}, {"connId", connId}};
+pbnjson::JValue val_video_impl::controlAllWindows(pbnjson::JValue &param)
+{
+    // Everything videooutputd otherwise queries window by window, in a single reply.
+    pbnjson::JValue windows = pbnjson::Array();
+    for (auto &plane : logicalPlanes) {
+        SinkInfo *sink         = videoSinks[plane.wId];
+        pbnjson::JValue window = pbnjson::JValue{{"wId", static_cast<int>(plane.wId)},
+                                                 {"planeName", plane.planeName},
+                                                 {"planeId", static_cast<int>(sink->planeId)},
+                                                 {"crtcId", static_cast<int>(sink->crtcId)},
+                                                 {"connId", static_cast<int>(sink->connId)},
+                                                 {"device", driElements.getDeviceNode(sink->planeId)},
+                                                 {"connected", sink->connected},
+                                                 {"blanked", sink->blanked}};
+        if (sink->hasGeometry) {
+            window.put("srcRect", rectToJson(sink->srcRect));
+            window.put("outRect", rectToJson(sink->outRect));
         }
-    } else if (control == VAL_CTRL_NUM_CONNECTOR) {
-        int numConnector = 0;
+        window.put("hvsBudget", HvsBandwidthModel::verdictName(sink->hvsVerdict));
+        if (sink->frameRate)
+            window.put("frameRate", sink->frameRate / 1000.0);
+        windows.append(window);
+    }
+
+    return pbnjson::JValue{{"returnValue", true},
+                           {"numConnector", static_cast<int>(driElements.getSupportedNumConnector())},
+                           {"windows", windows}};
+}
+
+pbnjson::JValue val_video_impl::controlBufferStats(pbnjson::JValue &param)
+{
+    pbnjson::JValue classes = pbnjson::Array();
+    for (auto &stats : BufferPool::instance().getStats()) {
+        uint64_t allocations = stats.allocations ? stats.allocations : 1;
+        classes.append(pbnjson::JValue{{"w", static_cast<int>(stats.width)},
+                                       {"h", static_cast<int>(stats.height)},
+                                       {"bpp", static_cast<int>(stats.bpp)},
+                                       {"reserved", static_cast<int>(stats.reserved)},
+                                       {"free", static_cast<int>(stats.free)},
+                                       {"inUse", static_cast<int>(stats.inUse)},
+                                       {"highWater", static_cast<int>(stats.highWater)},
+                                       {"allocations", static_cast<int64_t>(stats.allocations)},
+                                       {"hits", static_cast<int64_t>(stats.hits)},
+                                       {"failures", static_cast<int64_t>(stats.failures)},
+                                       {"avgLatencyUs", static_cast<int64_t>(stats.latencyUs / allocations)},
+                                       {"maxLatencyUs", static_cast<int64_t>(stats.maxLatencyUs)}});
+    }
+    return pbnjson::JValue{{"returnValue", true}, {"classes", classes}};
+}
+
+static pbnjson::JValue usageToJson(const MemoryUsage &usage)
+{
+    return pbnjson::JValue{{"bytes", static_cast<int64_t>(usage.bytes)},
+                           {"peak", static_cast<int64_t>(usage.peak)},
+                           {"buffers", static_cast<int>(usage.buffers)}};
+}
+
+pbnjson::JValue val_video_impl::controlMemoryStats(pbnjson::JValue &param)
+{
+    MemoryLedger ledger      = BufferPool::instance().getLedger();
+    pbnjson::JValue purposes = pbnjson::Object();
+    for (int purpose = 0; purpose < BUFFER_PURPOSE_COUNT; purpose++) {
+        purposes.put(BufferPool::purposeName(static_cast<BUFFER_PURPOSE_T>(purpose)),
+                     usageToJson(ledger.purposes[purpose]));
+    }
+
+    pbnjson::JValue buffers = pbnjson::Array();
+    for (auto &buffer : BufferPool::instance().getBuffersInUse()) {
+        buffers.append(pbnjson::JValue{{"purpose", BufferPool::purposeName(buffer.purpose)},
+                                       {"owner", static_cast<int64_t>(buffer.owner)},
+                                       {"w", static_cast<int>(buffer.width)},
+                                       {"h", static_cast<int>(buffer.height)},
+                                       {"size", static_cast<int64_t>(buffer.size)}});
+    }
+
+    return pbnjson::JValue{{"returnValue", true},
+                           {"budget", static_cast<int64_t>(ledger.budget)},
+                           {"total", usageToJson(ledger.total)},
+                           {"pooled", usageToJson(ledger.pooled)},
+                           {"purposes", purposes},
+                           {"buffers", buffers},
+                           {"rejections", static_cast<int64_t>(ledger.rejections)},
+                           {"lastFailure", ledger.lastFailure}};
+}
+
+pbnjson::JValue val_video_impl::controlHotplugStats(pbnjson::JValue &param)
+{
+    HotplugStats stats = driElements.getHotplugStats();
+    return pbnjson::JValue{{"returnValue", true},
+                           {"received", static_cast<int64_t>(stats.received)},
+                           {"processed", static_cast<int64_t>(stats.processed)},
+                           {"leadingEdge", static_cast<int64_t>(stats.leadingEdge)}};
+}
+
+pbnjson::JValue val_video_impl::controlGetDisplayResolution(pbnjson::JValue &param)
+{
+    return pbnjson::JValue{{"returnValue", true}, {"state", mResolutionChange}};
+}
+
+pbnjson::JValue val_video_impl::controlPowerStats(pbnjson::JValue &param)
+{
+    PowerStats stats = driElements.getPowerStats();
+    return pbnjson::JValue{{"returnValue", true},
+                           {"idleCrtcs", static_cast<int>(stats.idleCrtcs)},
+                           {"disables", static_cast<int64_t>(stats.disables)},
+                           {"bytesReleased", static_cast<int64_t>(stats.bytesReleased)},
+                           {"fetchSaved", static_cast<int64_t>(stats.fetchSaved)},
+                           {"displaysOff", static_cast<int>(stats.displaysOff)}};
+}
+
+bool val_video_impl::controlContentFrameRate(pbnjson::JValue &param)
+{
+    VAL_VIDEO_WID_T wId;
+    uint32_t frameRate;
+    if (!getFrameRateParam(param, wId, frameRate))
+        return false;
+    setContentFrameRate(wId, frameRate);
+    return true;
+}
+
+bool val_video_impl::controlMatchFrameRate(pbnjson::JValue &param)
+{
+    VAL_VIDEO_WID_T wId;
+    uint32_t frameRate;
+    if (!getFrameRateParam(param, wId, frameRate) || !frameRate)
+        return false;
+    return matchFrameRate(videoSinks[wId]->crtcId, frameRate);
+}
+
+bool val_video_impl::controlTrace(pbnjson::JValue &param)
+{
+    if (!param.hasKey("enable"))
+        return false;
+    Trace::setEnabled(param["enable"].asBool());
+    return true;
+}
+
+bool val_video_impl::controlTraceDump(pbnjson::JValue &param)
+{
+    return Trace::dump(param.hasKey("path") ? param["path"].asString() : mDeviceCapability.getTracePath());
+}
+
+bool val_video_impl::controlSetDisplayResolution(pbnjson::JValue &param)
+{
+    if (!param.hasKey("w") || !param.hasKey("h"))
+        return false;
+    VAL_VIDEO_SIZE_T win;
+    win.w               = static_cast<uint16_t>(param["w"].asNumber<int32_t>());
+    win.h               = static_cast<uint16_t>(param["h"].asNumber<int32_t>());
+    uint8_t displayPath = 0;
+    if (param.hasKey("displayPath"))
+        displayPath = static_cast<uint8_t>(param["displayPath"].asNumber<int32_t>());
+
+    if (!setDisplayResolutionAsync(win, displayPath, [this](bool ok) { mResolutionChange = ok ? "done" : "failed"; }))
+        return false;
+    mResolutionChange = "pending";
+    return true;
+}
+
+bool val_video_impl::controlDisplayPower(pbnjson::JValue &param)
+{
+    VAL_VIDEO_WID_T wId;
+    if (!getWindowParam(param, wId) || !param.hasKey("on"))
+        return false;
+    return driElements.setDisplayPower(videoSinks[wId]->crtcId, param["on"].asBool());
+}
+
+bool val_video_impl::controlSetWindowBlend(pbnjson::JValue &param)
+{
+    // alpha goes from 0.0 (transparent) to 1.0 (opaque). With fadeMs the plane gets there on its own, one step
+    // per vblank, without further calls.
+    VAL_VIDEO_WID_T wId;
+    if (!getWindowParam(param, wId) || !videoSinks[wId]->planeId)
+        return false;
+    uint32_t planeId = videoSinks[wId]->planeId;
+
+    if (param.hasKey("blendMode") && !driElements.setPlaneBlendMode(planeId, param["blendMode"].asString()))
+        return false;
+    if (!param.hasKey("alpha"))
+        return true;
+
+    double alpha = param["alpha"].asNumber<double>();
+    if (alpha < 0 || alpha > 1)
+        return false;
+    uint16_t value = static_cast<uint16_t>(alpha * PLANE_ALPHA_OPAQUE + 0.5);
+    int32_t fadeMs = param.hasKey("fadeMs") ? param["fadeMs"].asNumber<int32_t>() : 0;
+    if (fadeMs < 0)
+        return false;
+    return fadeMs ? driElements.fadePlane(planeId, value, static_cast<uint32_t>(fadeMs))
+                  : driElements.setPlaneAlpha(planeId, value);
+}
+
+pbnjson::JValue val_video_impl::controlGetWindowBlend(pbnjson::JValue &param)
+{
+    VAL_VIDEO_WID_T wId;
+    PlaneBlend blend;
+    if (!getWindowParam(param, wId) || !driElements.getPlaneBlend(videoSinks[wId]->planeId, blend))
+        return pbnjson::JValue{{"returnValue", false}};
+
+    pbnjson::JValue modes = pbnjson::Array();
+    for (auto &mode : blend.modes)
+        modes.append(mode);
+    pbnjson::JValue reply = pbnjson::JValue{{"returnValue", true},
+                                            {"alpha", static_cast<double>(blend.alpha) / PLANE_ALPHA_OPAQUE},
+                                            {"hasAlpha", blend.hasAlpha},
+                                            {"blendModes", modes},
+                                            {"fading", blend.fading}};
+    if (!blend.mode.empty())
+        reply.put("blendMode", blend.mode);
+    return reply;
+}
+
+static const uint32_t rotations[][2] = {
+    {0, DRM_MODE_ROTATE_0}, {90, DRM_MODE_ROTATE_90}, {180, DRM_MODE_ROTATE_180}, {270, DRM_MODE_ROTATE_270}};
+
+bool val_video_impl::controlSetWindowTransform(pbnjson::JValue &param)
+{
+    // rotation is counter clockwise in degrees, reflections are applied after it. false when the plane cannot
+    // apply the transform, the client then has to, on an unrotated plane.
+    VAL_VIDEO_WID_T wId;
+    if (!getWindowParam(param, wId) || !videoSinks[wId]->planeId)
+        return false;
 
-        numConnector = driElements.getSupportedNumConnector();
-        if (numConnector > 0) {
-            ret = true;
-            return pbnjson::JValue{{"returnValue", ret}, {"numConnector", numConnector}};
+    int32_t degrees    = param.hasKey("rotation") ? param["rotation"].asNumber<int32_t>() : 0;
+    uint32_t transform = 0;
+    for (auto &r : rotations) {
+        if (static_cast<int32_t>(r[0]) == degrees)
+            transform = r[1];
+    }
+    if (!transform)
+        return false;
+    if (param.hasKey("reflectX") && param["reflectX"].asBool())
+        transform |= DRM_MODE_REFLECT_X;
+    if (param.hasKey("reflectY") && param["reflectY"].asBool())
+        transform |= DRM_MODE_REFLECT_Y;
+
+    SinkInfo *sink          = videoSinks[wId];
+    sink->transform         = transform;
+    sink->softwareTransform = !driElements.setPlaneRotation(sink->planeId, transform);
+    if (sink->softwareTransform)
+        LOG_INFO(MSGID_DEVICE_STATUS, 0, "wId %d: rotation %d%s%s falls back to software", wId, degrees,
+                 transform & DRM_MODE_REFLECT_X ? " reflect-x" : "",
+                 transform & DRM_MODE_REFLECT_Y ? " reflect-y" : "");
+    return !sink->softwareTransform;
+}
+
+pbnjson::JValue val_video_impl::controlGetWindowTransform(pbnjson::JValue &param)
+{
+    VAL_VIDEO_WID_T wId;
+    if (!getWindowParam(param, wId))
+        return pbnjson::JValue{{"returnValue", false}};
+
+    SinkInfo *sink          = videoSinks[wId];
+    uint32_t supported      = driElements.getPlaneRotations(sink->planeId);
+    pbnjson::JValue degrees = pbnjson::Array();
+    int32_t rotation        = 0;
+    for (auto &r : rotations) {
+        if (supported & r[1])
+            degrees.append(static_cast<int32_t>(r[0]));
+        if (sink->transform & r[1])
+            rotation = static_cast<int32_t>(r[0]);
+    }
+    return pbnjson::JValue{{"returnValue", true},
+                           {"rotation", rotation},
+                           {"reflectX", (sink->transform & DRM_MODE_REFLECT_X) != 0},
+                           {"reflectY", (sink->transform & DRM_MODE_REFLECT_Y) != 0},
+                           {"hardware", !sink->softwareTransform},
+                           {"supportedRotations", degrees},
+                           {"supportsReflectX", (supported & DRM_MODE_REFLECT_X) != 0},
+                           {"supportsReflectY", (supported & DRM_MODE_REFLECT_Y) != 0}};
+}
+
+bool val_video_impl::controlSetVideoColor(pbnjson::JValue &param)
+{
+    // Stream metadata as players get it: matrix as "bt601", "bt709" or "bt2020", or matrixCoefficients as coded
+    // in the bitstream (ITU-T H.273). Without either, SD content is taken as BT.601 and the rest as BT.709.
+    VAL_VIDEO_WID_T wId;
+    if (!getWindowParam(param, wId) || !videoSinks[wId]->planeId)
+        return false;
+
+    COLOR_ENCODING_T encoding = COLOR_ENCODING_BT709;
+    if (param.hasKey("matrix")) {
+        std::string matrix = param["matrix"].asString();
+        if (matrix == "bt601")
+            encoding = COLOR_ENCODING_BT601;
+        else if (matrix == "bt2020")
+            encoding = COLOR_ENCODING_BT2020;
+        else if (matrix != "bt709")
+            return false;
+    } else if (param.hasKey("matrixCoefficients")) {
+        switch (param["matrixCoefficients"].asNumber<int32_t>()) {
+        case 1: // BT.709
+            break;
+        case 5: // BT.470 System B, G
+        case 6: // SMPTE 170M
+            encoding = COLOR_ENCODING_BT601;
+            break;
+        case 9: // BT.2020 non-constant luminance
+        case 10:
+            encoding = COLOR_ENCODING_BT2020;
+            break;
+        default:
+            return false;
         }
-    } else {
-        LOG_DEBUG("Not supported control : %s", control.c_str());
-        ret = false;
+    } else if (param.hasKey("height") && param["height"].asNumber<int32_t>() <= 576) {
+        encoding = COLOR_ENCODING_BT601;
     }
+    bool fullRange = param.hasKey("fullRange") && param["fullRange"].asBool();
+
+    return driElements.setPlaneColor(videoSinks[wId]->planeId, encoding, fullRange);
+}
+
+pbnjson::JValue val_video_impl::controlGetVideoColor(pbnjson::JValue &param)
+{
+    VAL_VIDEO_WID_T wId;
+    PlaneColor color;
+    if (!getWindowParam(param, wId) || !driElements.getPlaneColor(videoSinks[wId]->planeId, color))
+        return pbnjson::JValue{{"returnValue", false}};
 
-    return pbnjson::JValue{{"returnValue", ret}};
+    pbnjson::JValue encodings = pbnjson::Array();
+    for (auto &e : color.encodings)
+        encodings.append(e);
+    pbnjson::JValue ranges = pbnjson::Array();
+    for (auto &r : color.ranges)
+        ranges.append(r);
+    return pbnjson::JValue{{"returnValue", true},
+                           {"encoding", color.encoding},
+                           {"range", color.range},
+                           {"encodings", encodings},
+                           {"ranges", ranges}};
 }
@@ -17,11 +17,31 @@
 #pragma once
 #include "device_capability.h"
 #include "driElements.h"
+#include "hvsBandwidth.h"
 #include "logging.h"
+#include <drm_fourcc.h>
 #include <unordered_map>
 #include <val_api.h>
 #include <vector>
 
+// Controls specific to this implementation, on top of the VAL_CTRL_* ones from the API.
+#define VAL_CTRL_PRIMARY_PLANE_STATS "primaryPlaneStats"
+#define VAL_CTRL_CONTENT_FRAME_RATE "contentFrameRate"     // set: {wId, frameRate}, 0 when playback stops
+#define VAL_CTRL_MATCH_FRAME_RATE "matchFrameRate"         // set: {wId, frameRate}, switches now
+#define VAL_CTRL_DISPLAY_REFRESH_RATE "displayRefreshRate" // get: {wId}
+#define VAL_CTRL_TRACE "trace"                             // set: {enable}
+#define VAL_CTRL_TRACE_DUMP "traceDump"                    // set: {path}, path defaults to trace.path
+#define VAL_CTRL_ALL_WINDOWS "allWindows"                  // get: DRM resources, state and geometry of every window
+#define VAL_CTRL_BUFFER_STATS "bufferStats"                // get: per size dumb buffer pool usage and allocation times
+#define VAL_CTRL_HOTPLUG_STATS "hotplugStats"              // get: udev hotplug events received and processed
+#define VAL_CTRL_DISPLAY_RESOLUTION "displayResolution"    // set: {w, h, displayPath}, returns once started; get: state
+#define VAL_CTRL_DISPLAY_POWER "displayPower"              // set: {wId, on}, DPMS of the display showing the window
+#define VAL_CTRL_POWER_STATS "powerStats"                  // get: crtcs turned off without a sink, displays in DPMS off
+#define VAL_CTRL_MEMORY_STATS "memoryStats"                // get: dumb buffer memory by purpose and owner, budget
+#define VAL_CTRL_WINDOW_BLEND "windowBlend"                // set: {wId, alpha, blendMode, fadeMs}; get: {wId}
+#define VAL_CTRL_WINDOW_TRANSFORM "windowTransform"        // set: {wId, rotation, reflectX, reflectY}; get: {wId}
+#define VAL_CTRL_VIDEO_COLOR "videoColor"                  // set: {wId, matrix, fullRange, height}; get: {wId}
+
 class SinkInfo
 {
 public:
@@ -30,6 +50,21 @@ public:
     unsigned connId;
     bool connected = false;
 
+    // Last geometry applied to the plane, used for the HVS load of the window set.
+    bool hasGeometry         = false;
+    HVS_VERDICT_T hvsVerdict = HVS_ACCEPT;      // of the last geometry checked against the HVS budget
+    uint32_t format          = DRM_FORMAT_NV12; // format of the buffer on the plane, NV12 until one is seen
+    VAL_VIDEO_RECT_T srcRect = {};
+    VAL_VIDEO_RECT_T outRect = {};
+
+    uint32_t frameRate = 0; // mHz, frame rate of the content being played, 0 if unknown
+
+    bool blanked  = false;
+    bool detached = false; // blanked by detaching the plane, it covers nothing
+
+    uint32_t transform     = DRM_MODE_ROTATE_0; // DRM_MODE_ROTATE_* | DRM_MODE_REFLECT_* requested for the window
+    bool softwareTransform = false;             // the plane cannot apply transform, the client does
+
     SinkInfo(unsigned _planeId, unsigned _crtcId, unsigned _connId)
     {
         planeId = _planeId;
@@ -46,15 +81,61 @@ private:
     std::unordered_map<VAL_VIDEO_WID_T, SinkInfo *> videoSinks;
     DeviceCapability &mDeviceCapability;
     DRIElements driElements;
+    HvsBandwidthModel mHvsModel;
+    std::unordered_map<uint32_t, drmModeModeInfo> mDesktopModes; // crtc modes before switching to the content rate
+    guint mRevertTimeout = 0;
+    std::string mResolutionChange = "idle"; // state of the last setDisplayResolutionAsync
 
     bool isValidSink(VAL_VIDEO_WID_T wId);
     bool isSinkConnected(VAL_VIDEO_WID_T wId);
+    // Gives the windows without a plane one of the planes of the active crtcs.
+    void bindSinks();
     void updatePlanes();
+    void updatePlanes(const HotplugChangeSet &changes);
+    void updatePlaneRange(VAL_PLANE_T &plane);
     bool isValidMode(VAL_VIDEO_SIZE_T win);
+    bool checkDisplayResolution(VAL_VIDEO_SIZE_T win, uint8_t display_path);
+    HVS_VERDICT_T admitWindow(VAL_VIDEO_WID_T wId, VAL_VIDEO_RECT_T &inputRegion, VAL_VIDEO_RECT_T outputRegion);
+    bool isPrimaryOccluded(uint32_t crtcId, VAL_VIDEO_SIZE_T display);
+    void updatePrimaryPlane(uint32_t crtcId);
+    bool matchFrameRate(uint32_t crtcId, uint32_t frameRate);
+    void setContentFrameRate(VAL_VIDEO_WID_T wId, uint32_t frameRate);
+    static gboolean revertModes(gpointer userData);
+
+    // getParam/setParam controls, looked up by name in tables built on first use.
+    typedef pbnjson::JValue (val_video_impl::*GetControl)(pbnjson::JValue &param);
+    typedef bool (val_video_impl::*SetControl)(pbnjson::JValue &param);
+    static const std::unordered_map<std::string, GetControl> &getControls();
+    static const std::unordered_map<std::string, SetControl> &setControls();
+    bool getWindowParam(pbnjson::JValue &param, VAL_VIDEO_WID_T &wId);
+    bool getFrameRateParam(pbnjson::JValue &param, VAL_VIDEO_WID_T &wId, uint32_t &frameRate);
+
+    pbnjson::JValue controlDrmResources(pbnjson::JValue &param);
+    pbnjson::JValue controlNumConnector(pbnjson::JValue &param);
+    pbnjson::JValue controlPrimaryPlaneStats(pbnjson::JValue &param);
+    pbnjson::JValue controlDisplayRefreshRate(pbnjson::JValue &param);
+    pbnjson::JValue controlAllWindows(pbnjson::JValue &param);
+    pbnjson::JValue controlBufferStats(pbnjson::JValue &param);
+    pbnjson::JValue controlHotplugStats(pbnjson::JValue &param);
+    pbnjson::JValue controlGetDisplayResolution(pbnjson::JValue &param);
+    pbnjson::JValue controlPowerStats(pbnjson::JValue &param);
+    pbnjson::JValue controlMemoryStats(pbnjson::JValue &param);
+    pbnjson::JValue controlGetWindowBlend(pbnjson::JValue &param);
+    pbnjson::JValue controlGetWindowTransform(pbnjson::JValue &param);
+    pbnjson::JValue controlGetVideoColor(pbnjson::JValue &param);
+    bool controlContentFrameRate(pbnjson::JValue &param);
+    bool controlMatchFrameRate(pbnjson::JValue &param);
+    bool controlTrace(pbnjson::JValue &param);
+    bool controlTraceDump(pbnjson::JValue &param);
+    bool controlSetDisplayResolution(pbnjson::JValue &param);
+    bool controlDisplayPower(pbnjson::JValue &param);
+    bool controlSetWindowBlend(pbnjson::JValue &param);
+    bool controlSetWindowTransform(pbnjson::JValue &param);
+    bool controlSetVideoColor(pbnjson::JValue &param);
 
 public:
     val_video_impl(DeviceCapability &capability);
-    ~val_video_impl() {}
+    ~val_video_impl();
 
     bool connect(VAL_VIDEO_WID_T wId, VAL_VSC_INPUT_SRC_INFO_T vscInput, VAL_VSC_OUTPUT_MODE_T outputmode,
                  unsigned int *planeId);
@@ -64,13 +145,18 @@ public:
     bool setDualVideo(bool enable);
     bool setCompositionParams(std::vector<VAL_WINDOW_INFO_T> zOrder);
     bool setWindowBlanking(VAL_VIDEO_WID_T wId, bool blank, VAL_VIDEO_RECT_T inRegion, VAL_VIDEO_RECT_T outRegion);
+    // Brightness, contrast, saturation and colour temperature of the display showing the window.
+    bool setPictureSettings(VAL_VIDEO_WID_T wId, const PictureSettings &settings);
+    bool getPictureSettings(VAL_VIDEO_WID_T wId, PictureSettings &settings);
 
     bool setDisplayResolution(VAL_VIDEO_SIZE_T, uint8_t);
+    // Returns as soon as the change is started. done gets the result on the GLib main context.
+    bool setDisplayResolutionAsync(VAL_VIDEO_SIZE_T win, uint8_t display_path, std::function<void(bool)> done);
     std::vector<VAL_VIDEO_SIZE_T> getSupportedResolutions(uint8_t dispIndex = 0);
     VAL_VIDEO_RECT_T getDisplayResolution();
 
     bool getDeviceCapabilities(VAL_VIDEO_SIZE_T &minDownscaleSize, VAL_VIDEO_SIZE_T &maxUpscaleSize); // Deprecated
     std::vector<VAL_PLANE_T> getVideoPlanes();
-    bool setParam(std::string control, pbnjson::JValue param) { return true; };
+    bool setParam(std::string control, pbnjson::JValue param);
     pbnjson::JValue getParam(std::string control, pbnjson::JValue param);
 };
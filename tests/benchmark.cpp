@@ -0,0 +1,353 @@
+// Copyright (c) 2026 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Micro benchmarks for hot paths of the library. Run all of them, or only those named on the command line.
+// Some also check known results, the run fails when one does not match.
+
+#include "driElements.h"
+#include "fill.h"
+#include "hvsBandwidth.h"
+#include "logging.h"
+#include "pictureAdjust.h"
+#include "trace.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <drm_fourcc.h>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+// clang-format off
+#include "format.h"
+#include "pattern.h"
+// clang-format on
+
+// LOG_DEBUG as it was before the level check: the arguments, and the stream behind them, are always built.
+#define UNCHECKED_LOG_DEBUG(fmt, ...) \
+    PmLogDebug(valLogContext, "%s:%s() " fmt, __FILE__, __FUNCTION__, ##__VA_ARGS__)
+
+// Checks of known results, they make the run fail.
+static unsigned int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+template <typename F> static double nsPerCall(size_t iterations, F fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++)
+        fn(i);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+static void benchLogging()
+{
+    const size_t iterations = 1000000;
+    volatile uint32_t width = 1920, height = 1080;
+
+    // Measure what disabled debug logs cost on the hot paths, which is how the library runs in production.
+    PmLogSetContextLevel(valLogContext, kPmLogLevel_Info);
+
+    double unchecked = nsPerCall(iterations, [&](size_t i) {
+        std::stringstream modeStr;
+        modeStr << width << "x" << height;
+        UNCHECKED_LOG_DEBUG("\n setActiveMode to %s", modeStr.str().c_str());
+    });
+    double checked = nsPerCall(iterations, [&](size_t i) {
+        char modeName[32];
+        LOG_DEBUG("\n setActiveMode to %s", (snprintf(modeName, sizeof(modeName), "%ux%u", width, height), modeName));
+    });
+    printf("logging: disabled LOG_DEBUG with stream %.1f ns/call, checked %.1f ns/call, saving %.1f ns/call\n",
+           unchecked, checked, unchecked - checked);
+
+    unchecked = nsPerCall(iterations, [&](size_t i) {
+        UNCHECKED_LOG_DEBUG("Applying set plane to output {x:%u, y:%u, w:%u, h:%u}", 0, 0, width, height);
+    });
+    checked = nsPerCall(iterations, [&](size_t i) {
+        LOG_DEBUG("Applying set plane to output {x:%u, y:%u, w:%u, h:%u}", 0, 0, width, height);
+    });
+    printf("logging: disabled LOG_DEBUG with scalars %.1f ns/call, checked %.1f ns/call, saving %.1f ns/call\n",
+           unchecked, checked, unchecked - checked);
+}
+
+static void benchTrace()
+{
+    const size_t iterations = 1000000;
+
+    Trace::setEnabled(false);
+    double disabled = nsPerCall(iterations, [](size_t i) { TRACE_SCOPE(TRACE_VAL, "benchmark", i); });
+    Trace::setEnabled(true);
+    double enabled = nsPerCall(iterations, [](size_t i) { TRACE_SCOPE(TRACE_VAL, "benchmark", i); });
+    Trace::setEnabled(false);
+    printf("trace: span disabled %.1f ns, enabled %.1f ns\n", disabled, enabled);
+}
+
+// Bytes per pixel of the first plane, laid out the way fill_pattern() does for a dumb buffer.
+static unsigned int bytesPerPixel(const util_format_info &info)
+{
+    if (info.yuv.xsub)
+        return (info.yuv.order & (YUV_YC | YUV_CY)) ? 2 : 1;
+    if (info.format == DRM_FORMAT_RGB888 || info.format == DRM_FORMAT_BGR888)
+        return 3;
+    return info.rgb.red.length >= 8 ? 4 : 2;
+}
+
+static void benchPattern()
+{
+    const unsigned int width = 1920, height = 1080, iterations = 5;
+    const char *patternNames[] = {"tiles", "plain", "smpte"};
+
+    // Cached memory stands in for the dumb buffer mapping, so this measures the kernels rather than the bus.
+    for (auto &info : format_info) {
+        unsigned int stride = (width * bytesPerPixel(info) + 63) & ~63u;
+        size_t size         = static_cast<size_t>(stride) * height * 2;
+        unsigned char *mem  = static_cast<unsigned char *>(aligned_alloc(64, size));
+        if (!mem)
+            return;
+        void *planes[3] = {mem, mem + stride * height, mem + stride * height + stride / 2 * height / 2};
+        memset(mem, 0, size);
+
+        for (int pattern = UTIL_PATTERN_TILES; pattern <= UTIL_PATTERN_SMPTE; pattern++) {
+            printf("pattern: %s %-5s", info.name, patternNames[pattern]);
+            const char *kernel;
+            for (unsigned int k = 0; (kernel = Fill::kernelName(k)); k++) {
+                Fill::setKernel(kernel);
+                double ns = nsPerCall(iterations, [&](size_t i) {
+                    util_fill_pattern(info.format, static_cast<enum util_fill_pattern>(pattern), planes, width, height,
+                                      stride);
+                });
+                printf("  %s %.2f ms", kernel, ns / 1000000);
+            }
+            printf("\n");
+        }
+        free(mem);
+    }
+    Fill::setKernel(Fill::kernelName(0));
+}
+
+static void benchClear()
+{
+    const unsigned int width = 3840, height = 2160, pitch = width * 4, iterations = 20;
+    uint8_t *mem = static_cast<uint8_t *>(aligned_alloc(64, static_cast<size_t>(pitch) * height));
+    if (!mem)
+        return;
+
+    for (unsigned int k = 0; Fill::kernelName(k); k++) {
+        Fill::setKernel(Fill::kernelName(k));
+        double ns = nsPerCall(iterations, [&](size_t i) { Fill::fillRows(mem, pitch, pitch, height, 0); });
+        printf("clear: %ux%u XRGB8888 %s on %u threads %.2f ms\n", width, height, Fill::kernelName(k),
+               Fill::threads(), ns / 1000000);
+    }
+    Fill::setKernel(Fill::kernelName(0));
+    free(mem);
+}
+
+// Building the gamma LUT of a picture settings change, for the legacy table and a large GAMMA_LUT.
+static void benchGammaLut()
+{
+    const size_t iterations = 10000;
+    PictureSettings settings;
+    settings.brightness       = 60;
+    settings.contrast         = 70;
+    settings.colorTemperature = -20;
+
+    for (uint32_t size : {256u, 4096u}) {
+        std::vector<drm_color_lut> lut(size), reference(size);
+        double scalar = nsPerCall(iterations, [&](size_t i) {
+            PictureAdjust::buildGammaLutScalar(settings, reference.data(), size);
+        });
+        double simd   = nsPerCall(iterations,
+                                  [&](size_t i) { PictureAdjust::buildGammaLut(settings, lut.data(), size); });
+        bool same     = !memcmp(lut.data(), reference.data(), size * sizeof(drm_color_lut));
+        printf("gammaLut: %u entries scalar %.0f ns, %s %.0f ns (%.1fx)%s\n", size, scalar, PictureAdjust::simdName(),
+               simd, scalar / simd, same ? "" : ", results differ");
+    }
+}
+
+// Resident set size in kB.
+static long residentKb()
+{
+    long pages = 0, resident = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (!statm)
+        return 0;
+    if (fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+        resident = 0;
+    fclose(statm);
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// Open file descriptors of the process.
+static long openFds()
+{
+    long count = 0;
+    DIR *dir   = opendir("/proc/self/fd");
+    if (!dir)
+        return 0;
+    while (readdir(dir))
+        count++;
+    closedir(dir);
+    return count;
+}
+
+// What hotplugs cost: the devices opened and loaded with every connector set up, then a replug of every connector
+// probed and set up again, then all of it released. The modes are set on each cycle, as when the service starts.
+static void benchHotplug()
+{
+    const unsigned int cycles = 50, warmup = 5;
+    VAL_VIDEO_SIZE_T confMode = {1920, 1080};
+
+    long warmKb = 0, warmFds = 0;
+    double loadMs = 0, replugMs = 0;
+    size_t connectors = 0;
+    for (unsigned int cycle = 0; cycle < cycles; cycle++) {
+        if (cycle == warmup) {
+            warmKb  = residentKb();
+            warmFds = openFds();
+            loadMs = replugMs = 0;
+        }
+        auto start = std::chrono::steady_clock::now();
+        {
+            DRIElements elements(confMode, [](const HotplugChangeSet &) {});
+            if (elements.mDeviceList.empty()) {
+                printf("hotplug: no DRM device, skipped\n");
+                return;
+            }
+            auto loaded = std::chrono::steady_clock::now();
+            loadMs += std::chrono::duration<double, std::milli>(loaded - start).count();
+
+            connectors = 0;
+            for (auto &devPair : elements.mDeviceList) {
+                DriDevice &device = devPair.second;
+                HotplugChangeSet changes;
+                for (auto &conn : device.connectorList)
+                    conn.configuredPlugged = false;
+                device.setupDevice(confMode, 0, changes);
+                connectors += device.connectorList.size();
+            }
+            replugMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loaded).count();
+            start = std::chrono::steady_clock::now();
+        }
+        loadMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    long kb  = residentKb();
+    long fds = openFds();
+    printf("hotplug: %u cycles of %zu connectors, open/load/destroy %.2f ms/cycle, replug %.2f ms/cycle, RSS %ld kB "
+           "after %u cycles, %ld kB after %u (%+ld kB), %+ld fds\n",
+           cycles, connectors, loadMs / (cycles - warmup), replugMs / (cycles - warmup), warmKb, warmup, kb, cycles,
+           kb - warmKb, fds - warmFds);
+    check(fds == warmFds, "hotplug: devices closed when released");
+}
+
+static HvsPlaneLoad planeLoad(uint32_t format, uint32_t src_w, uint32_t src_h, uint32_t dst_w, uint32_t dst_h)
+{
+    HvsPlaneLoad plane;
+    plane.format = format;
+    plane.src_w  = src_w;
+    plane.src_h  = src_h;
+    plane.dst_w  = dst_w;
+    plane.dst_h  = dst_h;
+    return plane;
+}
+
+// The HVS load model against plane sets worked out by hand, then what admitting a window costs.
+static void benchHvsModel()
+{
+    const size_t iterations = 100000;
+    HvsBudget budget;
+    HvsBandwidthModel strict(budget);
+    budget.downgrade = true;
+    HvsBandwidthModel model(budget);
+    HvsPlaneLoad primary = planeLoad(DRM_FORMAT_XRGB8888, 1920, 1080, 1920, 1080);
+    HvsPlaneLoad video   = planeLoad(DRM_FORMAT_NV12, 3840, 2160, 1920, 1080);
+
+    // 1920x1080x4 bytes, 60 times a second.
+    std::vector<HvsPlaneLoad> planes = {primary};
+    check(model.estimate(planes, 60).membusLoad == 497664000ULL, "hvsModel: membus load of the primary plane");
+    check(model.estimate(planes, 60).hvsLoad == 31104000ULL, "hvsModel: hvs load of the primary plane");
+    // Luma read twice for the 2:1 vertical downscale, chroma once, and 2 pixels per cycle as it is scaled.
+    planes = {video};
+    check(model.estimate(planes, 60).membusLoad == 1244160000ULL, "hvsModel: membus load of a downscaled 4K video");
+    check(model.estimate(planes, 60).hvsLoad == 124416000ULL, "hvsModel: hvs load of a downscaled 4K video");
+
+    planes = {primary, planeLoad(DRM_FORMAT_NV12, 1920, 1080, 1920, 1080)};
+    check(model.admit(planes, 1, 60) == HVS_ACCEPT, "hvsModel: unscaled 1080p video accepted");
+
+    // Together they fetch 1.74GB/s. Rejected by default, with cropping the first step, 15/16 around the centre,
+    // brings it under 1.5GiB/s.
+    planes = {primary, video};
+    check(strict.admit(planes, 1, 60) == HVS_REJECT_MEMBUS, "hvsModel: 4K video rejected by default");
+    check(planes[1].src_w == 3840 && planes[1].src_h == 2160, "hvsModel: rejected source left as requested");
+    planes = {primary, video};
+    check(model.admit(planes, 1, 60) == HVS_DOWNGRADE, "hvsModel: 4K video over the primary plane downgraded");
+    check(planes[1].src_x == 120 && planes[1].src_y == 68 && planes[1].src_w == 3600 && planes[1].src_h == 2024,
+          "hvsModel: downgraded source cropped to 3600x2024+120+68");
+    check(planes[1].dst_w == 1920 && planes[1].dst_h == 1080, "hvsModel: downgraded destination unchanged");
+    check(model.fits(model.estimate(planes, 60)), "hvsModel: downgraded set fits");
+
+    // Four quarter size sources scaled to the full screen take 249M cycles a second, a crop cannot lower that.
+    HvsPlaneLoad upscaled = planeLoad(DRM_FORMAT_ARGB8888, 480, 270, 1920, 1080);
+    planes                = {primary, upscaled, upscaled, upscaled, upscaled};
+    check(model.admit(planes, 4, 60) == HVS_REJECT_HVS, "hvsModel: HVS cycle overrun rejected without a crop");
+    check(planes[4].src_w == 480 && planes[4].src_h == 270, "hvsModel: HVS overrun source left as requested");
+
+    double ns = nsPerCall(iterations, [&](size_t i) {
+        planes = {primary, video};
+        model.admit(planes, 1, 60);
+    });
+    printf("hvsModel: %s, admitting a downgraded window %.0f ns\n", failures ? "checks failed" : "checks passed", ns);
+}
+
+struct Benchmark {
+    const char *name;
+    void (*run)();
+};
+
+static const Benchmark benchmarks[] = {
+    {"logging", benchLogging},
+    {"trace", benchTrace},
+    {"pattern", benchPattern},
+    {"clear", benchClear},
+    {"gammaLut", benchGammaLut},
+    {"hotplug", benchHotplug},
+    {"hvsModel", benchHvsModel},
+};
+
+int main(int argc, const char *argv[])
+{
+    if (PmLogGetContext("val-rpi", &valLogContext) != kPmLogErr_None) {
+        fprintf(stderr, "Failed to get the log context\n");
+        return 1;
+    }
+
+    for (auto &benchmark : benchmarks) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; i++)
+            selected |= !strcmp(argv[i], benchmark.name);
+        if (selected)
+            benchmark.run();
+    }
+    return failures ? 1 : 0;
+}
@@ -39,7 +39,9 @@ int main(int argc, const char *argv[])
         VAL_VIDEO_SIZE_T s;
         s.w = 1920;
         s.h = 1080;
-        DRIElements driElements(s, []() { std::cout << "callback on device update"; });
+        DRIElements driElements(s, [](const HotplugChangeSet &changes) {
+            std::cout << "callback on device update, " << changes.size() << " connectors changed";
+        });
 
         if (driElements.mPrimaryDev != "") {
             DriDevice &driDevice = driElements.mDeviceList[driElements.mPrimaryDev];
@@ -56,9 +56,41 @@
 #include <math.h>
 #endif
 
+#include "fill.h"
 #include "format.h"
 #include "pattern.h"
 
+/*
+ * Dumb buffers are usually mapped write-combined, so the fills below compute each distinct row once in cached
+ * memory and stream it out with the library store kernels, in bands spread over the fill threads.
+ */
+
+/* Stream the row at src, size bytes, to count rows of dst and return the row after the last one. */
+static unsigned char *replicate_row(unsigned char *dst, const void *src, size_t size, unsigned int stride,
+                                    unsigned int count)
+{
+    const FillKernel &kernel = Fill::kernel();
+
+    Fill::parallelRows(count, size * count, [&](unsigned int first, unsigned int last) {
+        for (unsigned int i = first; i < last; ++i)
+            kernel.copy(dst + (size_t)i * stride, src, size);
+    });
+    return dst + (size_t)count * stride;
+}
+
+/* Stream chroma rows: one interleaved row for semi-planar formats (cs == 2), separate U and V rows otherwise. */
+static void replicate_chroma(unsigned char *u_mem, unsigned char *v_mem, const unsigned char *u_row,
+                             const unsigned char *v_row, unsigned int cs, size_t size, unsigned int stride,
+                             unsigned int count)
+{
+    if (cs == 2) {
+        replicate_row(u_mem < v_mem ? u_mem : v_mem, u_row, size, stride, count);
+    } else {
+        replicate_row(u_mem, u_row, size, stride, count);
+        replicate_row(v_mem, v_row, size, stride, count);
+    }
+}
+
 static void fill_smpte_yuv_planar(const struct util_yuv_info *yuv, unsigned char *y_mem, unsigned char *u_mem,
                                   unsigned char *v_mem, unsigned int width, unsigned int height, unsigned int stride)
 {
@@ -98,70 +130,76 @@ static void fill_smpte_yuv_planar(const struct util_yuv_info *yuv, unsigned char
         MAKE_YUV_601(29, 29, 29),    /* 11.5% */
         MAKE_YUV_601(19, 19, 19),    /* black */
     };
-    unsigned int cs   = yuv->chroma_stride;
-    unsigned int xsub = yuv->xsub;
-    unsigned int ysub = yuv->ysub;
+    unsigned int cs      = yuv->chroma_stride;
+    unsigned int xsub    = yuv->xsub;
+    unsigned int ysub    = yuv->ysub;
+    unsigned int cwidth  = ((width - 1) / xsub + 1) * cs;
+    unsigned int cstride = stride * cs / xsub;
+    unsigned int cheight = height / ysub;
+    unsigned char *y_row = (unsigned char *)malloc(width);
+    unsigned char *u_row = (unsigned char *)calloc(2, cwidth);
+    unsigned char *v_row = u_row + cwidth;
     unsigned int x;
-    unsigned int y;
 
-    /* Luma */
-    for (y = 0; y < height * 6 / 9; ++y) {
-        for (x       = 0; x < width; ++x)
-            y_mem[x] = colors_top[x * 7 / width].y;
-        y_mem += stride;
+    if (!y_row || !u_row) {
+        printf("ERROR: out of memory\n");
+        free(y_row);
+        free(u_row);
+        return;
     }
 
-    for (; y < height * 7 / 9; ++y) {
-        for (x       = 0; x < width; ++x)
-            y_mem[x] = colors_middle[x * 7 / width].y;
-        y_mem += stride;
+    /* Luma */
+    for (x = 0; x < width; ++x)
+        y_row[x] = colors_top[x * 7 / width].y;
+    y_mem = replicate_row(y_mem, y_row, width, stride, height * 6 / 9);
+
+    for (x = 0; x < width; ++x)
+        y_row[x] = colors_middle[x * 7 / width].y;
+    y_mem = replicate_row(y_mem, y_row, width, stride, height * 7 / 9 - height * 6 / 9);
+
+    for (x = 0; x < width * 5 / 7; ++x)
+        y_row[x] = colors_bottom[x * 4 / (width * 5 / 7)].y;
+    for (; x < width * 6 / 7; ++x)
+        y_row[x] = colors_bottom[(x - width * 5 / 7) * 3 / (width / 7) + 4].y;
+    for (; x < width; ++x)
+        y_row[x] = colors_bottom[7].y;
+    replicate_row(y_mem, y_row, width, stride, height - height * 7 / 9);
+
+    /* Chroma. Semi-planar formats interleave U and V in one row, starting with the lower address. */
+    unsigned char *c_mem = u_mem < v_mem ? u_mem : v_mem;
+    unsigned char *u     = cs == 2 ? u_row + (u_mem - c_mem) : u_row;
+    unsigned char *v     = cs == 2 ? u_row + (v_mem - c_mem) : v_row;
+
+    for (x = 0; x < width; x += xsub) {
+        u[x * cs / xsub] = colors_top[x * 7 / width].u;
+        v[x * cs / xsub] = colors_top[x * 7 / width].v;
     }
+    replicate_chroma(u_mem, v_mem, u_row, v_row, cs, cwidth, cstride, cheight * 6 / 9);
 
-    for (; y < height; ++y) {
-        for (x       = 0; x < width * 5 / 7; ++x)
-            y_mem[x] = colors_bottom[x * 4 / (width * 5 / 7)].y;
-        for (; x < width * 6 / 7; ++x)
-            y_mem[x] = colors_bottom[(x - width * 5 / 7) * 3 / (width / 7) + 4].y;
-        for (; x < width; ++x)
-            y_mem[x] = colors_bottom[7].y;
-        y_mem += stride;
+    for (x = 0; x < width; x += xsub) {
+        u[x * cs / xsub] = colors_middle[x * 7 / width].u;
+        v[x * cs / xsub] = colors_middle[x * 7 / width].v;
     }
+    replicate_chroma(u_mem + cheight * 6 / 9 * cstride, v_mem + cheight * 6 / 9 * cstride, u_row, v_row, cs, cwidth,
+                     cstride, cheight * 7 / 9 - cheight * 6 / 9);
 
-    /* Chroma */
-    for (y = 0; y < height / ysub * 6 / 9; ++y) {
-        for (x = 0; x < width; x += xsub) {
-            u_mem[x * cs / xsub] = colors_top[x * 7 / width].u;
-            v_mem[x * cs / xsub] = colors_top[x * 7 / width].v;
-        }
-        u_mem += stride * cs / xsub;
-        v_mem += stride * cs / xsub;
+    for (x = 0; x < width * 5 / 7; x += xsub) {
+        u[x * cs / xsub] = colors_bottom[x * 4 / (width * 5 / 7)].u;
+        v[x * cs / xsub] = colors_bottom[x * 4 / (width * 5 / 7)].v;
     }
-
-    for (; y < height / ysub * 7 / 9; ++y) {
-        for (x = 0; x < width; x += xsub) {
-            u_mem[x * cs / xsub] = colors_middle[x * 7 / width].u;
-            v_mem[x * cs / xsub] = colors_middle[x * 7 / width].v;
-        }
-        u_mem += stride * cs / xsub;
-        v_mem += stride * cs / xsub;
+    for (; x < width * 6 / 7; x += xsub) {
+        u[x * cs / xsub] = colors_bottom[(x - width * 5 / 7) * 3 / (width / 7) + 4].u;
+        v[x * cs / xsub] = colors_bottom[(x - width * 5 / 7) * 3 / (width / 7) + 4].v;
     }
-
-    for (; y < height / ysub; ++y) {
-        for (x = 0; x < width * 5 / 7; x += xsub) {
-            u_mem[x * cs / xsub] = colors_bottom[x * 4 / (width * 5 / 7)].u;
-            v_mem[x * cs / xsub] = colors_bottom[x * 4 / (width * 5 / 7)].v;
-        }
-        for (; x < width * 6 / 7; x += xsub) {
-            u_mem[x * cs / xsub] = colors_bottom[(x - width * 5 / 7) * 3 / (width / 7) + 4].u;
-            v_mem[x * cs / xsub] = colors_bottom[(x - width * 5 / 7) * 3 / (width / 7) + 4].v;
-        }
-        for (; x < width; x += xsub) {
-            u_mem[x * cs / xsub] = colors_bottom[7].u;
-            v_mem[x * cs / xsub] = colors_bottom[7].v;
-        }
-        u_mem += stride * cs / xsub;
-        v_mem += stride * cs / xsub;
+    for (; x < width; x += xsub) {
+        u[x * cs / xsub] = colors_bottom[7].u;
+        v[x * cs / xsub] = colors_bottom[7].v;
     }
+    replicate_chroma(u_mem + cheight * 7 / 9 * cstride, v_mem + cheight * 7 / 9 * cstride, u_row, v_row, cs, cwidth,
+                     cstride, cheight - cheight * 7 / 9);
+
+    free(y_row);
+    free(u_row);
 }
 
 static void fill_smpte_yuv_packed(const struct util_yuv_info *yuv, unsigned char *mem, unsigned int width,
@@ -204,68 +242,87 @@ static void fill_smpte_yuv_packed(const struct util_yuv_info *yuv, unsigned char
         MAKE_YUV_601(29, 29, 29),    /* 11.5% */
         MAKE_YUV_601(19, 19, 19),    /* black */
     };
-    unsigned char *y_mem = (yuv->order & YUV_YC) ? mem : mem + 1;
-    unsigned char *c_mem = (yuv->order & YUV_CY) ? mem : mem + 1;
+    unsigned int size  = (width + 1) / 2 * 4;
+    unsigned char *row = (unsigned char *)calloc(1, size);
+    if (!row) {
+        printf("ERROR: out of memory\n");
+        return;
+    }
+    unsigned char *y_mem = (yuv->order & YUV_YC) ? row : row + 1;
+    unsigned char *c_mem = (yuv->order & YUV_CY) ? row : row + 1;
     unsigned int u       = (yuv->order & YUV_YCrCb) ? 2 : 0;
     unsigned int v       = (yuv->order & YUV_YCbCr) ? 2 : 0;
     unsigned int x;
-    unsigned int y;
 
-    /* Luma */
-    for (y = 0; y < height * 6 / 9; ++y) {
-        for (x           = 0; x < width; ++x)
-            y_mem[2 * x] = colors_top[x * 7 / width].y;
-        y_mem += stride;
+    for (x = 0; x < width; ++x)
+        y_mem[2 * x] = colors_top[x * 7 / width].y;
+    for (x = 0; x < width; x += 2) {
+        c_mem[2 * x + u] = colors_top[x * 7 / width].u;
+        c_mem[2 * x + v] = colors_top[x * 7 / width].v;
     }
+    mem = replicate_row(mem, row, size, stride, height * 6 / 9);
 
-    for (; y < height * 7 / 9; ++y) {
-        for (x           = 0; x < width; ++x)
-            y_mem[2 * x] = colors_middle[x * 7 / width].y;
-        y_mem += stride;
+    for (x = 0; x < width; ++x)
+        y_mem[2 * x] = colors_middle[x * 7 / width].y;
+    for (x = 0; x < width; x += 2) {
+        c_mem[2 * x + u] = colors_middle[x * 7 / width].u;
+        c_mem[2 * x + v] = colors_middle[x * 7 / width].v;
     }
-
-    for (; y < height; ++y) {
-        for (x           = 0; x < width * 5 / 7; ++x)
-            y_mem[2 * x] = colors_bottom[x * 4 / (width * 5 / 7)].y;
-        for (; x < width * 6 / 7; ++x)
-            y_mem[2 * x] = colors_bottom[(x - width * 5 / 7) * 3 / (width / 7) + 4].y;
-        for (; x < width; ++x)
-            y_mem[2 * x] = colors_bottom[7].y;
-        y_mem += stride;
+    mem = replicate_row(mem, row, size, stride, height * 7 / 9 - height * 6 / 9);
+
+    for (x = 0; x < width * 5 / 7; ++x)
+        y_mem[2 * x] = colors_bottom[x * 4 / (width * 5 / 7)].y;
+    for (; x < width * 6 / 7; ++x)
+        y_mem[2 * x] = colors_bottom[(x - width * 5 / 7) * 3 / (width / 7) + 4].y;
+    for (; x < width; ++x)
+        y_mem[2 * x] = colors_bottom[7].y;
+    for (x = 0; x < width * 5 / 7; x += 2) {
+        c_mem[2 * x + u] = colors_bottom[x * 4 / (width * 5 / 7)].u;
+        c_mem[2 * x + v] = colors_bottom[x * 4 / (width * 5 / 7)].v;
     }
-
-    /* Chroma */
-    for (y = 0; y < height * 6 / 9; ++y) {
-        for (x = 0; x < width; x += 2) {
-            c_mem[2 * x + u] = colors_top[x * 7 / width].u;
-            c_mem[2 * x + v] = colors_top[x * 7 / width].v;
-        }
-        c_mem += stride;
+    for (; x < width * 6 / 7; x += 2) {
+        c_mem[2 * x + u] = colors_bottom[(x - width * 5 / 7) * 3 / (width / 7) + 4].u;
+        c_mem[2 * x + v] = colors_bottom[(x - width * 5 / 7) * 3 / (width / 7) + 4].v;
     }
-
-    for (; y < height * 7 / 9; ++y) {
-        for (x = 0; x < width; x += 2) {
-            c_mem[2 * x + u] = colors_middle[x * 7 / width].u;
-            c_mem[2 * x + v] = colors_middle[x * 7 / width].v;
-        }
-        c_mem += stride;
+    for (; x < width; x += 2) {
+        c_mem[2 * x + u] = colors_bottom[7].u;
+        c_mem[2 * x + v] = colors_bottom[7].v;
     }
+    replicate_row(mem, row, size, stride, height - height * 7 / 9);
 
-    for (; y < height; ++y) {
-        for (x = 0; x < width * 5 / 7; x += 2) {
-            c_mem[2 * x + u] = colors_bottom[x * 4 / (width * 5 / 7)].u;
-            c_mem[2 * x + v] = colors_bottom[x * 4 / (width * 5 / 7)].v;
-        }
-        for (; x < width * 6 / 7; x += 2) {
-            c_mem[2 * x + u] = colors_bottom[(x - width * 5 / 7) * 3 / (width / 7) + 4].u;
-            c_mem[2 * x + v] = colors_bottom[(x - width * 5 / 7) * 3 / (width / 7) + 4].v;
-        }
-        for (; x < width; x += 2) {
-            c_mem[2 * x + u] = colors_bottom[7].u;
-            c_mem[2 * x + v] = colors_bottom[7].v;
-        }
-        c_mem += stride;
+    free(row);
+}
+
+/* Each band of the RGB SMPTE pattern repeats a single row. */
+template <typename T>
+static void fill_smpte_rows(const T *colors_top, const T *colors_middle, const T *colors_bottom, unsigned char *mem,
+                            unsigned int width, unsigned int height, unsigned int stride)
+{
+    T *row = (T *)malloc(width * sizeof(T));
+    unsigned int x;
+
+    if (!row) {
+        printf("ERROR: out of memory\n");
+        return;
     }
+
+    for (x = 0; x < width; ++x)
+        row[x] = colors_top[x * 7 / width];
+    mem = replicate_row(mem, row, width * sizeof(T), stride, height * 6 / 9);
+
+    for (x = 0; x < width; ++x)
+        row[x] = colors_middle[x * 7 / width];
+    mem = replicate_row(mem, row, width * sizeof(T), stride, height * 7 / 9 - height * 6 / 9);
+
+    for (x = 0; x < width * 5 / 7; ++x)
+        row[x] = colors_bottom[x * 4 / (width * 5 / 7)];
+    for (; x < width * 6 / 7; ++x)
+        row[x] = colors_bottom[(x - width * 5 / 7) * 3 / (width / 7) + 4];
+    for (; x < width; ++x)
+        row[x] = colors_bottom[7];
+    replicate_row(mem, row, width * sizeof(T), stride, height - height * 7 / 9);
+
+    free(row);
 }
 
 static void fill_smpte_rgb16(const struct util_rgb_info *rgb, unsigned char *mem, unsigned int width,
@@ -308,30 +365,8 @@ static void fill_smpte_rgb16(const struct util_rgb_info *rgb, unsigned char *mem
         MAKE_RGBA(rgb, 29, 29, 29, 255),    /* 11.5% */
         MAKE_RGBA(rgb, 19, 19, 19, 255),    /* black */
     };
-    unsigned int x;
-    unsigned int y;
-
-    for (y = 0; y < height * 6 / 9; ++y) {
-        for (x                   = 0; x < width; ++x)
-            ((uint16_t *)mem)[x] = colors_top[x * 7 / width];
-        mem += stride;
-    }
-
-    for (; y < height * 7 / 9; ++y) {
-        for (x                   = 0; x < width; ++x)
-            ((uint16_t *)mem)[x] = colors_middle[x * 7 / width];
-        mem += stride;
-    }
 
-    for (; y < height; ++y) {
-        for (x                   = 0; x < width * 5 / 7; ++x)
-            ((uint16_t *)mem)[x] = colors_bottom[x * 4 / (width * 5 / 7)];
-        for (; x < width * 6 / 7; ++x)
-            ((uint16_t *)mem)[x] = colors_bottom[(x - width * 5 / 7) * 3 / (width / 7) + 4];
-        for (; x < width; ++x)
-            ((uint16_t *)mem)[x] = colors_bottom[7];
-        mem += stride;
-    }
+    fill_smpte_rows(colors_top, colors_middle, colors_bottom, mem, width, height, stride);
 }
 
 static void fill_smpte_rgb24(const struct util_rgb_info *rgb, unsigned char *mem, unsigned int width,
@@ -374,30 +409,8 @@ static void fill_smpte_rgb24(const struct util_rgb_info *rgb, unsigned char *mem
         MAKE_RGB24(rgb, 29, 29, 29),    /* 11.5% */
         MAKE_RGB24(rgb, 19, 19, 19),    /* black */
     };
-    unsigned int x;
-    unsigned int y;
-
-    for (y = 0; y < height * 6 / 9; ++y) {
-        for (x                             = 0; x < width; ++x)
-            ((struct color_rgb24 *)mem)[x] = colors_top[x * 7 / width];
-        mem += stride;
-    }
-
-    for (; y < height * 7 / 9; ++y) {
-        for (x                             = 0; x < width; ++x)
-            ((struct color_rgb24 *)mem)[x] = colors_middle[x * 7 / width];
-        mem += stride;
-    }
 
-    for (; y < height; ++y) {
-        for (x                             = 0; x < width * 5 / 7; ++x)
-            ((struct color_rgb24 *)mem)[x] = colors_bottom[x * 4 / (width * 5 / 7)];
-        for (; x < width * 6 / 7; ++x)
-            ((struct color_rgb24 *)mem)[x] = colors_bottom[(x - width * 5 / 7) * 3 / (width / 7) + 4];
-        for (; x < width; ++x)
-            ((struct color_rgb24 *)mem)[x] = colors_bottom[7];
-        mem += stride;
-    }
+    fill_smpte_rows(colors_top, colors_middle, colors_bottom, mem, width, height, stride);
 }
 
 static void fill_smpte_rgb32(const struct util_rgb_info *rgb, unsigned char *mem, unsigned int width,
@@ -440,30 +453,8 @@ static void fill_smpte_rgb32(const struct util_rgb_info *rgb, unsigned char *mem
         MAKE_RGBA(rgb, 29, 29, 29, 255),    /* 11.5% */
         MAKE_RGBA(rgb, 19, 19, 19, 255),    /* black */
     };
-    unsigned int x;
-    unsigned int y;
-
-    for (y = 0; y < height * 6 / 9; ++y) {
-        for (x                   = 0; x < width; ++x)
-            ((uint32_t *)mem)[x] = colors_top[x * 7 / width];
-        mem += stride;
-    }
 
-    for (; y < height * 7 / 9; ++y) {
-        for (x                   = 0; x < width; ++x)
-            ((uint32_t *)mem)[x] = colors_middle[x * 7 / width];
-        mem += stride;
-    }
-
-    for (; y < height; ++y) {
-        for (x                   = 0; x < width * 5 / 7; ++x)
-            ((uint32_t *)mem)[x] = colors_bottom[x * 4 / (width * 5 / 7)];
-        for (; x < width * 6 / 7; ++x)
-            ((uint32_t *)mem)[x] = colors_bottom[(x - width * 5 / 7) * 3 / (width / 7) + 4];
-        for (; x < width; ++x)
-            ((uint32_t *)mem)[x] = colors_bottom[7];
-        mem += stride;
-    }
+    fill_smpte_rows(colors_top, colors_middle, colors_bottom, mem, width, height, stride);
 }
 
 static void fill_smpte(const struct util_format_info *info, void *planes[3], unsigned int width, unsigned int height,
@@ -601,6 +592,22 @@ static void make_pwetty(void *data, unsigned int width, unsigned int height, uns
 #endif
 }
 
+/* Color of the tiles pattern at diagonal position x + y; rows are the same diagonal shifted by one pixel. */
+static uint32_t tile_rgb32(unsigned int pos, unsigned int width)
+{
+    div_t d = div((int)pos, (int)width);
+
+    return 0x00130502 * (d.quot >> 6) + 0x000a1120 * (d.rem >> 6);
+}
+
+static struct color_yuv tile_yuv(unsigned int pos, unsigned int width)
+{
+    uint32_t rgb32         = tile_rgb32(pos, width);
+    struct color_yuv color = MAKE_YUV_601((rgb32 >> 16) & 0xff, (rgb32 >> 8) & 0xff, rgb32 & 0xff);
+
+    return color;
+}
+
 static void fill_tiles_yuv_planar(const struct util_format_info *info, unsigned char *y_mem, unsigned char *u_mem,
                                   unsigned char *v_mem, unsigned int width, unsigned int height, unsigned int stride)
 {
@@ -618,28 +625,68 @@ static void fill_tiles_yuv_planar(const struct util_format_info *info, unsigned
     unsigned int xsub               = yuv->xsub;
     unsigned int ysub               = yuv->ysub;
     unsigned int x;
-    unsigned int y;
     if ( xsub == 0 || ysub == 0 ) {
         printf("ERROR: xsub / ysub should not be 0\n");
         return;
     }
-    for (y = 0; y < height; ++y) {
-        for (x = 0; x < width; ++x) {
-            div_t d                = div((int)x + y, (int)width);
-            uint32_t rgb32         = 0x00130502 * (d.quot >> 6) + 0x000a1120 * (d.rem >> 6);
-            struct color_yuv color = MAKE_YUV_601((rgb32 >> 16) & 0xff, (rgb32 >> 8) & 0xff, rgb32 & 0xff);
+    unsigned int cwidth      = ((width - 1) / xsub + 1) * cs;
+    unsigned int cstride     = stride * cs / xsub;
+    unsigned int cheight     = (height + ysub - 1) / ysub;
+    struct color_yuv *colors = (struct color_yuv *)malloc((width + height) * sizeof(*colors));
+    unsigned char *y_diag    = (unsigned char *)malloc(width + height);
+    const FillKernel &kernel = Fill::kernel();
+
+    if (!colors || !y_diag) {
+        printf("ERROR: out of memory\n");
+        free(colors);
+        free(y_diag);
+        return;
+    }
 
-            y_mem[x]             = color.y;
-            u_mem[x / xsub * cs] = color.u;
-            v_mem[x / xsub * cs] = color.v;
-        }
+    for (x = 0; x < width + height; ++x) {
+        colors[x] = tile_yuv(x, width);
+        y_diag[x] = colors[x].y;
+    }
 
-        y_mem += stride;
-        if ((y + 1) % ysub == 0) {
-            u_mem += stride * cs / xsub;
-            v_mem += stride * cs / xsub;
+    /* Luma row y starts y pixels into the diagonal. */
+    Fill::parallelRows(height, (size_t)width * height, [&](unsigned int first, unsigned int last) {
+        for (unsigned int row = first; row < last; ++row)
+            kernel.copy(y_mem + (size_t)row * stride, y_diag + row, width);
+    });
+
+    /* Chroma samples hold the last pixel of their xsub x ysub block. */
+    Fill::parallelRows(cheight, (size_t)cwidth * cheight, [&](unsigned int first, unsigned int last) {
+        unsigned char *u_row = (unsigned char *)calloc(2, cwidth);
+        unsigned char *v_row = u_row + cwidth;
+        unsigned char *c_mem = u_mem < v_mem ? u_mem : v_mem;
+
+        if (!u_row)
+            return;
+
+        unsigned char *u = cs == 2 ? u_row + (u_mem - c_mem) : u_row;
+        unsigned char *v = cs == 2 ? u_row + (v_mem - c_mem) : v_row;
+
+        for (unsigned int row = first; row < last; ++row) {
+            unsigned int last_y = row * ysub + ysub - 1 < height ? row * ysub + ysub - 1 : height - 1;
+
+            for (unsigned int cx = 0; cx < width; cx += xsub) {
+                unsigned int last_x = cx + xsub - 1 < width ? cx + xsub - 1 : width - 1;
+
+                u[cx / xsub * cs] = colors[last_x + last_y].u;
+                v[cx / xsub * cs] = colors[last_x + last_y].v;
+            }
+            if (cs == 2) {
+                kernel.copy(c_mem + (size_t)row * cstride, u_row, cwidth);
+            } else {
+                kernel.copy(u_mem + (size_t)row * cstride, u_row, cwidth);
+                kernel.copy(v_mem + (size_t)row * cstride, v_row, cwidth);
+            }
         }
-    }
+        free(u_row);
+    });
+
+    free(colors);
+    free(y_diag);
 }
 
 static void fill_tiles_yuv_packed(const struct util_format_info *info, unsigned char *mem, unsigned int width,
@@ -655,28 +702,41 @@ static void fill_tiles_yuv_packed(const struct util_format_info *info, unsigned
         return;
     }
     const struct util_yuv_info *yuv = &info->yuv;
-    unsigned char *y_mem            = (yuv->order & YUV_YC) ? (unsigned char *)mem : (unsigned char *)mem + 1;
-    unsigned char *c_mem            = (yuv->order & YUV_CY) ? (unsigned char *)mem : (unsigned char *)mem + 1;
+    unsigned int y_off              = (yuv->order & YUV_YC) ? 0 : 1;
+    unsigned int c_off              = (yuv->order & YUV_CY) ? 0 : 1;
     unsigned int u                  = (yuv->order & YUV_YCrCb) ? 2 : 0;
     unsigned int v                  = (yuv->order & YUV_YCbCr) ? 2 : 0;
+    unsigned int pairs              = (width + 1) / 2;
+    unsigned int diag               = pairs + height / 2 + 1;
+    unsigned char *macro            = (unsigned char *)malloc(2 * diag * 4);
+    const FillKernel &kernel        = Fill::kernel();
     unsigned int x;
-    unsigned int y;
-
-    for (y = 0; y < height; ++y) {
-        for (x = 0; x < width; x += 2) {
-            div_t d                = div((int)x + y, (int)width);
-            uint32_t rgb32         = 0x00130502 * (d.quot >> 6) + 0x000a1120 * (d.rem >> 6);
-            struct color_yuv color = MAKE_YUV_601((rgb32 >> 16) & 0xff, (rgb32 >> 8) & 0xff, rgb32 & 0xff);
-
-            y_mem[2 * x]     = color.y;
-            c_mem[2 * x + u] = color.u;
-            y_mem[2 * x + 2] = color.y;
-            c_mem[2 * x + v] = color.v;
-        }
 
-        y_mem += stride;
-        c_mem += stride;
+    if (!macro) {
+        printf("ERROR: out of memory\n");
+        return;
     }
+
+    /*
+     * Each pixel pair takes the color of its first pixel, x + y, so even rows sample the diagonal at even
+     * positions and odd rows at odd ones. Keep one run of macropixels per parity.
+     */
+    for (x = 0; x < 2 * diag; ++x) {
+        unsigned char *m       = macro + ((x & 1) * diag + x / 2) * 4;
+        struct color_yuv color = tile_yuv(x, width);
+
+        m[y_off]     = color.y;
+        m[y_off + 2] = color.y;
+        m[c_off + u] = color.u;
+        m[c_off + v] = color.v;
+    }
+
+    Fill::parallelRows(height, (size_t)pairs * 4 * height, [&](unsigned int first, unsigned int last) {
+        for (unsigned int row = first; row < last; ++row)
+            kernel.copy(mem + (size_t)row * stride, macro + ((row & 1) * diag + row / 2) * 4, pairs * 4);
+    });
+
+    free(macro);
 }
 
 static void fill_tiles_rgb16(const struct util_format_info *info, unsigned char *mem, unsigned int width,
@@ -692,21 +752,28 @@ static void fill_tiles_rgb16(const struct util_format_info *info, unsigned char
         return;
     }
     const struct util_rgb_info *rgb = &info->rgb;
-    unsigned char *mem_base         = mem;
-    unsigned int x, y;
+    uint16_t *diag                  = (uint16_t *)malloc((width + height) * sizeof(*diag));
+    const FillKernel &kernel        = Fill::kernel();
+    unsigned int x;
 
-    for (y = 0; y < height; ++y) {
-        for (x = 0; x < width; ++x) {
-            div_t d        = div((int)x + y, (int)width);
-            uint32_t rgb32 = 0x00130502 * (d.quot >> 6) + 0x000a1120 * (d.rem >> 6);
-            uint16_t color = MAKE_RGBA(rgb, (rgb32 >> 16) & 0xff, (rgb32 >> 8) & 0xff, rgb32 & 0xff, 255);
+    if (!diag) {
+        printf("ERROR: out of memory\n");
+        return;
+    }
 
-            ((uint16_t *)mem)[x] = color;
-        }
-        mem += stride;
+    for (x = 0; x < width + height; ++x) {
+        uint32_t rgb32 = tile_rgb32(x, width);
+        diag[x]        = MAKE_RGBA(rgb, (rgb32 >> 16) & 0xff, (rgb32 >> 8) & 0xff, rgb32 & 0xff, 255);
     }
 
-    make_pwetty(mem_base, width, height, stride, info->format);
+    /* Row y starts y pixels into the diagonal. */
+    Fill::parallelRows(height, (size_t)stride * height, [&](unsigned int first, unsigned int last) {
+        for (unsigned int row = first; row < last; ++row)
+            kernel.copy(mem + (size_t)row * stride, diag + row, width * sizeof(*diag));
+    });
+    free(diag);
+
+    make_pwetty(mem, width, height, stride, info->format);
 }
 
 static void fill_tiles_rgb24(const struct util_format_info *info, unsigned char *mem, unsigned int width,
@@ -722,18 +789,27 @@ static void fill_tiles_rgb24(const struct util_format_info *info, unsigned char
         return;
     }
     const struct util_rgb_info *rgb = &info->rgb;
-    unsigned int x, y;
+    struct color_rgb24 *diag        = (struct color_rgb24 *)malloc((width + height) * sizeof(*diag));
+    const FillKernel &kernel        = Fill::kernel();
+    unsigned int x;
 
-    for (y = 0; y < height; ++y) {
-        for (x = 0; x < width; ++x) {
-            div_t d                  = div((int)x + y, (int)width);
-            uint32_t rgb32           = 0x00130502 * (d.quot >> 6) + 0x000a1120 * (d.rem >> 6);
-            struct color_rgb24 color = MAKE_RGB24(rgb, (rgb32 >> 16) & 0xff, (rgb32 >> 8) & 0xff, rgb32 & 0xff);
+    if (!diag) {
+        printf("ERROR: out of memory\n");
+        return;
+    }
 
-            ((struct color_rgb24 *)mem)[x] = color;
-        }
-        mem += stride;
+    for (x = 0; x < width + height; ++x) {
+        uint32_t rgb32           = tile_rgb32(x, width);
+        struct color_rgb24 color = MAKE_RGB24(rgb, (rgb32 >> 16) & 0xff, (rgb32 >> 8) & 0xff, rgb32 & 0xff);
+
+        diag[x] = color;
     }
+
+    Fill::parallelRows(height, (size_t)stride * height, [&](unsigned int first, unsigned int last) {
+        for (unsigned int row = first; row < last; ++row)
+            kernel.copy(mem + (size_t)row * stride, diag + row, width * sizeof(*diag));
+    });
+    free(diag);
 }
 
 static void fill_tiles_rgb32(const struct util_format_info *info, unsigned char *mem, unsigned int width,
@@ -749,22 +825,35 @@ static void fill_tiles_rgb32(const struct util_format_info *info, unsigned char
         return;
     }
     const struct util_rgb_info *rgb = &info->rgb;
-    void *mem_base                  = mem;
-    unsigned int x, y;
+    uint32_t *opaque                = (uint32_t *)malloc(2 * (width + height) * sizeof(*opaque));
+    uint32_t *translucent           = opaque + width + height;
+    const FillKernel &kernel        = Fill::kernel();
+    unsigned int x;
+
+    if (!opaque) {
+        printf("ERROR: out of memory\n");
+        return;
+    }
+
+    for (x = 0; x < width + height; ++x) {
+        uint32_t rgb32 = tile_rgb32(x, width);
+        opaque[x]      = MAKE_RGBA(rgb, (rgb32 >> 16) & 0xff, (rgb32 >> 8) & 0xff, rgb32 & 0xff, 255);
+        translucent[x] = MAKE_RGBA(rgb, (rgb32 >> 16) & 0xff, (rgb32 >> 8) & 0xff, rgb32 & 0xff, 127);
+    }
 
-    for (y = 0; y < height; ++y) {
-        for (x = 0; x < width; ++x) {
-            div_t d        = div((int)x + y, (int)width);
-            uint32_t rgb32 = 0x00130502 * (d.quot >> 6) + 0x000a1120 * (d.rem >> 6);
-            uint32_t alpha = ((y < height / 2) && (x < width / 2)) ? 127 : 255;
-            uint32_t color = MAKE_RGBA(rgb, (rgb32 >> 16) & 0xff, (rgb32 >> 8) & 0xff, rgb32 & 0xff, alpha);
+    /* Row y starts y pixels into the diagonal; the top left quadrant is half transparent. */
+    Fill::parallelRows(height, (size_t)stride * height, [&](unsigned int first, unsigned int last) {
+        for (unsigned int y = first; y < last; ++y) {
+            unsigned char *row = mem + (size_t)y * stride;
+            unsigned int split = y < height / 2 ? width / 2 : 0;
 
-            ((uint32_t *)mem)[x] = color;
+            kernel.copy(row, translucent + y, split * sizeof(*opaque));
+            kernel.copy(row + split * sizeof(*opaque), opaque + y + split, (width - split) * sizeof(*opaque));
         }
-        mem += stride;
-    }
+    });
+    free(opaque);
 
-    make_pwetty(mem_base, width, height, stride, info->format);
+    make_pwetty(mem, width, height, stride, info->format);
 }
 
 static void fill_tiles(const struct util_format_info *info, void *planes[3], unsigned int width, unsigned int height,
@@ -841,7 +930,7 @@ static void fill_tiles(const struct util_format_info *info, void *planes[3], uns
 static void fill_plain(const struct util_format_info *info, void *planes[3], unsigned int width, unsigned int height,
                        unsigned int stride)
 {
-    memset(planes[0], 0x77, stride * height);
+    Fill::fillRows(planes[0], stride, stride, height, 0x77777777);
 }
 
 uint32_t util_format_fourcc(const char *name)
@@ -910,11 +999,15 @@ void util_fill_pattern(uint32_t format, enum util_fill_pattern pattern, void *pl
 void fill_pattern(unsigned int format, struct bo *bo, size_t width, size_t height, enum util_fill_pattern pattern)
 {
 
-    unsigned char *boMap;
-    int ret = bo_map(bo, (void **)&boMap);
-    if (ret) {
-        fprintf(stderr, "failed to map buffer: %s\n", strerror(-errno));
-        return;
+    /* The mapping stays with the bo, so repeated fills of the same buffer reuse it. */
+    unsigned char *boMap = (unsigned char *)bo->ptr;
+    if (!boMap) {
+        bo->populate = true;
+        int ret      = bo_map(bo, (void **)&boMap);
+        if (ret) {
+            fprintf(stderr, "failed to map buffer: %s\n", strerror(-errno));
+            return;
+        }
     }
     uint32_t pitches[4] = {0}, offsets[4] = {0};
     void *planes[3] = {
@@ -1006,5 +1099,4 @@ void fill_pattern(unsigned int format, struct bo *bo, size_t width, size_t heigh
     }
 
     util_fill_pattern(format, pattern, planes, width, height, pitches[0]);
-    // bo_unmap(bo);
 }